@@ -14,7 +14,7 @@
 #if 1
 #define INTERPRETER_SIZE    (1024 * 1024)
 #define COMPILER_SIZE       (1024 * 1024)
-#define STACK_SIZE          (64 * 1025)
+#define STACK_SIZE          (4 * 1024)
 #else
 #define INTERPRETER_SIZE    (20 * 1024)
 #define COMPILER_SIZE       (8 * 1024)
@@ -69,8 +69,21 @@ static void Usage(void);
 int main(int argc,char **argv)
 {
 	int interactiveP = TRUE;
+    char *imageName = NULL;
     BobUnwindTarget target;
     BobInterpreter *c;
+    int i;
+    
+    /* look for an image to restore */
+    for (i = 1; i < argc; ++i)
+        if (argv[i][0] == '-' && argv[i][1] == 'r') {
+            if (argv[i][2])
+                imageName = &argv[i][2];
+            else if (++i < argc)
+                imageName = argv[i];
+            else
+                Usage();
+        }
     
     /* make the workspace */
     if ((c = BobMakeInterpreter(interpreterSpace,sizeof(interpreterSpace),STACK_SIZE)) == NULL)
@@ -91,20 +104,32 @@ int main(int argc,char **argv)
     if (BobUnwindCatch(c))
         exit(1);
 
+    /* initialize the workspace from an image */
+    if (imageName) {
+        if (!BobLoadImage(c,imageName)) {
+            fprintf(stderr,"Can't load image '%s'\n",imageName);
+            exit(1);
+        }
+    }
+
     /* initialize the workspace */
-    if (!BobInitInterpreter(c))
+    else if (!BobInitInterpreter(c))
         exit(1);
 
     /* use stdio for file i/o */
     BobUseStandardIO(c);
      
-    /* add the library functions to the symbol table */
-    BobEnterLibrarySymbols(c);
+    /* the image already contains the library functions */
+    if (!imageName) {
+
+        /* add the library functions to the symbol table */
+        BobEnterLibrarySymbols(c);
 
-    /* use the math routines */
+        /* use the math routines */
 #ifdef BOB_INCLUDE_FLOAT_SUPPORT
-    BobUseMath(c);
+        BobUseMath(c);
 #endif
+    }
 
     /* use the eval package */
     BobUseEval(c,compilerSpace,sizeof(compilerSpace));
@@ -113,7 +138,6 @@ int main(int argc,char **argv)
     if (BobUnwindCatch(c) == 0) {
         char *inputName,*outputName = NULL;
         int verboseP = FALSE;
-        int i;
 
         /* process arguments */
         for (i = 1; i < argc; ++i) {
@@ -133,9 +157,16 @@ int main(int argc,char **argv)
                     interactiveP = FALSE;
                     outputName = NULL;
                     break;
+                case 'g':   /* display garbage collection messages */
+                    c->gcMessages = TRUE;
+                    break;
                 case 'i':   /* enter interactive mode after loading */
                     interactiveP = TRUE;
                     break;
+                case 'r':   /* restore an image (handled above) */
+                    if (!argv[i][2])
+                        ++i;
+                    break;
                 case 'o':   /* specify output filename when compiling */
                     if (argv[i][2])
                         outputName = &argv[i][2];
@@ -241,24 +272,27 @@ static void LoadFile(BobInterpreter *c,char *name,int verboseP)
 static void ReadEvalPrint(BobInterpreter *c)
 {
     char lineBuffer[256];
-    BobValue val;
+    BobHandleScope scope;
+    BobValue *val;
 
-    /* protect a pointer from the garbage collector */
-    BobProtectPointer(c,&val);
+    /* keep the value in a handle to protect it from the garbage collector */
+    BobOpenHandleScope(c,&scope);
+    val = BobMakeHandle(c,c->nilValue);
     
     for (;;) {
         printf("\n> "); fflush(stdout);
         if (fgets(lineBuffer,sizeof(lineBuffer),stdin)) {
-            val = BobEvalString(c,lineBuffer);
-            if (val) {
+            *val = BobEvalString(c,lineBuffer);
+            if (*val) {
                 printf("--> ");
-                BobPrint(c,val,c->standardOutput);
+                BobPrint(c,*val,c->standardOutput);
                 printf("\n");
             }
         }
         else
             break;
     }
+    BobCloseHandleScope(c,&scope);
 }
 
 /* ErrorHandler - error handler callback */
@@ -284,8 +318,10 @@ static void Usage(void)
 {
     fprintf(stderr,"\
 usage: bob [-c file]     compile a source file\n\
+           [-g]          display garbage collection messages\n\
            [-i]          enter interactive mode after loading\n\
            [-o file]     object file name for compile\n\
+           [-r image]    start from an image saved by SaveImage\n\
            [-v]          enable verbose mode\n\
            [-?]          display (this) help information\n\
            [file]        load a source or object file\n");
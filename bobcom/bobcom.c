@@ -1658,6 +1658,7 @@ static int addliteral(BobCompiler *c,BobValue lit)
             return (int)(BobFirstLiteral + (p - c->lbase));
     if (c->lptr >= c->ltop)
         BobParseError(c,"too many literals");
+    BobWriteBarrier(c->ic,c->literalbuf,lit);
     BobSetVectorElement(c->literalbuf,p = c->lptr++,lit);
     return (int)(BobFirstLiteral + (p - c->lbase));
 }
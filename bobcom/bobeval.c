@@ -50,9 +50,7 @@ static BobValue BIF_Load(BobInterpreter *c)
 static BobValue BIF_Eval(BobInterpreter *c)
 {
     char *str;
-    BobCheckArgCnt(c,3);
-    BobCheckType(c,3,BobStringP);
-    str = (char *)BobStringAddress(BobGetArg(c,3));
+    BobParseArguments(c,"**S",&str);
     return BobEvalString(c,str);
 }
 
@@ -60,11 +58,7 @@ static BobValue BIF_Eval(BobInterpreter *c)
 static BobValue BIF_CompileFile(BobInterpreter *c)
 {
     char *iname,*oname;
-    BobCheckArgCnt(c,4);
-    BobCheckType(c,3,BobStringP);
-    BobCheckType(c,4,BobStringP);
-    iname = (char *)BobStringAddress(BobGetArg(c,3));
-    oname = (char *)BobStringAddress(BobGetArg(c,4));
+    BobParseArguments(c,"**SS",&iname,&oname);
     return BobCompileFile(c,iname,oname) ? c->trueValue : c->falseValue;
 }
 
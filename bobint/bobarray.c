@@ -0,0 +1,619 @@
+/* bobarray.c - 'Int64Array', 'Float64Array' and 'ByteArray' handlers */
+/*
+        Copyright (c) 2001, by David Michael Betz
+        All rights reserved
+*/
+
+/*
+    A numeric array stores its elements unboxed in one block of memory on
+    the heap rather than as a vector of values, so a million floats take
+    eight megabytes instead of a vector pointing to a million float
+    objects.  Indexing converts an element to a value on the way out and
+    back again on the way in.  A ByteArray keeps the low eight bits of
+    each value stored in it.
+
+    The bulk methods loop over the raw elements with no calls in the loop
+    bodies so the compiler can vectorize them.  Floating point sums are
+    split across several accumulators since the compiler isn't allowed
+    to reorder the additions of a single running sum.
+*/
+
+#include <string.h>
+#include "bob.h"
+
+/* array data structure */
+typedef struct {
+    BobDispatch *dispatch;
+    BobIntegerType size;            /* size of the data in bytes */
+/*  unsigned char data[0]; */
+} ArrayData;
+
+#define ArrayDataSize(o)            (((ArrayData *)o)->size)
+#define SetArrayDataSize(o,v)       (((ArrayData *)o)->size = (v))
+#define ArrayDataAddress(o)         ((unsigned char *)(o) + sizeof(ArrayData))
+
+/* numeric array structure */
+typedef struct {
+    BobCObject hdr;
+    BobValue data;                  /* array data or nil */
+    BobIntegerType size;            /* number of elements */
+} NumericArray;
+
+#define ArrayData(o)                (((NumericArray *)o)->data)
+#define SetArrayData(o,v)           (((NumericArray *)o)->data = (v))
+#define ArraySize(o)                (((NumericArray *)o)->size)
+#define SetArraySize(o,v)           (((NumericArray *)o)->size = (v))
+#define ArrayInt64s(o)              ((long long *)ArrayDataAddress(ArrayData(o)))
+#define ArrayFloat64s(o)            ((double *)ArrayDataAddress(ArrayData(o)))
+#define ArrayBytes(o)               (ArrayDataAddress(ArrayData(o)))
+
+/* element kinds */
+#define Int64Elements               0
+#define Float64Elements             1
+#define ByteElements                2
+
+/* 'Int64Array', 'Float64Array' and 'ByteArray' dispatches */
+BobDispatch *BobInt64ArrayDispatch = NULL;
+BobDispatch *BobFloat64ArrayDispatch = NULL;
+BobDispatch *BobByteArrayDispatch = NULL;
+
+/* array methods */
+static BobValue BIF_initialize(BobInterpreter *c);
+static BobValue BIF_Sum(BobInterpreter *c);
+static BobValue BIF_Min(BobInterpreter *c);
+static BobValue BIF_Max(BobInterpreter *c);
+static BobValue BIF_Scale(BobInterpreter *c);
+static BobValue BIF_Add(BobInterpreter *c);
+static BobValue BIF_Dot(BobInterpreter *c);
+static BobValue BIF_Fill(BobInterpreter *c);
+static BobValue BIF_CopyFrom(BobInterpreter *c);
+
+static BobCMethod methods[] = {
+BobMethodEntry( "initialize",       BIF_initialize      ),
+BobMethodEntry( "Sum",              BIF_Sum             ),
+BobMethodEntry( "Min",              BIF_Min             ),
+BobMethodEntry( "Max",              BIF_Max             ),
+BobMethodEntry( "Scale",            BIF_Scale           ),
+BobMethodEntry( "Add",              BIF_Add             ),
+BobMethodEntry( "Dot",              BIF_Dot             ),
+BobMethodEntry( "Fill",             BIF_Fill            ),
+BobMethodEntry( "CopyFrom",         BIF_CopyFrom        ),
+BobMethodEntry(	0,                  0                   )
+};
+
+/* array properties */
+static BobValue BIF_size(BobInterpreter *c,BobValue obj);
+
+static BobVPMethod properties[] = {
+BobVPMethodEntry( "size",           BIF_size,           0                   ),
+BobVPMethodEntry( 0,                0,					0					)
+};
+
+/* prototypes */
+static BobDispatch *EnterArrayType(BobInterpreter *c,char *typeName);
+static int GetArrayProperty(BobInterpreter *c,BobValue obj,BobValue tag,BobValue *pValue);
+static int SetArrayProperty(BobInterpreter *c,BobValue obj,BobValue tag,BobValue value);
+static BobValue ArrayNewInstance(BobInterpreter *c,BobValue parent);
+static void ArrayScan(BobInterpreter *c,BobValue obj);
+static long ArrayDataSizeHandler(BobValue obj);
+static int ArrayKind(BobValue obj);
+static BobValue GetElement(BobInterpreter *c,BobValue obj,BobIntegerType i);
+static void SetElement(BobInterpreter *c,BobValue obj,BobIntegerType i,BobValue value);
+static long long IntegerElement(BobInterpreter *c,BobValue value);
+static double FloatElement(BobInterpreter *c,BobValue value);
+static BobValue ArrayMinMax(BobInterpreter *c,int maxP);
+static void CheckOperand(BobInterpreter *c,BobValue obj,BobValue other);
+
+/* element sizes by kind */
+static int elementSizes[] = { sizeof(long long), sizeof(double), sizeof(unsigned char) };
+
+/* ArrayData dispatch */
+static BobDispatch ArrayDataDispatch = {
+    "ArrayData",
+    &ArrayDataDispatch,
+    BobDefaultGetProperty,
+    BobDefaultSetProperty,
+    BobDefaultNewInstance,
+    BobDefaultPrint,
+    ArrayDataSizeHandler,
+    BobDefaultCopy,
+    BobDefaultScan,
+    BobDefaultHash
+};
+
+/* BobInitArrays - initialize the numeric array objects */
+void BobInitArrays(BobInterpreter *c)
+{
+    BobInt64ArrayDispatch = EnterArrayType(c,"Int64Array");
+#ifdef BOB_INCLUDE_FLOAT_SUPPORT
+    BobFloat64ArrayDispatch = EnterArrayType(c,"Float64Array");
+#endif
+    BobByteArrayDispatch = EnterArrayType(c,"ByteArray");
+}
+
+/* EnterArrayType - enter a numeric array type */
+static BobDispatch *EnterArrayType(BobInterpreter *c,char *typeName)
+{
+    BobDispatch *d;
+    if (!(d = BobEnterCObjectType(c,NULL,typeName,methods,properties,
+                                  sizeof(NumericArray) - sizeof(BobCObject))))
+        BobInsufficientMemory(c);
+    d->getProperty = GetArrayProperty;
+    d->setProperty = SetArrayProperty;
+    d->newInstance = ArrayNewInstance;
+    d->scan = ArrayScan;
+    return d;
+}
+
+/* GetArrayProperty - numeric array get property handler */
+static int GetArrayProperty(BobInterpreter *c,BobValue obj,BobValue tag,BobValue *pValue)
+{
+    if (BobIntegerP(tag)) {
+        BobIntegerType i;
+        if ((i = BobIntegerValue(tag)) < 0 || i >= ArraySize(obj))
+            BobCallErrorHandler(c,BobErrIndexOutOfBounds,tag);
+        *pValue = GetElement(c,obj,i);
+        return TRUE;
+    }
+    return BobCObjectDispatch.getProperty(c,obj,tag,pValue);
+}
+
+/* SetArrayProperty - numeric array set property handler */
+static int SetArrayProperty(BobInterpreter *c,BobValue obj,BobValue tag,BobValue value)
+{
+    if (BobIntegerP(tag)) {
+        BobIntegerType i;
+        if ((i = BobIntegerValue(tag)) < 0 || i >= ArraySize(obj))
+            BobCallErrorHandler(c,BobErrIndexOutOfBounds,tag);
+        SetElement(c,obj,i,value);
+        return TRUE;
+    }
+    return BobCObjectDispatch.setProperty(c,obj,tag,value);
+}
+
+/* ArrayNewInstance - numeric array new instance handler */
+static BobValue ArrayNewInstance(BobInterpreter *c,BobValue parent)
+{
+    BobValue obj = BobMakeCObject(c,(BobDispatch *)BobCObjectValue(parent));
+    SetArrayData(obj,c->nilValue);
+    SetArraySize(obj,0);
+    return obj;
+}
+
+/* ArrayScan - numeric array scan handler */
+static void ArrayScan(BobInterpreter *c,BobValue obj)
+{
+    BobCObjectDispatch.scan(c,obj);
+    SetArrayData(obj,BobCopyValue(c,ArrayData(obj)));
+}
+
+/* ArrayDataSizeHandler - ArrayData size handler */
+static long ArrayDataSizeHandler(BobValue obj)
+{
+    return sizeof(ArrayData) + BobRoundSize(ArrayDataSize(obj));
+}
+
+/* BIF_initialize - built-in method 'initialize' */
+static BobValue BIF_initialize(BobInterpreter *c)
+{
+    BobIntegerType size = 0,bytes;
+    BobValue obj,data;
+    BobCheckArgRange(c,2,3);
+    BobCheckType(c,1,BobNumericArrayP);
+    if (BobArgCnt(c) == 3) {
+        BobCheckType(c,3,BobIntegerP);
+        if ((size = BobIntegerValue(BobGetArg(c,3))) < 0)
+            BobCallErrorHandler(c,BobErrValueError,BobGetArg(c,3));
+    }
+    bytes = size * elementSizes[ArrayKind(BobGetArg(c,1))];
+    data = BobAllocate(c,sizeof(ArrayData) + BobRoundSize(bytes));
+    BobSetDispatch(data,&ArrayDataDispatch);
+    SetArrayDataSize(data,bytes);
+    memset(ArrayDataAddress(data),0,bytes);
+    obj = BobGetArg(c,1);
+    BobWriteBarrier(c,obj,data);
+    SetArrayData(obj,data);
+    SetArraySize(obj,size);
+    return obj;
+}
+
+/* BIF_Sum - built-in method 'Sum' */
+static BobValue BIF_Sum(BobInterpreter *c)
+{
+    BobIntegerType n,i;
+    BobValue obj;
+    BobCheckArgCnt(c,2);
+    BobCheckType(c,1,BobNumericArrayP);
+    obj = BobGetArg(c,1);
+    n = ArraySize(obj);
+    switch (ArrayKind(obj)) {
+    case Int64Elements: {
+            long long *p = ArrayInt64s(obj),sum = 0;
+            for (i = 0; i < n; ++i)
+                sum += p[i];
+            return BobMakeInteger(c,(BobIntegerType)sum);
+        }
+#ifdef BOB_INCLUDE_FLOAT_SUPPORT
+    case Float64Elements: {
+            double *p = ArrayFloat64s(obj),s0 = 0.0,s1 = 0.0,s2 = 0.0,s3 = 0.0;
+            for (i = 0; i + 4 <= n; i += 4) {
+                s0 += p[i];
+                s1 += p[i + 1];
+                s2 += p[i + 2];
+                s3 += p[i + 3];
+            }
+            for (; i < n; ++i)
+                s0 += p[i];
+            return BobMakeFloat(c,(BobFloatType)((s0 + s1) + (s2 + s3)));
+        }
+#endif
+    default: {
+            unsigned char *p = ArrayBytes(obj);
+            long long sum = 0;
+            for (i = 0; i < n; ++i)
+                sum += p[i];
+            return BobMakeInteger(c,(BobIntegerType)sum);
+        }
+    }
+}
+
+/* BIF_Min - built-in method 'Min' */
+static BobValue BIF_Min(BobInterpreter *c)
+{
+    return ArrayMinMax(c,FALSE);
+}
+
+/* BIF_Max - built-in method 'Max' */
+static BobValue BIF_Max(BobInterpreter *c)
+{
+    return ArrayMinMax(c,TRUE);
+}
+
+/* ArrayMinMax - find the smallest or largest element of an array */
+static BobValue ArrayMinMax(BobInterpreter *c,int maxP)
+{
+    BobIntegerType n,i;
+    BobValue obj;
+    BobCheckArgCnt(c,2);
+    BobCheckType(c,1,BobNumericArrayP);
+    obj = BobGetArg(c,1);
+    if ((n = ArraySize(obj)) == 0)
+        return c->nilValue;
+    switch (ArrayKind(obj)) {
+    case Int64Elements: {
+            long long *p = ArrayInt64s(obj),m = p[0];
+            if (maxP) {
+                for (i = 1; i < n; ++i)
+                    m = p[i] > m ? p[i] : m;
+            }
+            else {
+                for (i = 1; i < n; ++i)
+                    m = p[i] < m ? p[i] : m;
+            }
+            return BobMakeInteger(c,(BobIntegerType)m);
+        }
+#ifdef BOB_INCLUDE_FLOAT_SUPPORT
+    case Float64Elements: {
+            double *p = ArrayFloat64s(obj),m = p[0];
+            if (maxP) {
+                for (i = 1; i < n; ++i)
+                    m = p[i] > m ? p[i] : m;
+            }
+            else {
+                for (i = 1; i < n; ++i)
+                    m = p[i] < m ? p[i] : m;
+            }
+            return BobMakeFloat(c,(BobFloatType)m);
+        }
+#endif
+    default: {
+            unsigned char *p = ArrayBytes(obj),m = p[0];
+            if (maxP) {
+                for (i = 1; i < n; ++i)
+                    m = p[i] > m ? p[i] : m;
+            }
+            else {
+                for (i = 1; i < n; ++i)
+                    m = p[i] < m ? p[i] : m;
+            }
+            return BobMakeInteger(c,(BobIntegerType)m);
+        }
+    }
+}
+
+/* BIF_Scale - built-in method 'Scale' */
+static BobValue BIF_Scale(BobInterpreter *c)
+{
+    BobIntegerType n,i;
+    BobValue obj;
+    BobCheckArgCnt(c,3);
+    BobCheckType(c,1,BobNumericArrayP);
+    obj = BobGetArg(c,1);
+    n = ArraySize(obj);
+    switch (ArrayKind(obj)) {
+    case Int64Elements: {
+            long long *p = ArrayInt64s(obj),k = IntegerElement(c,BobGetArg(c,3));
+            for (i = 0; i < n; ++i)
+                p[i] *= k;
+            break;
+        }
+#ifdef BOB_INCLUDE_FLOAT_SUPPORT
+    case Float64Elements: {
+            double *p = ArrayFloat64s(obj),k = FloatElement(c,BobGetArg(c,3));
+            for (i = 0; i < n; ++i)
+                p[i] *= k;
+            break;
+        }
+#endif
+    default: {
+            unsigned char *p = ArrayBytes(obj);
+            unsigned char k = (unsigned char)IntegerElement(c,BobGetArg(c,3));
+            for (i = 0; i < n; ++i)
+                p[i] = (unsigned char)(p[i] * k);
+            break;
+        }
+    }
+    return obj;
+}
+
+/* BIF_Add - built-in method 'Add' */
+static BobValue BIF_Add(BobInterpreter *c)
+{
+    BobValue obj,other;
+    BobIntegerType n,i;
+    BobCheckArgCnt(c,3);
+    BobCheckType(c,1,BobNumericArrayP);
+    obj = BobGetArg(c,1);
+    other = BobGetArg(c,3);
+    n = ArraySize(obj);
+
+    /* add a number to each element */
+    if (BobNumberP(other)) {
+        switch (ArrayKind(obj)) {
+        case Int64Elements: {
+                long long *p = ArrayInt64s(obj),k = IntegerElement(c,other);
+                for (i = 0; i < n; ++i)
+                    p[i] += k;
+                break;
+            }
+#ifdef BOB_INCLUDE_FLOAT_SUPPORT
+        case Float64Elements: {
+                double *p = ArrayFloat64s(obj),k = FloatElement(c,other);
+                for (i = 0; i < n; ++i)
+                    p[i] += k;
+                break;
+            }
+#endif
+        default: {
+                unsigned char *p = ArrayBytes(obj);
+                unsigned char k = (unsigned char)IntegerElement(c,other);
+                for (i = 0; i < n; ++i)
+                    p[i] = (unsigned char)(p[i] + k);
+                break;
+            }
+        }
+    }
+
+    /* add the elements of another array */
+    else {
+        CheckOperand(c,obj,other);
+        switch (ArrayKind(obj)) {
+        case Int64Elements: {
+                long long *p = ArrayInt64s(obj),*q = ArrayInt64s(other);
+                for (i = 0; i < n; ++i)
+                    p[i] += q[i];
+                break;
+            }
+#ifdef BOB_INCLUDE_FLOAT_SUPPORT
+        case Float64Elements: {
+                double *p = ArrayFloat64s(obj),*q = ArrayFloat64s(other);
+                for (i = 0; i < n; ++i)
+                    p[i] += q[i];
+                break;
+            }
+#endif
+        default: {
+                unsigned char *p = ArrayBytes(obj),*q = ArrayBytes(other);
+                for (i = 0; i < n; ++i)
+                    p[i] = (unsigned char)(p[i] + q[i]);
+                break;
+            }
+        }
+    }
+    return obj;
+}
+
+/* BIF_Dot - built-in method 'Dot' */
+static BobValue BIF_Dot(BobInterpreter *c)
+{
+    BobValue obj,other;
+    BobIntegerType n,i;
+    BobCheckArgCnt(c,3);
+    BobCheckType(c,1,BobNumericArrayP);
+    obj = BobGetArg(c,1);
+    other = BobGetArg(c,3);
+    CheckOperand(c,obj,other);
+    n = ArraySize(obj);
+    switch (ArrayKind(obj)) {
+    case Int64Elements: {
+            long long *p = ArrayInt64s(obj),*q = ArrayInt64s(other),sum = 0;
+            for (i = 0; i < n; ++i)
+                sum += p[i] * q[i];
+            return BobMakeInteger(c,(BobIntegerType)sum);
+        }
+#ifdef BOB_INCLUDE_FLOAT_SUPPORT
+    case Float64Elements: {
+            double *p = ArrayFloat64s(obj),*q = ArrayFloat64s(other);
+            double s0 = 0.0,s1 = 0.0,s2 = 0.0,s3 = 0.0;
+            for (i = 0; i + 4 <= n; i += 4) {
+                s0 += p[i] * q[i];
+                s1 += p[i + 1] * q[i + 1];
+                s2 += p[i + 2] * q[i + 2];
+                s3 += p[i + 3] * q[i + 3];
+            }
+            for (; i < n; ++i)
+                s0 += p[i] * q[i];
+            return BobMakeFloat(c,(BobFloatType)((s0 + s1) + (s2 + s3)));
+        }
+#endif
+    default: {
+            unsigned char *p = ArrayBytes(obj),*q = ArrayBytes(other);
+            long long sum = 0;
+            for (i = 0; i < n; ++i)
+                sum += p[i] * q[i];
+            return BobMakeInteger(c,(BobIntegerType)sum);
+        }
+    }
+}
+
+/* BIF_Fill - built-in method 'Fill' */
+static BobValue BIF_Fill(BobInterpreter *c)
+{
+    BobIntegerType n,i;
+    BobValue obj;
+    BobCheckArgCnt(c,3);
+    BobCheckType(c,1,BobNumericArrayP);
+    obj = BobGetArg(c,1);
+    n = ArraySize(obj);
+    switch (ArrayKind(obj)) {
+    case Int64Elements: {
+            long long *p = ArrayInt64s(obj),k = IntegerElement(c,BobGetArg(c,3));
+            for (i = 0; i < n; ++i)
+                p[i] = k;
+            break;
+        }
+#ifdef BOB_INCLUDE_FLOAT_SUPPORT
+    case Float64Elements: {
+            double *p = ArrayFloat64s(obj),k = FloatElement(c,BobGetArg(c,3));
+            for (i = 0; i < n; ++i)
+                p[i] = k;
+            break;
+        }
+#endif
+    default:
+        if (n > 0)
+            memset(ArrayBytes(obj),(unsigned char)IntegerElement(c,BobGetArg(c,3)),n);
+        break;
+    }
+    return obj;
+}
+
+/* BIF_CopyFrom - built-in method 'CopyFrom' */
+static BobValue BIF_CopyFrom(BobInterpreter *c)
+{
+    BobIntegerType offset = 0,n,i;
+    BobValue obj,src;
+    BobCheckArgRange(c,3,4);
+    BobCheckType(c,1,BobNumericArrayP);
+    obj = BobGetArg(c,1);
+    src = BobGetArg(c,3);
+
+    /* get the offset of the first element to replace */
+    if (BobArgCnt(c) == 4) {
+        BobCheckType(c,4,BobIntegerP);
+        offset = BobIntegerValue(BobGetArg(c,4));
+        if (offset < 0 || offset > ArraySize(obj))
+            BobCallErrorHandler(c,BobErrIndexOutOfBounds,BobGetArg(c,4));
+    }
+    n = ArraySize(obj) - offset;
+
+    /* copy the elements of a vector */
+    if (BobVectorP(src)) {
+        if (BobVectorSize(src) < n)
+            n = BobVectorSize(src);
+        for (i = 0; i < n; ++i)
+            SetElement(c,obj,offset + i,BobVectorElement(src,i));
+    }
+
+    /* copy the elements of an array of the same type */
+    else if (BobNumericArrayP(src) && ArrayKind(src) == ArrayKind(obj)) {
+        int elementSize = elementSizes[ArrayKind(obj)];
+        if (ArraySize(src) < n)
+            n = ArraySize(src);
+        if (n > 0)
+            memmove(ArrayBytes(obj) + offset * elementSize,ArrayBytes(src),n * elementSize);
+    }
+
+    /* anything else is an error */
+    else
+        BobTypeError(c,src);
+    return obj;
+}
+
+/* BIF_size - built-in property 'size' */
+static BobValue BIF_size(BobInterpreter *c,BobValue obj)
+{
+    return BobMakeInteger(c,ArraySize(obj));
+}
+
+/* ArrayKind - get the kind of the elements of an array */
+static int ArrayKind(BobValue obj)
+{
+    BobDispatch *d = BobQuickGetDispatch(obj);
+    return d == BobInt64ArrayDispatch ? Int64Elements
+         : d == BobFloat64ArrayDispatch ? Float64Elements
+         : ByteElements;
+}
+
+/* GetElement - get an array element as a value */
+static BobValue GetElement(BobInterpreter *c,BobValue obj,BobIntegerType i)
+{
+    switch (ArrayKind(obj)) {
+    case Int64Elements:
+        return BobMakeInteger(c,(BobIntegerType)ArrayInt64s(obj)[i]);
+#ifdef BOB_INCLUDE_FLOAT_SUPPORT
+    case Float64Elements:
+        return BobMakeFloat(c,(BobFloatType)ArrayFloat64s(obj)[i]);
+#endif
+    default:
+        return BobMakeInteger(c,(BobIntegerType)ArrayBytes(obj)[i]);
+    }
+}
+
+/* SetElement - set an array element from a value */
+static void SetElement(BobInterpreter *c,BobValue obj,BobIntegerType i,BobValue value)
+{
+    switch (ArrayKind(obj)) {
+    case Int64Elements:
+        ArrayInt64s(obj)[i] = IntegerElement(c,value);
+        break;
+#ifdef BOB_INCLUDE_FLOAT_SUPPORT
+    case Float64Elements:
+        ArrayFloat64s(obj)[i] = FloatElement(c,value);
+        break;
+#endif
+    default:
+        ArrayBytes(obj)[i] = (unsigned char)IntegerElement(c,value);
+        break;
+    }
+}
+
+/* IntegerElement - get the value of an integer element */
+static long long IntegerElement(BobInterpreter *c,BobValue value)
+{
+    if (!BobIntegerP(value))
+        BobTypeError(c,value);
+    return (long long)BobIntegerValue(value);
+}
+
+/* FloatElement - get the value of a float element */
+static double FloatElement(BobInterpreter *c,BobValue value)
+{
+    if (BobIntegerP(value))
+        return (double)BobIntegerValue(value);
+#ifdef BOB_INCLUDE_FLOAT_SUPPORT
+    else if (BobFloatP(value))
+        return (double)BobFloatValue(value);
+#endif
+    BobTypeError(c,value);
+    return 0.0; /* never reached */
+}
+
+/* CheckOperand - check that an operand is an array of the same type and size */
+static void CheckOperand(BobInterpreter *c,BobValue obj,BobValue other)
+{
+    if (!BobNumericArrayP(other) || ArrayKind(other) != ArrayKind(obj))
+        BobTypeError(c,other);
+    if (ArraySize(other) != ArraySize(obj))
+        BobCallErrorHandler(c,BobErrValueError,other);
+}
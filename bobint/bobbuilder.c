@@ -0,0 +1,187 @@
+/* bobbuilder.c - 'StringBuilder' handler */
+/*
+        Copyright (c) 2001, by David Michael Betz
+        All rights reserved
+*/
+
+/*
+    A string builder collects text in a buffer that doubles in size when
+    it fills up so building a string with a series of appends takes time
+    proportional to the length of the result instead of copying the whole
+    string on every append the way 's = s + piece' does.  The buffer is
+    a string on the heap that is only used by the builder.  'toString'
+    copies the text into a new string.
+
+    Values that aren't strings are appended the same way 'toString'
+    formats them.
+*/
+
+#include <string.h>
+#include "bob.h"
+
+/* string builder structure */
+typedef struct {
+    BobCObject hdr;
+    BobValue buffer;                /* string holding the text or nil */
+    BobIntegerType length;          /* number of bytes in use */
+} StringBuilder;
+
+#define BuilderBuffer(o)            (((StringBuilder *)o)->buffer)
+#define SetBuilderBuffer(o,v)       (((StringBuilder *)o)->buffer = (v))
+#define BuilderLength(o)            (((StringBuilder *)o)->length)
+#define SetBuilderLength(o,v)       (((StringBuilder *)o)->length = (v))
+#define BuilderCapacity(c,o)        (BuilderBuffer(o) == (c)->nilValue ? 0 : BobStringSize(BuilderBuffer(o)))
+
+/* minimum size of a string builder buffer */
+#define BuilderMinimumCapacity      32
+
+/* 'StringBuilder' dispatch */
+BobDispatch *BobStringBuilderDispatch = NULL;
+
+/* StringBuilder methods */
+static BobValue BIF_initialize(BobInterpreter *c);
+static BobValue BIF_Append(BobInterpreter *c);
+static BobValue BIF_Clear(BobInterpreter *c);
+static BobValue BIF_toString(BobInterpreter *c);
+
+static BobCMethod methods[] = {
+BobMethodEntry( "initialize",       BIF_initialize      ),
+BobMethodEntry( "Append",           BIF_Append          ),
+BobMethodEntry( "Clear",            BIF_Clear           ),
+BobMethodEntry( "toString",         BIF_toString        ),
+BobMethodEntry(	0,                  0                   )
+};
+
+/* StringBuilder properties */
+static BobValue BIF_size(BobInterpreter *c,BobValue obj);
+
+static BobVPMethod properties[] = {
+BobVPMethodEntry( "size",           BIF_size,           0                   ),
+BobVPMethodEntry( 0,                0,					0					)
+};
+
+/* prototypes */
+static BobValue StringBuilderNewInstance(BobInterpreter *c,BobValue parent);
+static void StringBuilderScan(BobInterpreter *c,BobValue obj);
+static void Reserve(BobInterpreter *c,BobIntegerType n);
+
+/* BobInitStringBuilder - initialize the 'StringBuilder' object */
+void BobInitStringBuilder(BobInterpreter *c)
+{
+    if (!(BobStringBuilderDispatch = BobEnterCObjectType(c,NULL,"StringBuilder",methods,properties,
+                                                         sizeof(StringBuilder) - sizeof(BobCObject))))
+        BobInsufficientMemory(c);
+    BobStringBuilderDispatch->newInstance = StringBuilderNewInstance;
+    BobStringBuilderDispatch->scan = StringBuilderScan;
+}
+
+/* StringBuilderNewInstance - StringBuilder new instance handler */
+static BobValue StringBuilderNewInstance(BobInterpreter *c,BobValue parent)
+{
+    BobValue obj = BobMakeCObject(c,BobStringBuilderDispatch);
+    SetBuilderBuffer(obj,c->nilValue);
+    SetBuilderLength(obj,0);
+    return obj;
+}
+
+/* StringBuilderScan - StringBuilder scan handler */
+static void StringBuilderScan(BobInterpreter *c,BobValue obj)
+{
+    BobCObjectDispatch.scan(c,obj);
+    SetBuilderBuffer(obj,BobCopyValue(c,BuilderBuffer(obj)));
+}
+
+/* BIF_initialize - built-in method 'initialize' */
+static BobValue BIF_initialize(BobInterpreter *c)
+{
+    BobValue obj;
+    long size = 0;
+    BobParseArguments(c,"V=*|l",&obj,BobStringBuilderDispatch,&size);
+    if (size > 0)
+        Reserve(c,size);
+    return BobGetArg(c,1);
+}
+
+/* BIF_Append - built-in method 'Append' */
+static BobValue BIF_Append(BobInterpreter *c)
+{
+    BobValue obj,val;
+    int i;
+    BobCheckArgMin(c,2);
+    BobCheckType(c,1,BobStringBuilderP);
+    for (i = 3; i <= BobArgCnt(c); ++i) {
+        val = BobGetArg(c,i);
+
+        /* append a string directly */
+        if (BobStringP(val)) {
+            BobIntegerType size = BobStringSize(val);
+            Reserve(c,size);
+            obj = BobGetArg(c,1);
+            memcpy(BobStringAddress(BuilderBuffer(obj)) + BuilderLength(obj),
+                   BobStringAddress(BobGetArg(c,i)),
+                   size);
+            SetBuilderLength(obj,BuilderLength(obj) + size);
+        }
+
+        /* format anything else */
+        else {
+            BobStringOutputStream s;
+            unsigned char buf[1024];
+            BobInitStringOutputStream(c,&s,buf,sizeof(buf));
+            BobDisplay(c,val,(BobStream *)&s);
+            Reserve(c,s.len);
+            obj = BobGetArg(c,1);
+            memcpy(BobStringAddress(BuilderBuffer(obj)) + BuilderLength(obj),buf,s.len);
+            SetBuilderLength(obj,BuilderLength(obj) + s.len);
+        }
+    }
+    return BobGetArg(c,1);
+}
+
+/* BIF_Clear - built-in method 'Clear' */
+static BobValue BIF_Clear(BobInterpreter *c)
+{
+    BobValue obj;
+    BobParseArguments(c,"V=*",&obj,BobStringBuilderDispatch);
+    SetBuilderLength(obj,0);
+    return obj;
+}
+
+/* BIF_toString - built-in method 'toString' */
+static BobValue BIF_toString(BobInterpreter *c)
+{
+    BobValue obj,str;
+    BobParseArguments(c,"V=*",&obj,BobStringBuilderDispatch);
+    str = BobMakeString(c,NULL,BuilderLength(obj));
+    obj = BobGetArg(c,1);
+    if (BuilderLength(obj) > 0)
+        memcpy(BobStringAddress(str),BobStringAddress(BuilderBuffer(obj)),BuilderLength(obj));
+    return str;
+}
+
+/* BIF_size - built-in property 'size' */
+static BobValue BIF_size(BobInterpreter *c,BobValue obj)
+{
+    return BobMakeInteger(c,BuilderLength(obj));
+}
+
+/* Reserve - make room for 'n' more bytes in the builder passed as the first argument */
+static void Reserve(BobInterpreter *c,BobIntegerType n)
+{
+    BobValue obj = BobGetArg(c,1),buffer;
+    BobIntegerType capacity = BuilderCapacity(c,obj);
+    BobIntegerType needed = BuilderLength(obj) + n;
+    if (needed > capacity) {
+        capacity *= 2;
+        if (capacity < BuilderMinimumCapacity)
+            capacity = BuilderMinimumCapacity;
+        if (capacity < needed)
+            capacity = needed;
+        buffer = BobMakeString(c,NULL,capacity);
+        obj = BobGetArg(c,1);
+        if (BuilderLength(obj) > 0)
+            memcpy(BobStringAddress(buffer),BobStringAddress(BuilderBuffer(obj)),BuilderLength(obj));
+        BobWriteBarrier(c,obj,buffer);
+        SetBuilderBuffer(obj,buffer);
+    }
+}
@@ -19,6 +19,7 @@ static BobValue CObjectNewInstance(BobInterpreter *c,BobValue parent);
 static BobValue CPtrObjectNewInstance(BobInterpreter *c,BobValue parent);
 static long CObjectSize(BobValue obj);
 static void CObjectScan(BobInterpreter *c,BobValue obj);
+static void QueueFinalizer(BobInterpreter *c,BobValue obj);
 
 /* CObject dispatch */
 BobDispatch BobCObjectDispatch = {
@@ -89,6 +90,7 @@ static int SetCObjectProperty(BobInterpreter *c,BobValue obj,BobValue tag,BobVal
 
     /* look for a local property */
     if ((p = BobFindProperty(c,obj,tag,&hashValue,&i)) != NULL) {
+        BobWriteBarrier(c,p,value);
 		BobSetPropertyValue(p,value);
         return TRUE;
     }
@@ -149,8 +151,14 @@ static long CObjectSize(BobValue obj)
 /* CObjectScan - CObject scan handler */
 static void CObjectScan(BobInterpreter *c,BobValue obj)
 {
-    SetCObjectNext(obj,c->newSpace->cObjects);
-    c->newSpace->cObjects = obj;
+    /* only objects just copied to new space are linked (closing a region also scans older objects) */
+    if (!c->heapVisitor
+    &&  BobQuickGetDispatch(obj)->destroy
+    &&  (unsigned char *)obj >= c->newSpace->base
+    &&  (unsigned char *)obj < c->newSpace->top) {
+        SetCObjectNext(obj,c->newSpace->cObjects);
+        c->newSpace->cObjects = obj;
+    }
     BobObjectDispatch.scan(c,obj);
 }
 
@@ -201,8 +209,12 @@ BobValue BobMakeCObject(BobInterpreter *c,BobDispatch *d)
     BobValue new;
     new = BobAllocate(c,sizeof(BobCObject) + d->dataSize);
     BobSetDispatch(new,d);
-    SetCObjectNext(new,c->newSpace->cObjects);
-    c->newSpace->cObjects = new;
+    if (d->destroy) {
+        SetCObjectNext(new,c->newSpace->cObjects);
+        c->newSpace->cObjects = new;
+    }
+    else
+        SetCObjectNext(new,NULL);
     BobSetObjectClass(new,c->nilValue);
     BobSetObjectProperties(new,c->nilValue);
     BobSetObjectPropertyCount(new,0);
@@ -217,42 +229,119 @@ BobValue BobMakeCPtrObject(BobInterpreter *c,BobDispatch *d,void *ptr)
     return new;
 }
 
-/* BobDestroyUnreachableCObjects - destroy unreachable cobjects */
+/* BobDestroyUnreachableCObjects - queue the unreachable cobjects to be destroyed */
 void BobDestroyUnreachableCObjects(BobInterpreter *c)
 {
     BobValue obj = c->oldSpace->cObjects;
     while (obj != NULL) {
-        if (!BobBrokenHeartP(obj)) {
-            BobDispatch *d = BobQuickGetDispatch(obj);
-            if (d->destroy) {
-				void *value = BobCObjectValue(obj);
-                if (value)
-					(*d->destroy)(c,obj);
-			}
-        }
+        if (!BobBrokenHeartP(obj) && BobCObjectValue(obj))
+            QueueFinalizer(c,obj);
         obj = CObjectNext(obj);
     }
     c->oldSpace->cObjects = NULL;
 }
 
+/* QueueFinalizer - add a copy of an unreachable cobject to the finalize queue */
+static void QueueFinalizer(BobInterpreter *c,BobValue obj)
+{
+    long size = CObjectSize(obj);
+
+    /* expand the queue if necessary */
+    if (c->finalizeQueueUsed + size > c->finalizeQueueSize) {
+        long newSize = c->finalizeQueueSize ? c->finalizeQueueSize * 2 : 1024;
+        unsigned char *newQueue;
+        while (c->finalizeQueueUsed + size > newSize)
+            newSize *= 2;
+
+        /* destroy the object right away if the queue can't be expanded */
+        if ((newQueue = (unsigned char *)BobAlloc(c,newSize)) == NULL) {
+            (*BobQuickGetDispatch(obj)->destroy)(c,obj);
+            return;
+        }
+        if (c->finalizeQueue) {
+            memcpy(newQueue,c->finalizeQueue,c->finalizeQueueUsed);
+            BobFree(c,c->finalizeQueue);
+        }
+        c->finalizeQueue = newQueue;
+        c->finalizeQueueSize = newSize;
+    }
+
+    /* the old space is reused by the next collection so save a copy */
+    memcpy(c->finalizeQueue + c->finalizeQueueUsed,obj,size);
+    c->finalizeQueueUsed += size;
+}
+
+/* BobRunFinalizers - destroy the queued unreachable cobjects */
+void BobRunFinalizers(BobInterpreter *c)
+{
+    unsigned char *queue = c->finalizeQueue,*p;
+    long used = c->finalizeQueueUsed,size = c->finalizeQueueSize;
+
+    /* take the queue so destroy handlers that allocate can queue more */
+    c->finalizeQueue = NULL;
+    c->finalizeQueueSize = c->finalizeQueueUsed = 0;
+
+    /* destroy each object */
+    for (p = queue; p < queue + used; ) {
+        BobValue obj = (BobValue)p;
+        p += CObjectSize(obj);
+        (*BobQuickGetDispatch(obj)->destroy)(c,obj);
+    }
+
+    /* reuse the queue buffer if no more objects have been queued */
+    if (queue) {
+        if (c->finalizeQueue == NULL) {
+            c->finalizeQueue = queue;
+            c->finalizeQueueSize = size;
+        }
+        else
+            BobFree(c,queue);
+    }
+}
+
+/* BobTakeRegionCObjects - remove the cobjects allocated after a mark from the cobject list */
+BobValue BobTakeRegionCObjects(BobInterpreter *c,unsigned char *mark)
+{
+    BobValue list = c->newSpace->cObjects,obj = list,last = NULL;
+
+    /* the newest cobjects are at the start of the list */
+    while (obj != NULL && (unsigned char *)obj >= mark) {
+        last = obj;
+        obj = CObjectNext(obj);
+    }
+    c->newSpace->cObjects = obj;
+
+    /* return the region's cobjects */
+    if (last == NULL)
+        return NULL;
+    SetCObjectNext(last,NULL);
+    return list;
+}
+
 /* BobDestroyAllCObjects - destroy all cobjects */
 void BobDestroyAllCObjects(BobInterpreter *c)
 {
-    BobValue obj = c->newSpace->cObjects;
-    while (obj != NULL) {
-        if (!BobBrokenHeartP(obj)) {
-            BobDispatch *d = BobQuickGetDispatch(obj);
-            if (d->destroy) {
-				void *value = BobCObjectValue(obj);
-                if (value) {
-					(*d->destroy)(c,value);
-                    BobSetCObjectValue(obj,NULL);
-                }
-			}
+    BobValue obj;
+
+    /* destroy the unreachable cobjects */
+    BobRunFinalizers(c);
+
+    /* destroy the cobjects that are still reachable (including any made by the finalizers) */
+    for (obj = c->newSpace->cObjects; obj != NULL; ) {
+        if (!BobBrokenHeartP(obj) && BobCObjectValue(obj)) {
+            (*BobQuickGetDispatch(obj)->destroy)(c,obj);
+            BobSetCObjectValue(obj,NULL);
         }
         obj = CObjectNext(obj);
     }
     c->newSpace->cObjects = NULL;
+
+    /* free the finalize queue */
+    if (c->finalizeQueue) {
+        BobFree(c,c->finalizeQueue);
+        c->finalizeQueue = NULL;
+        c->finalizeQueueSize = 0;
+    }
 }
 
 /* VIRTUAL PROPERTY METHOD */
@@ -0,0 +1,399 @@
+/* bobdict.c - 'Dictionary' handler */
+/*
+        Copyright (c) 2001, by David Michael Betz
+        All rights reserved
+*/
+
+/*
+    A dictionary maps keys to values using a flat open addressed hash
+    table with linear probing.  The table doubles in size whenever it
+    becomes half full so it keeps working well no matter how many entries
+    are added.  Removing an entry shifts back the entries that follow it
+    so there are no deleted markers to slow down later searches.
+
+    Keys are compared the same way '==' compares them.  Integers, floats,
+    strings and symbols are hashed by value.  Other objects are hashed by
+    address so a dictionary that holds any of them is rehashed the first
+    time it's used after each collection.  Any value other than nil can
+    be used as a key.
+
+    Unlike the properties of an object, the entries of a dictionary are
+    only reached through its methods so a key never finds something
+    inherited from the dictionary's class and never hides a method.
+*/
+
+#include <string.h>
+#include <limits.h>
+#include "bob.h"
+
+/* dictionary structure */
+typedef struct {
+    BobCObject hdr;
+    BobValue entries;               /* key/value pairs or nil */
+    BobIntegerType count;           /* number of entries */
+    BobIntegerType addressKeys;     /* number of keys hashed by address */
+    BobIntegerType rehashP;         /* keys have moved since the table was hashed */
+} Dictionary;
+
+#define DictionaryEntries(o)        (((Dictionary *)o)->entries)
+#define SetDictionaryEntries(o,v)   (((Dictionary *)o)->entries = (v))
+#define DictionaryCount(o)          (((Dictionary *)o)->count)
+#define SetDictionaryCount(o,v)     (((Dictionary *)o)->count = (v))
+#define DictionaryAddressKeys(o)    (((Dictionary *)o)->addressKeys)
+#define SetDictionaryAddressKeys(o,v) (((Dictionary *)o)->addressKeys = (v))
+#define DictionaryRehashP(o)        (((Dictionary *)o)->rehashP)
+#define SetDictionaryRehashP(o,v)   (((Dictionary *)o)->rehashP = (v))
+#define DictionaryCapacity(o)       (BobBasicVectorSize(DictionaryEntries(o)) / 2)
+
+/* initial number of entries in a dictionary (power of 2) */
+#define DictionaryInitialSize       8
+
+/* 'Dictionary' dispatch */
+BobDispatch *BobDictionaryDispatch = NULL;
+
+/* Dictionary methods */
+static BobValue BIF_initialize(BobInterpreter *c);
+static BobValue BIF_Get(BobInterpreter *c);
+static BobValue BIF_Set(BobInterpreter *c);
+static BobValue BIF_Remove(BobInterpreter *c);
+static BobValue BIF_Exists(BobInterpreter *c);
+static BobValue BIF_Keys(BobInterpreter *c);
+static BobValue BIF_Values(BobInterpreter *c);
+static BobValue BIF_Clear(BobInterpreter *c);
+
+static BobCMethod methods[] = {
+BobMethodEntry( "initialize",       BIF_initialize      ),
+BobMethodEntry( "Get",              BIF_Get             ),
+BobMethodEntry( "Set",              BIF_Set             ),
+BobMethodEntry( "Remove",           BIF_Remove          ),
+BobMethodEntry( "Exists",           BIF_Exists          ),
+BobMethodEntry( "Keys",             BIF_Keys            ),
+BobMethodEntry( "Values",           BIF_Values          ),
+BobMethodEntry( "Clear",            BIF_Clear           ),
+BobMethodEntry(	0,                  0                   )
+};
+
+/* Dictionary properties */
+static BobValue BIF_size(BobInterpreter *c,BobValue obj);
+
+static BobVPMethod properties[] = {
+BobVPMethodEntry( "size",           BIF_size,           0                   ),
+BobVPMethodEntry( 0,                0,					0					)
+};
+
+/* prototypes */
+static BobValue DictionaryNewInstance(BobInterpreter *c,BobValue parent);
+static void DictionaryScan(BobInterpreter *c,BobValue obj);
+static BobValue PrepareTable(BobInterpreter *c,BobValue table,BobValue *pKey,int growP);
+static BobValue *FindEntry(BobInterpreter *c,BobValue table,BobValue key);
+static void RemoveEntry(BobInterpreter *c,BobValue table,BobValue *p);
+static BobValue MakeEntryVector(BobInterpreter *c,int valuesP);
+static int AddressKeyP(BobValue key);
+static unsigned long KeyHash(BobValue key);
+
+/* DictionaryEntries dispatch */
+static BobDispatch DictionaryEntriesDispatch = {
+    "DictionaryEntries",
+    &DictionaryEntriesDispatch,
+    BobDefaultGetProperty,
+    BobDefaultSetProperty,
+    BobDefaultNewInstance,
+    BobDefaultPrint,
+    BobBasicVectorSizeHandler,
+    BobDefaultCopy,
+    BobBasicVectorScanHandler,
+    BobDefaultHash
+};
+
+/* BobInitDictionary - initialize the 'Dictionary' object */
+void BobInitDictionary(BobInterpreter *c)
+{
+    if (!(BobDictionaryDispatch = BobEnterCObjectType(c,NULL,"Dictionary",methods,properties,
+                                                      sizeof(Dictionary) - sizeof(BobCObject))))
+        BobInsufficientMemory(c);
+    BobDictionaryDispatch->newInstance = DictionaryNewInstance;
+    BobDictionaryDispatch->scan = DictionaryScan;
+}
+
+/* DictionaryNewInstance - Dictionary new instance handler */
+static BobValue DictionaryNewInstance(BobInterpreter *c,BobValue parent)
+{
+    BobValue obj = BobMakeCObject(c,BobDictionaryDispatch);
+    SetDictionaryEntries(obj,c->nilValue);
+    SetDictionaryCount(obj,0);
+    SetDictionaryAddressKeys(obj,0);
+    SetDictionaryRehashP(obj,FALSE);
+    return obj;
+}
+
+/* DictionaryScan - Dictionary scan handler */
+static void DictionaryScan(BobInterpreter *c,BobValue obj)
+{
+    BobCObjectDispatch.scan(c,obj);
+    SetDictionaryEntries(obj,BobCopyValue(c,DictionaryEntries(obj)));
+    if (!c->heapVisitor && DictionaryAddressKeys(obj) > 0)
+        SetDictionaryRehashP(obj,TRUE);
+}
+
+/* BIF_initialize - built-in method 'initialize' */
+static BobValue BIF_initialize(BobInterpreter *c)
+{
+    BobIntegerType capacity = DictionaryInitialSize;
+    BobValue obj,entries;
+    long size = 0;
+    BobParseArguments(c,"V=*|l",&obj,BobDictionaryDispatch,&size);
+    while (capacity < size * 2)
+        capacity *= 2;
+    BobCPush(c,obj);
+    entries = BobMakeBasicVector(c,&DictionaryEntriesDispatch,capacity * 2);
+    obj = BobPop(c);
+    BobWriteBarrier(c,obj,entries);
+    SetDictionaryEntries(obj,entries);
+    SetDictionaryCount(obj,0);
+    SetDictionaryAddressKeys(obj,0);
+    SetDictionaryRehashP(obj,FALSE);
+    return obj;
+}
+
+/* BIF_Get - built-in method 'Get' */
+static BobValue BIF_Get(BobInterpreter *c)
+{
+    BobValue table,key,*p;
+    BobValue value = c->nilValue;
+    BobParseArguments(c,"V=*V|V",&table,BobDictionaryDispatch,&key,&value);
+    table = PrepareTable(c,table,&key,FALSE);
+    if (DictionaryEntries(table) == c->nilValue || key == c->nilValue)
+        return BobArgCnt(c) > 3 ? BobGetArg(c,4) : c->nilValue;
+    p = FindEntry(c,table,key);
+    if (p[0] == c->nilValue)
+        return BobArgCnt(c) > 3 ? BobGetArg(c,4) : c->nilValue;
+    return p[1];
+}
+
+/* BIF_Set - built-in method 'Set' */
+static BobValue BIF_Set(BobInterpreter *c)
+{
+    BobValue table,key,value,*p;
+    BobParseArguments(c,"V=*VV",&table,BobDictionaryDispatch,&key,&value);
+    if (key == c->nilValue)
+        BobTypeError(c,key);
+    table = PrepareTable(c,table,&key,TRUE);
+    value = BobGetArg(c,4);
+    p = FindEntry(c,table,key);
+    BobWriteBarrier(c,DictionaryEntries(table),key);
+    BobWriteBarrier(c,DictionaryEntries(table),value);
+    if (p[0] == c->nilValue) {
+        p[0] = key;
+        SetDictionaryCount(table,DictionaryCount(table) + 1);
+        if (AddressKeyP(key))
+            SetDictionaryAddressKeys(table,DictionaryAddressKeys(table) + 1);
+    }
+    p[1] = value;
+    return value;
+}
+
+/* BIF_Remove - built-in method 'Remove' */
+static BobValue BIF_Remove(BobInterpreter *c)
+{
+    BobValue table,key,*p;
+    BobParseArguments(c,"V=*V",&table,BobDictionaryDispatch,&key);
+    table = PrepareTable(c,table,&key,FALSE);
+    if (DictionaryEntries(table) == c->nilValue || key == c->nilValue)
+        return c->falseValue;
+    p = FindEntry(c,table,key);
+    if (p[0] == c->nilValue)
+        return c->falseValue;
+    RemoveEntry(c,table,p);
+    return c->trueValue;
+}
+
+/* BIF_Exists - built-in method 'Exists' */
+static BobValue BIF_Exists(BobInterpreter *c)
+{
+    BobValue table,key;
+    BobParseArguments(c,"V=*V",&table,BobDictionaryDispatch,&key);
+    table = PrepareTable(c,table,&key,FALSE);
+    if (DictionaryEntries(table) == c->nilValue || key == c->nilValue)
+        return c->falseValue;
+    return BobToBoolean(c,FindEntry(c,table,key)[0] != c->nilValue);
+}
+
+/* BIF_Keys - built-in method 'Keys' */
+static BobValue BIF_Keys(BobInterpreter *c)
+{
+    BobValue table;
+    BobParseArguments(c,"V=*",&table,BobDictionaryDispatch);
+    return MakeEntryVector(c,FALSE);
+}
+
+/* BIF_Values - built-in method 'Values' */
+static BobValue BIF_Values(BobInterpreter *c)
+{
+    BobValue table;
+    BobParseArguments(c,"V=*",&table,BobDictionaryDispatch);
+    return MakeEntryVector(c,TRUE);
+}
+
+/* BIF_Clear - built-in method 'Clear' */
+static BobValue BIF_Clear(BobInterpreter *c)
+{
+    BobValue table;
+    BobParseArguments(c,"V=*",&table,BobDictionaryDispatch);
+    SetDictionaryEntries(table,c->nilValue);
+    SetDictionaryCount(table,0);
+    SetDictionaryAddressKeys(table,0);
+    SetDictionaryRehashP(table,FALSE);
+    return table;
+}
+
+/* BIF_size - built-in property 'size' */
+static BobValue BIF_size(BobInterpreter *c,BobValue obj)
+{
+    return BobMakeInteger(c,DictionaryCount(obj));
+}
+
+/* MakeEntryVector - make a vector of the keys or values of the dictionary passed as the first argument */
+static BobValue MakeEntryVector(BobInterpreter *c,int valuesP)
+{
+    BobValue table = BobGetArg(c,1),vector,*p,*q;
+    BobIntegerType i;
+    vector = BobMakeVector(c,DictionaryCount(table));
+    table = BobGetArg(c,1);
+    if (DictionaryEntries(table) != c->nilValue) {
+        p = BobBasicVectorAddress(DictionaryEntries(table));
+        q = BobVectorAddress(vector);
+        for (i = BobBasicVectorSize(DictionaryEntries(table)); (i -= 2) >= 0; p += 2)
+            if (p[0] != c->nilValue)
+                *q++ = valuesP ? p[1] : p[0];
+    }
+    return vector;
+}
+
+/* PrepareTable - rehash or grow a table before it is used */
+static BobValue PrepareTable(BobInterpreter *c,BobValue table,BobValue *pKey,int growP)
+{
+    BobValue entries = DictionaryEntries(table),newEntries,*p;
+    BobIntegerType capacity,i;
+
+    /* find the new capacity */
+    if (entries == c->nilValue) {
+        if (!growP)
+            return table;
+        capacity = DictionaryInitialSize;
+    }
+    else {
+        capacity = DictionaryCapacity(table);
+        if (growP && (DictionaryCount(table) + 1) * 2 > capacity)
+            capacity *= 2;
+        else if (!DictionaryRehashP(table))
+            return table;
+    }
+
+    /* make the new entry vector */
+    BobCheck(c,2);
+    BobPush(c,table);
+    BobPush(c,*pKey);
+    newEntries = BobMakeBasicVector(c,&DictionaryEntriesDispatch,capacity * 2);
+    *pKey = BobPop(c);
+    table = BobPop(c);
+
+    /* move the entries to the new vector */
+    entries = DictionaryEntries(table);
+    BobWriteBarrier(c,table,newEntries);
+    SetDictionaryEntries(table,newEntries);
+    SetDictionaryRehashP(table,FALSE);
+    if (entries != c->nilValue) {
+        BobValue *q = BobBasicVectorAddress(entries);
+        for (i = BobBasicVectorSize(entries); (i -= 2) >= 0; q += 2) {
+            if (q[0] != c->nilValue) {
+                p = FindEntry(c,table,q[0]);
+                p[0] = q[0];
+                p[1] = q[1];
+            }
+        }
+    }
+    return table;
+}
+
+/* FindEntry - find the entry for a key or the empty entry where it belongs */
+static BobValue *FindEntry(BobInterpreter *c,BobValue table,BobValue key)
+{
+    BobValue *entries = BobBasicVectorAddress(DictionaryEntries(table)),entryKey;
+    unsigned long mask = (unsigned long)DictionaryCapacity(table) - 1;
+    unsigned long i = KeyHash(key) & mask;
+    int addressP = AddressKeyP(key);
+    while ((entryKey = entries[i * 2]) != c->nilValue) {
+        if (entryKey == key || (!addressP && BobEql(entryKey,key)))
+            break;
+        i = (i + 1) & mask;
+    }
+    return &entries[i * 2];
+}
+
+/* RemoveEntry - remove an entry shifting back the entries that follow it */
+static void RemoveEntry(BobInterpreter *c,BobValue table,BobValue *p)
+{
+    BobValue *entries = BobBasicVectorAddress(DictionaryEntries(table));
+    unsigned long mask = (unsigned long)DictionaryCapacity(table) - 1;
+    unsigned long i = (p - entries) / 2,j = i,home;
+    if (AddressKeyP(p[0]))
+        SetDictionaryAddressKeys(table,DictionaryAddressKeys(table) - 1);
+    for (;;) {
+        j = (j + 1) & mask;
+        if (entries[j * 2] == c->nilValue)
+            break;
+        home = KeyHash(entries[j * 2]) & mask;
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            entries[i * 2] = entries[j * 2];
+            entries[i * 2 + 1] = entries[j * 2 + 1];
+            i = j;
+        }
+    }
+    entries[i * 2] = c->nilValue;
+    entries[i * 2 + 1] = c->nilValue;
+    SetDictionaryCount(table,DictionaryCount(table) - 1);
+}
+
+/* AddressKeyP - check for a key that is hashed by address */
+static int AddressKeyP(BobValue key)
+{
+    return !BobIntegerP(key)
+#ifdef BOB_INCLUDE_FLOAT_SUPPORT
+        && !BobFloatP(key)
+#endif
+        && !BobStringP(key)
+        && !BobSymbolP(key);
+}
+
+/* KeyHash - compute the hash of a key */
+static unsigned long KeyHash(BobValue key)
+{
+    unsigned long h;
+    if (BobIntegerP(key))
+        h = (unsigned long)BobIntegerValue(key);
+#ifdef BOB_INCLUDE_FLOAT_SUPPORT
+    else if (BobFloatP(key)) {
+        BobFloatType f = BobFloatValue(key);
+
+        /* floats that are equal to integers must hash the same way */
+        if (f > (BobFloatType)LONG_MIN && f < (BobFloatType)LONG_MAX
+        &&  (BobFloatType)(BobIntegerType)f == f)
+            h = (unsigned long)(BobIntegerType)f;
+        else {
+            unsigned char bytes[sizeof(BobFloatType)];
+            size_t i;
+            memcpy(bytes,&f,sizeof(f));
+            for (h = 0, i = 0; i < sizeof(bytes); ++i)
+                h = h * 31 + bytes[i];
+        }
+    }
+#endif
+    else if (BobStringP(key) || BobSymbolP(key))
+        h = (unsigned long)BobHashValue(key);
+    else
+        h = (unsigned long)(BobPointerType)key;
+    h ^= h >> 16;
+    h *= 0x45d9f3bUL;
+    h ^= h >> 16;
+    return h;
+}
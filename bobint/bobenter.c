@@ -9,15 +9,18 @@
 /* BobEnterVariable - add a built-in variable to the symbol table */
 void BobEnterVariable(BobInterpreter *c,char *name,BobValue value)
 {
+    BobValue sym;
     BobCPush(c,value);
-    BobSetGlobalValue(BobInternCString(c,name),BobTop(c));
+    sym = BobInternCString(c,name);
+    BobWriteBarrier(c,sym,BobTop(c));
+    BobSetGlobalValue(sym,BobTop(c));
     BobDrop(c,1);
 }
 
 /* BobEnterFunction - add a built-in function to the symbol table */
 void BobEnterFunction(BobInterpreter *c,BobCMethod *function)
 {
-    BobSetGlobalValue(BobInternCString(c,function->name),(BobValue)function);
+    BobEnterVariable(c,function->name,(BobValue)function);
 }
 
 /* BobEnterFunctions - add built-in functions to the symbol table */
@@ -33,7 +36,7 @@ BobValue BobEnterObject(BobInterpreter *c,char *name,BobValue parent,BobCMethod
     /* make the object and set the symbol value */
     if (name) {
 		BobCPush(c,BobMakeObject(c,parent));
-		BobSetGlobalValue(BobInternCString(c,name),BobTop(c));
+		BobEnterVariable(c,name,BobTop(c));
 	}
 	else
 		BobCPush(c,BobMakeObject(c,parent));
@@ -56,7 +59,7 @@ BobDispatch *BobEnterCObjectType(BobInterpreter *c,BobDispatch *parent,char *typ
         return NULL;
 
 	/* add the type symbol */
-    BobSetGlobalValue(BobInternCString(c,typeName),d->object);
+    BobEnterVariable(c,typeName,d->object);
 
     /* return the new object type */
     return d;
@@ -72,7 +75,7 @@ BobDispatch *BobEnterCPtrObjectType(BobInterpreter *c,BobDispatch *parent,char *
         return NULL;
 
 	/* add the type symbol */
-    BobSetGlobalValue(BobInternCString(c,typeName),d->object);
+    BobEnterVariable(c,typeName,d->object);
 
     /* return the new object type */
     return d;
@@ -46,6 +46,8 @@ static ErrString errStrings[] = {
 {       BobErrNotAnObjectFile,      "Not an object file - %s"               },
 {       BobErrWrongObjectVersion,   "Wrong object file version number - %i" },
 {       BobErrValueError,           "Bad value - %V"                        },
+{       BobErrFrozenObject,         "Attempt to modify a frozen object - %V" },
+{       BobErrBadRegex,             "Bad regular expression - %s in %V"     },
 {       0,                          0                                       }
 };
 
@@ -10,11 +10,19 @@
 #include "bob.h"
 
 /* prototypes */
+static void EnterStat(BobInterpreter *c,char *name,unsigned long value);
 static BobValue BIF_Type(BobInterpreter *c);
 static BobValue BIF_Hash(BobInterpreter *c);
 static BobValue BIF_toString(BobInterpreter *c);
 static BobValue BIF_rand(BobInterpreter *c);
 static BobValue BIF_gc(BobInterpreter *c);
+static BobValue BIF_GCStats(BobInterpreter *c);
+static BobValue BIF_StartAllocProfile(BobInterpreter *c);
+static BobValue BIF_StopAllocProfile(BobInterpreter *c);
+static BobValue BIF_DumpAllocProfile(BobInterpreter *c);
+static BobValue BIF_HeapSnapshot(BobInterpreter *c);
+static BobValue BIF_SaveImage(BobInterpreter *c);
+static BobValue BIF_FreezeCode(BobInterpreter *c);
 static BobValue BIF_LoadObjectFile(BobInterpreter *c);
 static BobValue BIF_Quit(BobInterpreter *c);
 
@@ -25,6 +33,13 @@ BobMethodEntry( "Hash",             BIF_Hash            ),
 BobMethodEntry( "toString",         BIF_toString        ),
 BobMethodEntry( "rand",             BIF_rand            ),
 BobMethodEntry( "gc",               BIF_gc              ),
+BobMethodEntry( "GCStats",          BIF_GCStats         ),
+BobMethodEntry( "StartAllocProfile",BIF_StartAllocProfile),
+BobMethodEntry( "StopAllocProfile", BIF_StopAllocProfile),
+BobMethodEntry( "DumpAllocProfile", BIF_DumpAllocProfile),
+BobMethodEntry( "HeapSnapshot",     BIF_HeapSnapshot    ),
+BobMethodEntry( "SaveImage",        BIF_SaveImage       ),
+BobMethodEntry( "FreezeCode",       BIF_FreezeCode      ),
 BobMethodEntry( "LoadObjectFile",   BIF_LoadObjectFile  ),
 BobMethodEntry( "Quit",             BIF_Quit            ),
 BobMethodEntry( 0,					0					)
@@ -154,6 +169,108 @@ static BobValue BIF_gc(BobInterpreter *c)
     return c->nilValue;
 }
 
+/* BIF_GCStats - built-in function 'GCStats' */
+static BobValue BIF_GCStats(BobInterpreter *c)
+{
+    BobGCStats *stats = &c->gcStats;
+    unsigned long rate;
+    
+    /* check the argument count */
+    BobCheckArgCnt(c,2);
+
+    /* compute the allocation rate in bytes per second */
+    rate = stats->mutatorTime == 0 ? 0 :
+           (unsigned long)((double)stats->allocated * 1000000.0 / stats->mutatorTime);
+
+    /* make an object to hold the statistics */
+    BobCPush(c,BobMakeObject(c,c->objectValue));
+    EnterStat(c,"collections",c->gcCount);
+    EnterStat(c,"heapSize",stats->heapSize);
+    EnterStat(c,"usedBefore",stats->usedBefore);
+    EnterStat(c,"usedAfter",stats->usedAfter);
+    EnterStat(c,"bytesCopied",stats->usedAfter);
+    EnterStat(c,"totalCopied",stats->totalCopied);
+    EnterStat(c,"allocated",stats->allocated);
+    EnterStat(c,"allocationRate",rate);
+    EnterStat(c,"pauseTime",stats->pauseTime);
+    EnterStat(c,"totalPauseTime",stats->totalPauseTime);
+#ifdef BOB_INCLUDE_FLOAT_SUPPORT
+    {
+        BobValue ratio = BobMakeFloat(c,stats->usedBefore == 0 ? 0.0 :
+                                      (BobFloatType)stats->usedAfter / stats->usedBefore);
+        BobEnterProperty(c,BobTop(c),"survivorRatio",ratio);
+    }
+#endif
+    return BobPop(c);
+}
+
+/* EnterStat - add a statistic to the object on the top of the stack */
+static void EnterStat(BobInterpreter *c,char *name,unsigned long value)
+{
+    BobValue val = BobMakeInteger(c,(BobIntegerType)value);
+    BobEnterProperty(c,BobTop(c),name,val);
+}
+
+/* BIF_StartAllocProfile - built-in function 'StartAllocProfile' */
+static BobValue BIF_StartAllocProfile(BobInterpreter *c)
+{
+    long interval = BobProfileInterval;
+    BobParseArguments(c,"**|l",&interval);
+    if (interval < 0)
+        BobCallErrorHandler(c,BobErrValueError,BobGetArg(c,3));
+    return BobToBoolean(c,BobStartAllocProfile(c,(unsigned long)interval));
+}
+
+/* BIF_StopAllocProfile - built-in function 'StopAllocProfile' */
+static BobValue BIF_StopAllocProfile(BobInterpreter *c)
+{
+    BobCheckArgCnt(c,2);
+    BobStopAllocProfile(c);
+    return c->nilValue;
+}
+
+/* BIF_DumpAllocProfile - built-in function 'DumpAllocProfile' */
+static BobValue BIF_DumpAllocProfile(BobInterpreter *c)
+{
+    BobStream *s = c->standardOutput;
+    int foldedP = FALSE;
+    BobParseArguments(c,"**|P?=B",&s,BobFileDispatch,&foldedP);
+    if (!s)
+        s = c->standardOutput;
+    BobDumpAllocProfile(c,s,foldedP);
+    return c->nilValue;
+}
+
+/* BIF_HeapSnapshot - built-in function 'HeapSnapshot' */
+static BobValue BIF_HeapSnapshot(BobInterpreter *c)
+{
+    BobStream *s;
+    char *name;
+    int sts;
+    BobParseArguments(c,"**S",&name);
+    if ((s = BobOpenFileStream(c,name,"wb")) == NULL)
+        return c->falseValue;
+    sts = BobWriteHeapSnapshot(c,s);
+    if (BobCloseStream(s) != 0)
+        sts = FALSE;
+    return BobToBoolean(c,sts);
+}
+
+/* BIF_SaveImage - built-in function 'SaveImage' */
+static BobValue BIF_SaveImage(BobInterpreter *c)
+{
+    char *name;
+    BobParseArguments(c,"**S",&name);
+    return BobToBoolean(c,BobSaveImage(c,name));
+}
+
+/* BIF_FreezeCode - built-in function 'FreezeCode' */
+static BobValue BIF_FreezeCode(BobInterpreter *c)
+{
+    BobCheckArgCnt(c,2);
+    return BobMakeInteger(c,BobFreezeCode(c));
+}
+
 /* BIF_LoadObjectFile - built-in function 'LoadObjectFile' */
 static BobValue BIF_LoadObjectFile(BobInterpreter *c)
 {
@@ -59,9 +59,7 @@ static void EnterPort(BobInterpreter *c,char *name,BobStream **pStream)
 	BobStream *s;
 	if (!(s = BobMakeIndirectStream(c,pStream)))
         BobInsufficientMemory(c);
-    BobCPush(c,BobMakeFile(c,s));
-    BobSetGlobalValue(BobInternCString(c,name),BobTop(c));
-    BobDrop(c,1);
+    BobEnterVariable(c,name,BobMakeFile(c,s));
 }
 
 /* BobMakeFile - make a 'File' object */
@@ -0,0 +1,162 @@
+/* bobfreeze.c - frozen code segments */
+/*
+        Copyright (c) 2001, by David Michael Betz
+        All rights reserved
+*/
+
+/*
+    Freezing moves every compiled code object in the heap along with its
+    bytecodes and its string and float literals into a code segment that
+    is allocated outside of the heap.  Objects in a code segment never
+    move and are never copied by the garbage collector.  The bytecode
+    strings and literals come first in the segment and are never touched
+    again.  The compiled code objects follow them and are scanned as roots
+    by each collection since their literals can refer to heap objects
+    like symbols.  Strings in a code segment can't be modified.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "bob.h"
+
+/* prototypes */
+static void AddLiteral(BobInterpreter *c,BobValue *objects,long *pCount,BobValue obj);
+static void MoveObject(BobCodeSegment *seg,BobValue obj);
+
+/* BobFreezeCode - move the compiled code in the heap to a code segment */
+long BobFreezeCode(BobInterpreter *c)
+{
+    long maxCount = 0,dataCount = 0,codeCount = 0,size = 0,i;
+    BobValue *data,*code;
+    BobCodeSegment *seg;
+    unsigned char *scan;
+
+    /* collect the garbage so only reachable code is frozen */
+    BobCollectGarbage(c);
+
+    /* find the maximum number of objects that could be frozen */
+    for (scan = c->newSpace->base; scan < c->newSpace->free; ) {
+        BobValue obj = (BobValue)scan;
+        scan += BobQuickGetDispatch(obj)->size(obj);
+        if (BobCompiledCodeP(obj))
+            maxCount += BobBasicVectorSize(obj) + 1;
+    }
+    if (maxCount == 0)
+        return 0;
+
+    /* allocate the object lists */
+    if ((data = (BobValue *)BobAlloc(c,maxCount * sizeof(BobValue))) == NULL)
+        BobInsufficientMemory(c);
+    code = data + maxCount;
+
+    /* find the code objects and the pointer-free objects they refer to */
+    for (scan = c->newSpace->base; scan < c->newSpace->free; ) {
+        BobValue obj = (BobValue)scan;
+        scan += BobQuickGetDispatch(obj)->size(obj);
+        if (BobCompiledCodeP(obj)) {
+            for (i = 0; i < BobBasicVectorSize(obj); ++i)
+                AddLiteral(c,data,&dataCount,BobBasicVectorElement(obj,i));
+            *--code = obj;
+            ++codeCount;
+            size += BobQuickGetDispatch(obj)->size(obj);
+        }
+    }
+    for (i = 0; i < dataCount; ++i)
+        size += BobQuickGetDispatch(data[i])->size(data[i]);
+
+    /* make the code segment */
+    if ((seg = BobMakeCodeSegment(c,size)) == NULL) {
+        BobFree(c,data);
+        BobInsufficientMemory(c);
+    }
+
+    /* move the pointer-free objects followed by the code objects */
+    for (i = 0; i < dataCount; ++i)
+        MoveObject(seg,data[i]);
+    seg->code = seg->free;
+    for (i = codeCount; --i >= 0; )
+        MoveObject(seg,code[i]);
+    BobFree(c,data);
+
+    /* collect the garbage to update the references to the moved objects */
+    BobCollectGarbage(c);
+
+    /* return the size of the segment */
+    return (long)(seg->free - seg->base);
+}
+
+/* AddLiteral - add a literal to the list of pointer-free objects to freeze */
+static void AddLiteral(BobInterpreter *c,BobValue *objects,long *pCount,BobValue obj)
+{
+    if ((BobIsType(obj,&BobStringDispatch)
+#ifdef BOB_INCLUDE_FLOAT_SUPPORT
+    ||   BobFloatP(obj)
+#endif
+        )
+    &&  (unsigned char *)obj >= c->newSpace->base
+    &&  (unsigned char *)obj < c->newSpace->free)
+        objects[(*pCount)++] = obj;
+}
+
+/* MoveObject - move an object to a code segment leaving a forwarding address */
+static void MoveObject(BobCodeSegment *seg,BobValue obj)
+{
+    BobValue newObj = (BobValue)seg->free;
+    long size;
+
+    /* an object referenced more than once has already been moved */
+    if (BobBrokenHeartP(obj))
+        return;
+
+    /* copy the object */
+    size = BobQuickGetDispatch(obj)->size(obj);
+    memcpy(newObj,obj,(size_t)size);
+    seg->free += size;
+
+    /* store a forwarding address in the old object */
+    BobSetDispatch(obj,&BobBrokenHeartDispatch);
+    BobBrokenHeartSetForwardingAddr(obj,newObj);
+}
+
+/* BobFrozenP - check whether an object is in a code segment */
+int BobFrozenP(BobInterpreter *c,BobValue obj)
+{
+    BobCodeSegment *seg;
+    for (seg = c->codeSegments; seg != NULL; seg = seg->next)
+        if ((unsigned char *)obj >= seg->base && (unsigned char *)obj < seg->free)
+            return TRUE;
+    return FALSE;
+}
+
+/* BobMakeCodeSegment - make a new code segment */
+BobCodeSegment *BobMakeCodeSegment(BobInterpreter *c,long size)
+{
+    BobCodeSegment *seg;
+
+    /* allocate the segment */
+    if ((seg = (BobCodeSegment *)BobAlloc(c,sizeof(BobCodeSegment) + size)) == NULL)
+        return NULL;
+
+    /* initialize */
+    seg->base = (unsigned char *)(seg + 1);
+    seg->code = seg->base;
+    seg->free = seg->base;
+
+    /* add the segment to the segment list */
+    seg->next = c->codeSegments;
+    c->codeSegments = seg;
+
+    /* return the new segment */
+    return seg;
+}
+
+/* BobFreeCodeSegments - free the code segments */
+void BobFreeCodeSegments(BobInterpreter *c)
+{
+    BobCodeSegment *seg,*next;
+    for (seg = c->codeSegments; seg != NULL; seg = next) {
+        next = seg->next;
+        BobFree(c,seg);
+    }
+    c->codeSegments = NULL;
+}
@@ -6,6 +6,7 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include "bob.h"
 
 /* VALUE */
@@ -13,9 +14,19 @@
 #define ValueSize(o)                    (BobQuickGetDispatch(o)->size(o))
 #define ScanValue(c,o)                  (BobQuickGetDispatch(o)->scan(c,o))
 
+/* set the kind of root being visited */
+#define SetRootKind(c,k)                do { \
+                                            if ((c)->heapVisitor) \
+                                                (c)->heapVisitor->rootKind = (k); \
+                                        } while (0)
+
 /* prototypes */
 static void InitInterpreter(BobInterpreter *c);
 static BobMemorySpace *InitMemorySpace(void *buf,size_t size);
+static void CopyRoots(BobInterpreter *c);
+static void CopyRange(BobInterpreter *c,unsigned char *base,unsigned char *end,unsigned char *to);
+static void FixupCode(BobInterpreter *c);
+static unsigned long Microseconds(void);
 
 /* BobMakeInterpreter - make a new interpreter */
 BobInterpreter *BobMakeInterpreter(void *buf,size_t size,size_t stackSize)
@@ -37,11 +48,14 @@ BobInterpreter *BobMakeInterpreter(void *buf,size_t size,size_t stackSize)
     c->stackTop = c->stack + stackSize;
     c->fp = (BobFrame *)c->stackTop;
     c->sp = c->stackTop;
+    c->stackLimit = stackSize < BobDefaultStackLimit ? BobDefaultStackLimit : stackSize;
     
     /* initialize the semi-spaces */
     c->oldSpace = InitMemorySpace((char *)c->stack + stackSizeInBytes, memorySpaceSize);
     c->newSpace = InitMemorySpace((char *)c->oldSpace + memorySpaceSize, memorySpaceSize);
     c->gcCount = 0;
+    c->gcStats.heapSize = (unsigned long)(c->newSpace->top - c->newSpace->base);
+    c->gcStats.endTime = Microseconds();
         
     /* return the new interpreter context */
     return c;
@@ -73,6 +87,7 @@ BobInterpreter *BobInitInterpreter(BobInterpreter *c)
     BobSetGlobalValue(c->trueValue,c->trueValue);
     c->falseValue = c->nilValue;
     BobEnterVariable(c,"false",c->falseValue);
+    c->regexCache = c->nilValue;
 
     /* create the base of the object heirarchy */
     BobInitObject(c);
@@ -91,6 +106,12 @@ BobInterpreter *BobInitInterpreter(BobInterpreter *c)
 
     /* initialize the external types */
     BobInitFile(c);
+    BobInitWeak(c);
+    BobInitStringBuilder(c);
+    BobInitDictionary(c);
+    BobInitArrays(c);
+    BobInitSortedMap(c);
+    BobInitRegex(c);
 
     /* initialize the interpreter */
     InitInterpreter(c);
@@ -103,10 +124,11 @@ BobInterpreter *BobInitInterpreter(BobInterpreter *c)
 void BobFreeInterpreter(BobInterpreter *c)
 {
     BobProtectedPtrs *p,*nextp;
+    BobHandleBlock *hb,*nexthb;
     BobDispatch *d,*nextd;
 
     /* destroy cobjects */
-    /*BobDestroyAllCObjects(c)*/;
+    BobDestroyAllCObjects(c);
 
     /* free the type list */
     for (d = c->types; d != NULL; d = nextd) {
@@ -114,11 +136,73 @@ void BobFreeInterpreter(BobInterpreter *c)
         BobFreeDispatch(c,d);
     }
 
+    /* free the allocation profile */
+    BobStopAllocProfile(c);
+
+    /* free the frozen code segments */
+    BobFreeCodeSegments(c);
+
     /* free the protected pointer blocks */
     for (p = c->protectedPtrs; p != NULL; p = nextp) {
         nextp = p->next;
         BobFree(c,p);
     }
+
+    /* free the handle blocks */
+    for (hb = c->handleBlocks; hb != NULL; hb = nexthb) {
+        nexthb = hb->next;
+        BobFree(c,hb);
+    }
+
+    /* free the expanded stack */
+    if (c->stackMemory)
+        BobFree(c,c->stackMemory);
+
+    /* free the remembered set */
+    if (c->remembered)
+        BobFree(c,c->remembered);
+}
+
+/* BobSetStackLimit - set the maximum size of the stack (in values) */
+void BobSetStackLimit(BobInterpreter *c,size_t size)
+{
+    c->stackLimit = size;
+}
+
+/* BobExpandStack - expand the stack to make room for 'n' more values */
+void BobExpandStack(BobInterpreter *c,int n)
+{
+    BobValue *oldStack = c->stack,*oldTop = c->stackTop;
+    size_t size = oldTop - oldStack,used = oldTop - c->sp;
+    size_t needed = used + n,newSize;
+    BobValue *newStack,*newTop;
+
+    /* compute the new size */
+    if (needed > c->stackLimit)
+        BobStackOverflow(c);
+    newSize = size * 2;
+    if (newSize < needed)
+        newSize = needed;
+    if (newSize > c->stackLimit)
+        newSize = c->stackLimit;
+
+    /* allocate the new stack */
+    if ((newStack = (BobValue *)BobAlloc(c,newSize * sizeof(BobValue))) == NULL)
+        BobStackOverflow(c);
+    newTop = newStack + newSize;
+
+    /* copy the values in use to the top of the new stack */
+    memcpy(newTop - used,c->sp,used * sizeof(BobValue));
+
+    /* relocate the registers, frame links and stack environment pointers */
+    BobRelocateStack(c,oldStack,oldTop,newTop);
+
+    /* switch to the new stack */
+    if (c->stackMemory)
+        BobFree(c,c->stackMemory);
+    c->stackMemory = newStack;
+    c->stack = newStack;
+    c->stackTop = newTop;
 }
 
 /* InitInterpreter - initialize an interpreter structure */
@@ -150,26 +234,21 @@ BobValue BobAllocate(BobInterpreter *c,long size)
 {
     BobValue val;
     
-    /* look for free space */
-    if (c->newSpace->free + size <= c->newSpace->top) {
-        val = (BobValue)c->newSpace->free;
-        c->newSpace->free += size;
-        return val;
+    /* look for free space and collect garbage if there isn't enough */
+    if (c->newSpace->free + size > c->newSpace->top) {
+        BobCollectGarbage(c);
+        if (c->newSpace->free + size > c->newSpace->top)
+            BobInsufficientMemory(c);
     }
 
-    /* collect garbage */
-    BobCollectGarbage(c);
-
-    /* look again */
-    if (c->newSpace->free + size <= c->newSpace->top) {
-        val = (BobValue)c->newSpace->free;
-        c->newSpace->free += size;
-        return val;
-    }
+    /* allocate the value */
+    val = (BobValue)c->newSpace->free;
+    c->newSpace->free += size;
 
-    /* insufficient memory */
-    BobInsufficientMemory(c);
-    return c->nilValue; /* never reached */
+    /* sample the allocation when profiling */
+    if (c->allocProfile)
+        BobProfileAllocation(c,val,size);
+    return val;
 }
 
 /* BobMakeDispatch - make a new type dispatch */
@@ -206,26 +285,194 @@ void BobFreeDispatch(BobInterpreter *c,BobDispatch *d)
 /* BobCollectGarbage - garbage collect a heap */
 void BobCollectGarbage(BobInterpreter *c)
 {
-    BobProtectedPtrs *ppb;
+    BobGCStats *stats = &c->gcStats;
+    unsigned long startTime = Microseconds();
     unsigned char *scan;
     BobMemorySpace *ms;
-    BobDispatch *d;
+    BobRegion *region;
     BobValue obj;
 
-	BobStreamPutS("[GC",c->standardError);
+    /* account for the allocation since the last collection */
+    stats->usedBefore = (unsigned long)(c->newSpace->free - c->newSpace->base);
+    stats->allocated = stats->usedBefore > stats->usedAfter ? stats->usedBefore - stats->usedAfter : 0;
+    stats->mutatorTime = startTime - stats->endTime;
+
+    /* notify the event handler */
+    if (c->gcHandler)
+        (*c->gcHandler)(c,BobGCEventStart,stats,c->gcData);
+
+    if (c->gcMessages)
+        BobStreamPutS("[GC",c->standardError);
 
     /* reverse the memory spaces */
     ms = c->oldSpace;
     c->oldSpace = c->newSpace;
     c->newSpace = ms;
     ms->free = ms->base;
+
+    /* the space not needed for the old objects can be used to copy string slices */
+    c->sliceBudget = (long)((ms->top - ms->base) - (c->oldSpace->free - c->oldSpace->base));
+    
+    /* copy the root objects */
+    CopyRoots(c);
+
+    /* scan and copy until all accessible objects have been copied including
+       the values of weak table entries whose keys have been copied */
+    scan = c->newSpace->base;
+    do {
+        while (scan < c->newSpace->free) {
+            obj = (BobValue)scan;
+#if 0
+            BobStreamPutS("Scanning ",c->standardOutput);
+            BobPrint(c,obj,c->standardOutput);
+            BobStreamPutC('\n',c->standardOutput);
+#endif
+            scan += ValueSize(obj);
+            ScanValue(c,obj);
+        }
+        BobTraceWeakTables(c);
+    } while (scan < c->newSpace->free);
+
+    /* clear the weak references to objects that weren't copied */
+    BobClearWeakObjects(c);
+
+    /* objects in open regions that survived are kept and are now older than the regions */
+    for (region = c->regions; region != NULL; region = region->prev)
+        region->mark = c->newSpace->free;
+    c->rememberedCount = 0;
+    c->rememberedOverflowP = FALSE;
     
+    /* fixup cbase and pc */
+    FixupCode(c);
+    
+    /* count the garbage collections */
+    ++c->gcCount;
+
+    /* destroy any unreachable cobjects */
+    BobDestroyUnreachableCObjects(c);
+
+    /* update the statistics */
+    stats->usedAfter = (unsigned long)(c->newSpace->free - c->newSpace->base);
+    stats->totalCopied += stats->usedAfter;
+    stats->endTime = Microseconds();
+    stats->pauseTime = stats->endTime - startTime;
+    stats->totalPauseTime += stats->pauseTime;
+
+    if (c->gcMessages) {
+		char buf[128];
+		sprintf(buf,
+				" - %lu bytes free out of %lu, collections %lu]\n",
+				(unsigned long)(c->newSpace->top - c->newSpace->free),
+				(unsigned long)(c->newSpace->top - c->newSpace->base),
+				(unsigned long)c->gcCount);
+		BobStreamPutS(buf,c->standardError);
+	}
+
+    /* notify the event handler */
+    if (c->gcHandler)
+        (*c->gcHandler)(c,BobGCEventEnd,stats,c->gcData);
+}
+
+/* BobCollectRegion - free the objects allocated after a mark that can't be reached */
+int BobCollectRegion(BobInterpreter *c,unsigned char *mark)
+{
+    unsigned char *end = c->newSpace->free,*copyEnd;
+
+    /* collect everything if the survivors might not fit past the end of the region */
+    if (c->newSpace->top - end < end - mark) {
+        BobCollectGarbage(c);
+        return FALSE;
+    }
+
+    /* copy the survivors past the end of the region and then back to the mark */
+    CopyRange(c,mark,end,end);
+    copyEnd = c->newSpace->free;
+    CopyRange(c,end,copyEnd,mark);
+
+    /* return true if nothing survived */
+    return c->newSpace->free == mark;
+}
+
+/* CopyRange - copy the objects in a range reachable from the roots and the remembered objects */
+static void CopyRange(BobInterpreter *c,unsigned char *base,unsigned char *end,unsigned char *to)
+{
+    BobMemorySpace *oldSpace = c->oldSpace,*newSpace = c->newSpace;
+    BobMemorySpace range,copy;
+    unsigned char *scan;
+    BobValue obj;
+    long i;
+
+    /* the range acts as the old space and the space after 'to' as the new space */
+    range.base = base;
+    range.free = range.top = end;
+    range.cObjects = BobTakeRegionCObjects(c,base);
+    copy.base = copy.free = to;
+    copy.top = newSpace->top;
+    copy.cObjects = newSpace->cObjects;
+    c->oldSpace = &range;
+    c->newSpace = &copy;
+
+    /* string slices are copied as they are so the survivors fit in the range */
+    c->sliceBudget = 0;
+
+    /* copy the objects referenced by the roots and by the remembered objects */
+    CopyRoots(c);
+    for (i = 0; i < c->rememberedCount; ++i)
+        ScanValue(c,c->remembered[i]);
+
+    /* scan and copy until all accessible objects have been copied */
+    scan = copy.base;
+    do {
+        while (scan < copy.free) {
+            obj = (BobValue)scan;
+            scan += ValueSize(obj);
+            ScanValue(c,obj);
+        }
+        BobTraceWeakTables(c);
+    } while (scan < copy.free);
+    BobClearWeakObjects(c);
+    FixupCode(c);
+
+    /* destroy the cobjects left behind and restore the memory spaces */
+    BobDestroyUnreachableCObjects(c);
+    newSpace->free = copy.free;
+    newSpace->cObjects = copy.cObjects;
+    c->oldSpace = oldSpace;
+    c->newSpace = newSpace;
+}
+
+/* FixupCode - fixup cbase and pc after the current code object moves */
+static void FixupCode(BobInterpreter *c)
+{
+    if (c->code) {
+        long pcoff = c->pc - c->cbase;
+        c->cbase = BobStringAddress(BobCompiledCodeBytecodes(c->code));
+        c->pc = c->cbase + pcoff;
+    }
+}
+
+/* CopyRoots - copy the root objects */
+static void CopyRoots(BobInterpreter *c)
+{
+    BobProtectedPtrs *ppb;
+    BobCodeSegment *seg;
+    BobHandleBlock *hb;
+    BobDispatch *d;
+
+    /* copy the code objects referenced by the allocation profile */
+    if (c->allocProfile) {
+        SetRootKind(c,BobRootProfile);
+        BobCopyAllocProfile(c);
+    }
+
     /* copy the root objects */
+    SetRootKind(c,BobRootInterpreter);
     c->nilValue = BobCopyValue(c,c->nilValue);
     c->trueValue = BobCopyValue(c,c->trueValue);
     c->falseValue = BobCopyValue(c,c->falseValue);
     c->symbols = BobCopyValue(c,c->symbols);
     c->objectValue = BobCopyValue(c,c->objectValue);
+    c->regexCache = BobCopyValue(c,c->regexCache);
 
     /* copy basic types */
     c->methodObject = BobCopyValue(c,c->methodObject);
@@ -237,13 +484,35 @@ void BobCollectGarbage(BobInterpreter *c)
     c->floatObject = BobCopyValue(c,c->floatObject);
 #endif
 
+    /* copy the current code object */
+    if (c->code)
+        c->code = BobCopyValue(c,c->code);
+    
+    /* copy the registers */
+    c->val = BobCopyValue(c,c->val);
+    c->env = BobCopyValue(c,c->env);
+
     /* copy the type list */
+    SetRootKind(c,BobRootTypes);
     for (d = c->types; d != NULL; d = d->next) {
         if (d->object)
             d->object = BobCopyValue(c,d->object);
     }
 
+    /* copy the values referenced by frozen code (the pointer-free objects
+       at the start of each segment don't need to be scanned) */
+    SetRootKind(c,BobRootFrozen);
+    for (seg = c->codeSegments; seg != NULL; seg = seg->next) {
+        unsigned char *scan = seg->code;
+        while (scan < seg->free) {
+            BobValue obj = (BobValue)scan;
+            scan += ValueSize(obj);
+            ScanValue(c,obj);
+        }
+    }
+
     /* copy protected pointers */
+    SetRootKind(c,BobRootProtected);
     for (ppb = c->protectedPtrs; ppb != NULL; ppb = ppb->next) {
         BobValue **pp = ppb->pointers;
         int count = ppb->count;
@@ -251,56 +520,65 @@ void BobCollectGarbage(BobInterpreter *c)
             **pp = BobCopyValue(c,**pp);
     }
     
+    /* copy the handles in use */
+    SetRootKind(c,BobRootHandles);
+    if (c->handleBlock) {
+        for (hb = c->handleBlocks; ; hb = hb->next) {
+            BobValue *p = hb->handles;
+            BobValue *end = hb == c->handleBlock ? c->handleNext : p + BobHandleBlockSize;
+            for (; p < end; ++p)
+                *p = BobCopyValue(c,*p);
+            if (hb == c->handleBlock)
+                break;
+        }
+    }
+
     /* copy the stack */
+    SetRootKind(c,BobRootStack);
     BobCopyStack(c);
         
-    /* copy the current code object */
-    if (c->code)
-        c->code = BobCopyValue(c,c->code);
-    
-    /* copy the registers */
-    c->val = BobCopyValue(c,c->val);
-    c->env = BobCopyValue(c,c->env);
-        
     /* copy any user objects */
-    if (c->protectHandler)
+    if (c->protectHandler) {
+        SetRootKind(c,BobRootUser);
         (*c->protectHandler)(c,c->protectData);
-
-    /* scan and copy until all accessible objects have been copied */
-    scan = c->newSpace->base;
-	while (scan < c->newSpace->free) {
-        obj = (BobValue)scan;
-#if 0
-        BobStreamPutS("Scanning ",c->standardOutput);
-        BobPrint(c,obj,c->standardOutput);
-        BobStreamPutC('\n',c->standardOutput);
-#endif
-        scan += ValueSize(obj);
-        ScanValue(c,obj);
-    }
-    
-    /* fixup cbase and pc */
-    if (c->code) {
-        long pcoff = c->pc - c->cbase;
-        c->cbase = BobStringAddress(BobCompiledCodeBytecodes(c->code));
-        c->pc = c->cbase + pcoff;
     }
-    
-    /* count the garbage collections */
-    ++c->gcCount;
+}
 
-    {
-		char buf[128];
-		sprintf(buf,
-				" - %lu bytes free out of %lu, collections %lu]\n",
-				(unsigned long)(c->newSpace->top - c->newSpace->free),
-				(unsigned long)(c->newSpace->top - c->newSpace->base),
-				(unsigned long)c->gcCount);
-		BobStreamPutS(buf,c->standardError);
-	}
-      
-    /* destroy any unreachable cobjects */
-    BobDestroyUnreachableCObjects(c);
+/* BobVisitRoots - pass each root value to a visitor */
+void BobVisitRoots(BobInterpreter *c,BobHeapVisitor *v)
+{
+    c->heapVisitor = v;
+    CopyRoots(c);
+    c->heapVisitor = NULL;
+}
+
+/* BobVisitObject - pass each value referenced by an object to a visitor */
+void BobVisitObject(BobInterpreter *c,BobHeapVisitor *v,BobValue obj)
+{
+    v->rootKind = 0;
+    c->heapVisitor = v;
+    ScanValue(c,obj);
+    c->heapVisitor = NULL;
+}
+
+/* BobSetGCHandler - set the garbage collector event handler */
+void BobSetGCHandler(BobInterpreter *c,BobGCHandler *handler,void *data)
+{
+    c->gcHandler = handler;
+    c->gcData = data;
+}
+
+/* Microseconds - get the elapsed (wall clock) time in microseconds */
+static unsigned long Microseconds(void)
+{
+#ifdef CLOCK_MONOTONIC
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC,&now);
+    return (unsigned long)now.tv_sec * 1000000UL + (unsigned long)(now.tv_nsec / 1000);
+#else
+    /* no monotonic clock, fall back to the processor time */
+    return (unsigned long)((double)clock() * 1000000.0 / CLOCKS_PER_SEC);
+#endif
 }
 
 /* BobDumpHeap - dump the contents of the bob heap */
@@ -356,7 +634,15 @@ int BobDefaultPrint(BobInterpreter *c,BobValue obj,BobStream *s)
         && BobStreamPutC('>',s) == '>';
 }
 
-#define NewObjectP(c,obj)   ((unsigned char *)(obj) >= (c)->newSpace->base && (unsigned char *)(obj) < (c)->newSpace->free)
+/* BobCopyValue - copy a value to new space or pass it to the heap visitor */
+BobValue BobCopyValue(BobInterpreter *c,BobValue obj)
+{
+    if (!BobPointerP(obj))
+        return obj;
+    else if (c->heapVisitor)
+        return BobVisitValue(c,obj);
+    return BobQuickGetDispatch(obj)->copy(c,obj);
+}
 
 /* BobDefaultCopy - copy an object from old space to new space */
 BobValue BobDefaultCopy(BobInterpreter *c,BobValue obj)
@@ -364,8 +650,8 @@ BobValue BobDefaultCopy(BobInterpreter *c,BobValue obj)
     long size = ValueSize(obj);
     BobValue newObj;
     
-    /* don't copy an object that is already in new space */
-    if (NewObjectP(c,obj))
+    /* don't copy an object that is already in new space or is frozen */
+    if (!BobOldObjectP(c,obj))
         return obj;
 
     /* find a place to put the new object */
@@ -457,15 +743,12 @@ int BobUnprotectPointer(BobInterpreter *c,BobValue *pp)
 {
     BobProtectedPtrs *ppb = c->protectedPtrs;
     while (ppb) {
-        BobValue **ppp = ppb->pointers;
-        int cnt = ppb->count;
-        while (--cnt >= 0) {
-            if (*ppp++ == pp) {
-                while (--cnt >= 0) {
-                    ppp[-1] = *ppp;
-                    ++ppp;
-                }
-                --ppb->count;
+        int i = ppb->count;
+
+        /* pointers are usually unprotected soon after they're protected */
+        while (--i >= 0) {
+            if (ppb->pointers[i] == pp) {
+                ppb->pointers[i] = ppb->pointers[--ppb->count];
                 return TRUE;
             }
         }
@@ -474,6 +757,45 @@ int BobUnprotectPointer(BobInterpreter *c,BobValue *pp)
     return FALSE;
 }
 
+/* BobOpenHandleScope - open a handle scope */
+void BobOpenHandleScope(BobInterpreter *c,BobHandleScope *scope)
+{
+    scope->block = c->handleBlock;
+    scope->next = c->handleNext;
+}
+
+/* BobCloseHandleScope - close a handle scope releasing the handles made in it */
+void BobCloseHandleScope(BobInterpreter *c,BobHandleScope *scope)
+{
+    c->handleBlock = scope->block;
+    c->handleNext = scope->next;
+    c->handleLimit = scope->block ? scope->block->handles + BobHandleBlockSize : NULL;
+}
+
+/* BobExpandHandles - make a handle in the next handle block */
+BobValue *BobExpandHandles(BobInterpreter *c,BobValue value)
+{
+    BobHandleBlock *hb = c->handleBlock ? c->handleBlock->next : c->handleBlocks;
+
+    /* allocate a new block if there isn't one left from an earlier scope */
+    if (!hb) {
+        if ((hb = (BobHandleBlock *)BobAlloc(c,sizeof(BobHandleBlock))) == NULL)
+            BobInsufficientMemory(c);
+        hb->next = NULL;
+        if (c->handleBlock)
+            c->handleBlock->next = hb;
+        else
+            c->handleBlocks = hb;
+    }
+
+    /* make the handle */
+    c->handleBlock = hb;
+    c->handleNext = hb->handles;
+    c->handleLimit = hb->handles + BobHandleBlockSize;
+    *c->handleNext = value;
+    return c->handleNext++;
+}
+
 static unsigned long totalAlloc = sizeof(BobInterpreter);
 
 /* BobAlloc - allocate memory */
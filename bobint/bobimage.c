@@ -0,0 +1,607 @@
+/* bobimage.c - saving and restoring heap images */
+/*
+        Copyright (c) 2001, by David Michael Betz
+        All rights reserved
+*/
+
+/*
+    A heap image is a copy of the heap taken right after a garbage
+    collection along with the interpreter roots and the derived types.
+    Loading an image replaces BobInitInterpreter and the library setup
+    that normally follows it.  The file format is:
+
+        header
+        type records
+        heap words
+        frozen code segment words
+        relocation table (2 bits per heap and segment word)
+
+    The frozen code segments are saved one after another following the
+    heap and are loaded into a single segment.  Each word that holds an
+    address is stored as one of:
+
+        RelocHeap       offset from the base of the heap (offsets past
+                        the end of the heap are in the code segment)
+        RelocStatic     offset from BobObjectDispatch (statically
+                        allocated dispatch structures, method tables and
+                        functions in the executable)
+        RelocType       index of a derived type in the type records
+
+    Static addresses can only be relocated by a constant bias so an image
+    can only be loaded by the executable that saved it.  The header
+    records the distance between a function and a variable to detect a
+    different executable.
+
+    CObject data is saved as is with two exceptions.  The pointer in a
+    'Type' object is relocated as a type.  Types with a destroy handler
+    hold external resources that can't be saved so their pointers are
+    cleared except for the streams of the built-in ports which are
+    recreated when the image is loaded.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bob.h"
+
+/* relocation kinds */
+#define RelocNone       0
+#define RelocHeap       1
+#define RelocStatic     2
+#define RelocType       3
+
+/* built-in port codes */
+#define PortNone        0
+#define PortInput       1
+#define PortOutput      2
+#define PortError       3
+
+/* relocation table access */
+#define RelocBytes(n)           (((n) + 3) / 4)
+#define GetReloc(r,i)           (((r)[(i) >> 2] >> (((i) & 3) << 1)) & 3)
+#define SetReloc(r,i,k)         ((r)[(i) >> 2] |= (k) << (((i) & 3) << 1))
+
+/* base address for static relocations */
+#define StaticBase              ((char *)&BobObjectDispatch)
+
+/* relocated address */
+typedef struct {
+    long kind;
+    BobPointerType value;
+} ImageRef;
+
+/* number of interpreter roots */
+#define ImageRootCount          11
+
+/* image header */
+typedef struct {
+    char tag[4];                        /* 'B' 'O' 'B' 'I' */
+    long version;                       /* BobImageVersion */
+    long valueSize;                     /* sizeof(BobValue) */
+    long interpreterSize;               /* sizeof(BobInterpreter) */
+    BobPointerType fingerprint;         /* distance from a function to StaticBase */
+    unsigned long heapSize;             /* bytes of heap */
+    unsigned long frozenSize;           /* bytes of frozen code segments */
+    unsigned long frozenCode;           /* offset to the first compiled code object */
+    long typeCount;                     /* number of type records */
+    ImageRef typeDispatch;              /* the 'Type' type */
+    ImageRef roots[ImageRootCount];     /* interpreter roots */
+} ImageHeader;
+
+/* type record */
+typedef struct {
+    long nameLength;
+    long dataSize;
+    ImageRef baseType;
+    ImageRef getProperty;
+    ImageRef setProperty;
+    ImageRef newInstance;
+    ImageRef print;
+    ImageRef size;
+    ImageRef copy;
+    ImageRef scan;
+    ImageRef hash;
+    ImageRef object;
+    ImageRef destroy;
+    ImageRef parent;
+} ImageType;
+
+/* image writer structure */
+typedef struct {
+    BobHeapVisitor hdr;                 /* visitor header */
+    BobDispatch **types;                /* derived types */
+    long typeCount;                     /* number of derived types */
+    BobValue *heap;                     /* copy of the heap and segments being relocated */
+    unsigned long heapSize;             /* bytes of heap */
+    unsigned char *relocs;              /* relocation table */
+} ImageWriter;
+
+/* global type pointers to restore after loading an image */
+static struct {
+    char *name;
+    BobDispatch **pDispatch;
+} globalTypes[] = {
+{   "File",     &BobFileDispatch    },
+{   "WeakRef",  &BobWeakRefDispatch },
+{   "WeakTable",&BobWeakTableDispatch},
+{   "StringBuilder",&BobStringBuilderDispatch},
+{   "Dictionary",&BobDictionaryDispatch},
+{   "Int64Array",&BobInt64ArrayDispatch},
+{   "Float64Array",&BobFloat64ArrayDispatch},
+{   "ByteArray",&BobByteArrayDispatch},
+{   "SortedMap",&BobSortedMapDispatch},
+{   "Regex",&BobRegexDispatch},
+{   NULL,       NULL                }
+};
+
+/* prototypes */
+static void GetRoots(BobInterpreter *c,BobValue **roots);
+static BobValue MarkSlot(BobInterpreter *c,BobHeapVisitor *v,BobValue obj);
+static void RelocateObject(BobInterpreter *c,ImageWriter *w,BobValue obj,long offset);
+static void RelocateWord(BobInterpreter *c,ImageWriter *w,long i,void *p);
+static void EncodePointer(BobInterpreter *c,ImageWriter *w,void *p,ImageRef *r);
+static void EncodeType(BobInterpreter *c,ImageWriter *w,BobDispatch *d,ImageType *t);
+static int PortCode(BobInterpreter *c,BobStream *s);
+static void *DecodePointer(BobInterpreter *c,BobDispatch **types,ImageRef *r);
+static void DecodeType(BobInterpreter *c,BobDispatch **types,BobDispatch *d,ImageType *t);
+static void RestoreCObjects(BobInterpreter *c);
+static BobDispatch *FindType(BobInterpreter *c,char *name);
+
+/* BobSaveImage - save the heap to an image file */
+int BobSaveImage(BobInterpreter *c,char *name)
+{
+    BobValue *roots[ImageRootCount];
+    unsigned long heapSize,frozenSize = 0,frozenCode = 0,imageSize;
+    ImageHeader header;
+    BobCodeSegment *seg;
+    unsigned char *scan;
+    ImageWriter w;
+    BobDispatch *d;
+    long offset,i;
+    int sts = TRUE;
+    FILE *fp;
+
+    /* collect the garbage so only reachable objects remain */
+    BobCollectGarbage(c);
+    heapSize = (unsigned long)(c->newSpace->free - c->newSpace->base);
+
+    /* find the size of the frozen code segments */
+    for (seg = c->codeSegments; seg != NULL; seg = seg->next) {
+        if (seg == c->codeSegments)
+            frozenCode = frozenSize + (unsigned long)(seg->code - seg->base);
+        frozenSize += (unsigned long)(seg->free - seg->base);
+    }
+    imageSize = heapSize + frozenSize;
+
+    /* initialize the writer */
+    memset(&w,0,sizeof(w));
+    w.hdr.visit = MarkSlot;
+    w.heapSize = heapSize;
+    for (d = c->types; d != NULL; d = d->next)
+        ++w.typeCount;
+
+    /* allocate the work arrays */
+    if ((w.types = (BobDispatch **)BobAlloc(c,(w.typeCount + 1) * sizeof(BobDispatch *))) == NULL
+    ||  (w.heap = (BobValue *)BobAlloc(c,imageSize + sizeof(BobValue))) == NULL
+    ||  (w.relocs = (unsigned char *)BobAlloc(c,RelocBytes(imageSize / sizeof(BobValue)) + 1)) == NULL) {
+        if (w.heap) BobFree(c,w.heap);
+        if (w.types) BobFree(c,w.types);
+        return FALSE;
+    }
+    for (i = 0, d = c->types; d != NULL; d = d->next)
+        w.types[i++] = d;
+    memcpy(w.heap,c->newSpace->base,heapSize);
+    memset(w.relocs,0,RelocBytes(imageSize / sizeof(BobValue)) + 1);
+
+    /* relocate each heap object */
+    for (scan = c->newSpace->base, offset = 0; scan < c->newSpace->free; ) {
+        BobValue obj = (BobValue)scan;
+        long size = BobQuickGetDispatch(obj)->size(obj);
+        RelocateObject(c,&w,obj,offset);
+        scan += size;
+        offset += size;
+    }
+
+    /* relocate each object in the frozen code segments */
+    for (seg = c->codeSegments; seg != NULL; seg = seg->next) {
+        memcpy((char *)w.heap + offset,seg->base,seg->free - seg->base);
+        for (scan = seg->base; scan < seg->free; ) {
+            BobValue obj = (BobValue)scan;
+            long size = BobQuickGetDispatch(obj)->size(obj);
+            RelocateObject(c,&w,obj,offset);
+            scan += size;
+            offset += size;
+        }
+    }
+
+    /* build the header */
+    memset(&header,0,sizeof(header));
+    memcpy(header.tag,"BOBI",4);
+    header.version = BobImageVersion;
+    header.valueSize = sizeof(BobValue);
+    header.interpreterSize = sizeof(BobInterpreter);
+    header.fingerprint = (char *)BobSaveImage - StaticBase;
+    header.heapSize = heapSize;
+    header.frozenSize = frozenSize;
+    header.frozenCode = frozenCode;
+    header.typeCount = w.typeCount;
+    EncodePointer(c,&w,c->typeDispatch,&header.typeDispatch);
+    GetRoots(c,roots);
+    for (i = 0; i < ImageRootCount; ++i)
+        EncodePointer(c,&w,*roots[i],&header.roots[i]);
+
+    /* write the image */
+    if ((fp = fopen(name,"wb")) == NULL)
+        sts = FALSE;
+    else {
+        if (fwrite(&header,sizeof(header),1,fp) != 1)
+            sts = FALSE;
+        for (i = 0; sts && i < w.typeCount; ++i) {
+            ImageType t;
+            EncodeType(c,&w,w.types[i],&t);
+            if (fwrite(&t,sizeof(t),1,fp) != 1
+            ||  fwrite(w.types[i]->typeName,1,t.nameLength,fp) != (size_t)t.nameLength)
+                sts = FALSE;
+        }
+        if (sts
+        &&  (fwrite(w.heap,1,imageSize,fp) != imageSize
+        ||   fwrite(w.relocs,1,RelocBytes(imageSize / sizeof(BobValue)),fp) != RelocBytes(imageSize / sizeof(BobValue))))
+            sts = FALSE;
+        if (fclose(fp) != 0)
+            sts = FALSE;
+    }
+
+    /* free the work arrays */
+    BobFree(c,w.relocs);
+    BobFree(c,w.heap);
+    BobFree(c,w.types);
+
+    /* return status */
+    return sts;
+}
+
+/* BobLoadImage - initialize a new interpreter from an image file */
+BobInterpreter *BobLoadImage(BobInterpreter *c,char *name)
+{
+    BobValue *roots[ImageRootCount],*p;
+    BobCodeSegment *seg = NULL;
+    BobDispatch **types = NULL;
+    ImageType *typeRecords = NULL;
+    unsigned char *relocs = NULL;
+    ImageHeader header;
+    long wordCount,i;
+    int sts = FALSE;
+    FILE *fp;
+
+    /* open the image and check the header */
+    if ((fp = fopen(name,"rb")) == NULL)
+        return NULL;
+    if (fread(&header,sizeof(header),1,fp) != 1
+    ||  memcmp(header.tag,"BOBI",4) != 0
+    ||  header.version != BobImageVersion
+    ||  header.valueSize != sizeof(BobValue)
+    ||  header.interpreterSize != sizeof(BobInterpreter)
+    ||  header.fingerprint != (char *)BobSaveImage - StaticBase
+    ||  header.heapSize > (unsigned long)(c->newSpace->top - c->newSpace->base)) {
+        fclose(fp);
+        return NULL;
+    }
+    wordCount = (long)((header.heapSize + header.frozenSize) / sizeof(BobValue));
+
+    /* allocate the work arrays */
+    if ((types = (BobDispatch **)BobAlloc(c,(header.typeCount + 1) * sizeof(BobDispatch *))) == NULL
+    ||  (typeRecords = (ImageType *)BobAlloc(c,(header.typeCount + 1) * sizeof(ImageType))) == NULL
+    ||  (relocs = (unsigned char *)BobAlloc(c,RelocBytes(wordCount) + 1)) == NULL)
+        goto done;
+
+    /* read the type records */
+    for (i = 0; i < header.typeCount; ++i) {
+        ImageType *t = &typeRecords[i];
+        char typeName[256];
+        if (fread(t,sizeof(ImageType),1,fp) != 1
+        ||  t->nameLength >= (long)sizeof(typeName)
+        ||  fread(typeName,1,t->nameLength,fp) != (size_t)t->nameLength)
+            goto done;
+        typeName[t->nameLength] = '\0';
+        if ((types[i] = BobMakeDispatch(c,typeName,&BobCObjectDispatch)) == NULL)
+            goto done;
+    }
+
+    /* BobMakeDispatch adds types to the front of the list so reverse it */
+    c->types = NULL;
+    for (i = header.typeCount; --i >= 0; ) {
+        types[i]->next = c->types;
+        c->types = types[i];
+    }
+
+    /* read the heap directly into new space */
+    if (fread(c->newSpace->base,1,header.heapSize,fp) != header.heapSize)
+        goto done;
+    c->newSpace->free = c->newSpace->base + header.heapSize;
+
+    /* read the frozen code into a single code segment */
+    if (header.frozenSize > 0) {
+        if ((seg = BobMakeCodeSegment(c,(long)header.frozenSize)) == NULL
+        ||  fread(seg->base,1,header.frozenSize,fp) != header.frozenSize)
+            goto done;
+        seg->code = seg->base + header.frozenCode;
+        seg->free = seg->base + header.frozenSize;
+    }
+
+    /* read the relocation table */
+    if (fread(relocs,1,RelocBytes(wordCount),fp) != (size_t)RelocBytes(wordCount))
+        goto done;
+
+    /* relocate the heap and the code segment */
+    for (i = 0, p = (BobValue *)c->newSpace->base; i < wordCount; ++i, ++p) {
+        ImageRef r;
+        if (p == (BobValue *)c->newSpace->free)
+            p = (BobValue *)seg->base;
+        if ((r.kind = GetReloc(relocs,i)) != RelocNone) {
+            r.value = (BobPointerType)*p;
+            *p = (BobValue)DecodePointer(c,types,&r);
+        }
+    }
+
+    /* fill in the types */
+    for (i = 0; i < header.typeCount; ++i)
+        DecodeType(c,types,types[i],&typeRecords[i]);
+    c->typeDispatch = (BobDispatch *)DecodePointer(c,types,&header.typeDispatch);
+
+    /* restore the global type pointers */
+    for (i = 0; globalTypes[i].name != NULL; ++i)
+        *globalTypes[i].pDispatch = FindType(c,globalTypes[i].name);
+
+    /* restore the interpreter roots */
+    GetRoots(c,roots);
+    for (i = 0; i < ImageRootCount; ++i)
+        *roots[i] = (BobValue)DecodePointer(c,types,&header.roots[i]);
+    c->symbolCount = BobCountSymbols(c);
+
+    /* the cache of compiled regular expressions isn't saved */
+    c->regexCache = c->nilValue;
+
+    /* relink the cobjects and recreate the built-in ports */
+    RestoreCObjects(c);
+
+    /* initialize the vm registers */
+    c->fp = (BobFrame *)c->stackTop;
+    c->sp = c->stackTop;
+    c->val = c->nilValue;
+    c->env = c->nilValue;
+    c->code = NULL;
+    sts = TRUE;
+
+done:
+    /* free the work arrays */
+    if (relocs) BobFree(c,relocs);
+    if (typeRecords) BobFree(c,typeRecords);
+    if (types) BobFree(c,types);
+    fclose(fp);
+
+    /* return the interpreter */
+    return sts ? c : NULL;
+}
+
+/* GetRoots - get the addresses of the interpreter roots */
+static void GetRoots(BobInterpreter *c,BobValue **roots)
+{
+    *roots++ = &c->nilValue;
+    *roots++ = &c->trueValue;
+    *roots++ = &c->falseValue;
+    *roots++ = &c->symbols;
+    *roots++ = &c->objectValue;
+    *roots++ = &c->methodObject;
+    *roots++ = &c->vectorObject;
+    *roots++ = &c->symbolObject;
+    *roots++ = &c->stringObject;
+    *roots++ = &c->integerObject;
+    *roots++ = &c->floatObject;
+}
+
+/* MarkSlot - change a slot so it can be found by RelocateObject */
+static BobValue MarkSlot(BobInterpreter *c,BobHeapVisitor *v,BobValue obj)
+{
+    return (BobValue)((BobPointerType)obj ^ 2);
+}
+
+/* RelocateObject - relocate the addresses in a heap or code segment object */
+static void RelocateObject(BobInterpreter *c,ImageWriter *w,BobValue obj,long offset)
+{
+    BobValue *words = (BobValue *)obj;
+    BobValue *copy = (BobValue *)((char *)w->heap + offset);
+    BobDispatch *d = BobQuickGetDispatch(obj);
+    long base = offset / sizeof(BobValue);
+    long count = d->size(obj) / sizeof(BobValue);
+    long i;
+
+    /* let the scan handler mark the slots that hold values */
+    BobVisitObject(c,&w->hdr,(BobValue)copy);
+    for (i = 1; i < count; ++i)
+        if (copy[i] != words[i])
+            RelocateWord(c,w,base + i,words[i]);
+
+    /* relocate the dispatch pointer */
+    RelocateWord(c,w,base,d);
+
+    /* relocate the pointers that aren't values */
+    if (d == &BobCMethodDispatch) {
+        BobCMethod *method = (BobCMethod *)obj;
+        RelocateWord(c,w,base + 1,method->name);
+        RelocateWord(c,w,base + 2,(void *)method->handler);
+    }
+    else if (d == &BobVPMethodDispatch) {
+        BobVPMethod *method = (BobVPMethod *)obj;
+        RelocateWord(c,w,base + 1,method->name);
+        RelocateWord(c,w,base + 2,(void *)method->getHandler);
+        RelocateWord(c,w,base + 3,(void *)method->setHandler);
+    }
+    else if (BobCObjectP(obj)) {
+        long ptrIndex = base + sizeof(BobCObject) / sizeof(BobValue);
+        copy[sizeof(BobCObject) / sizeof(BobValue) - 1] = NULL;
+        if (d->dataSize < (long)sizeof(void *))
+            ;
+        else if (d == c->typeDispatch)
+            RelocateWord(c,w,ptrIndex,BobCObjectValue(obj));
+        else if (d->destroy)
+            w->heap[ptrIndex] = (BobValue)(BobPointerType)PortCode(c,BobCObjectValue(obj));
+    }
+}
+
+/* RelocateWord - store a relocated address in the heap copy */
+static void RelocateWord(BobInterpreter *c,ImageWriter *w,long i,void *p)
+{
+    ImageRef r;
+    EncodePointer(c,w,p,&r);
+    w->heap[i] = (BobValue)r.value;
+    SetReloc(w->relocs,i,r.kind);
+}
+
+/* EncodePointer - encode an address */
+static void EncodePointer(BobInterpreter *c,ImageWriter *w,void *p,ImageRef *r)
+{
+    BobCodeSegment *seg;
+    long offset,i;
+
+    /* check for a null pointer */
+    if (p == NULL) {
+        r->kind = RelocNone;
+        r->value = 0;
+        return;
+    }
+
+    /* stack environments don't survive so replace references to them with nil */
+    if ((BobValue *)p >= c->stack && (BobValue *)p < c->stackTop)
+        p = c->nilValue;
+
+    /* check for a heap object */
+    if ((unsigned char *)p >= c->newSpace->base && (unsigned char *)p < c->newSpace->free) {
+        r->kind = RelocHeap;
+        r->value = (unsigned char *)p - c->newSpace->base;
+        return;
+    }
+
+    /* check for a frozen object */
+    for (offset = w->heapSize, seg = c->codeSegments; seg != NULL; seg = seg->next) {
+        if ((unsigned char *)p >= seg->base && (unsigned char *)p < seg->free) {
+            r->kind = RelocHeap;
+            r->value = offset + ((unsigned char *)p - seg->base);
+            return;
+        }
+        offset += seg->free - seg->base;
+    }
+
+    /* check for a derived type */
+    for (i = 0; i < w->typeCount; ++i)
+        if (p == (void *)w->types[i]) {
+            r->kind = RelocType;
+            r->value = i;
+            return;
+        }
+
+    /* anything else must be in the executable */
+    r->kind = RelocStatic;
+    r->value = (char *)p - StaticBase;
+}
+
+/* EncodeType - encode a type record */
+static void EncodeType(BobInterpreter *c,ImageWriter *w,BobDispatch *d,ImageType *t)
+{
+    t->nameLength = (long)strlen(d->typeName);
+    t->dataSize = d->dataSize;
+    EncodePointer(c,w,d->baseType,&t->baseType);
+    EncodePointer(c,w,(void *)d->getProperty,&t->getProperty);
+    EncodePointer(c,w,(void *)d->setProperty,&t->setProperty);
+    EncodePointer(c,w,(void *)d->newInstance,&t->newInstance);
+    EncodePointer(c,w,(void *)d->print,&t->print);
+    EncodePointer(c,w,(void *)d->size,&t->size);
+    EncodePointer(c,w,(void *)d->copy,&t->copy);
+    EncodePointer(c,w,(void *)d->scan,&t->scan);
+    EncodePointer(c,w,(void *)d->hash,&t->hash);
+    EncodePointer(c,w,d->object,&t->object);
+    EncodePointer(c,w,(void *)d->destroy,&t->destroy);
+    EncodePointer(c,w,d->parent,&t->parent);
+}
+
+/* PortCode - get the code for the stream of a built-in port */
+static int PortCode(BobInterpreter *c,BobStream *s)
+{
+    BobStream **pStream = s ? BobIndirectStreamTarget(s) : NULL;
+    if (pStream == &c->standardInput)
+        return PortInput;
+    else if (pStream == &c->standardOutput)
+        return PortOutput;
+    else if (pStream == &c->standardError)
+        return PortError;
+    return PortNone;
+}
+
+/* DecodePointer - decode an address */
+static void *DecodePointer(BobInterpreter *c,BobDispatch **types,ImageRef *r)
+{
+    switch (r->kind) {
+    case RelocHeap:
+        if (r->value < c->newSpace->free - c->newSpace->base)
+            return c->newSpace->base + r->value;
+        return c->codeSegments->base + (r->value - (c->newSpace->free - c->newSpace->base));
+    case RelocStatic:
+        return StaticBase + r->value;
+    case RelocType:
+        return types[r->value];
+    }
+    return NULL;
+}
+
+/* DecodeType - fill in a type from a type record */
+static void DecodeType(BobInterpreter *c,BobDispatch **types,BobDispatch *d,ImageType *t)
+{
+    d->dataSize = t->dataSize;
+    d->baseType = (BobDispatch *)DecodePointer(c,types,&t->baseType);
+    *(void **)&d->getProperty = DecodePointer(c,types,&t->getProperty);
+    *(void **)&d->setProperty = DecodePointer(c,types,&t->setProperty);
+    *(void **)&d->newInstance = DecodePointer(c,types,&t->newInstance);
+    *(void **)&d->print = DecodePointer(c,types,&t->print);
+    *(void **)&d->size = DecodePointer(c,types,&t->size);
+    *(void **)&d->copy = DecodePointer(c,types,&t->copy);
+    *(void **)&d->scan = DecodePointer(c,types,&t->scan);
+    *(void **)&d->hash = DecodePointer(c,types,&t->hash);
+    d->object = (BobValue)DecodePointer(c,types,&t->object);
+    *(void **)&d->destroy = DecodePointer(c,types,&t->destroy);
+    d->parent = (BobDispatch *)DecodePointer(c,types,&t->parent);
+}
+
+/* RestoreCObjects - relink the cobjects and recreate the built-in ports */
+static void RestoreCObjects(BobInterpreter *c)
+{
+    unsigned char *scan = c->newSpace->base;
+    c->newSpace->cObjects = NULL;
+    while (scan < c->newSpace->free) {
+        BobValue obj = (BobValue)scan;
+        BobDispatch *d = BobQuickGetDispatch(obj);
+        scan += d->size(obj);
+        if (BobCObjectP(obj) && d->destroy) {
+            ((BobCObject *)obj)->next = c->newSpace->cObjects;
+            c->newSpace->cObjects = obj;
+            if (d != c->typeDispatch && d->dataSize >= (long)sizeof(void *)) {
+                BobStream **pStream;
+                switch ((int)(BobPointerType)BobCObjectValue(obj)) {
+                case PortInput:     pStream = &c->standardInput;    break;
+                case PortOutput:    pStream = &c->standardOutput;   break;
+                case PortError:     pStream = &c->standardError;    break;
+                default:            pStream = NULL;                 break;
+                }
+                BobSetCObjectValue(obj,pStream ? BobMakeIndirectStream(c,pStream) : NULL);
+            }
+        }
+    }
+}
+
+/* FindType - find a derived type by name */
+static BobDispatch *FindType(BobInterpreter *c,char *name)
+{
+    BobDispatch *d;
+    for (d = c->types; d != NULL; d = d->next)
+        if (strcmp(d->typeName,name) == 0)
+            return d;
+    return NULL;
+}
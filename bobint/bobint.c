@@ -6,6 +6,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <setjmp.h>
 #include "bob.h"
 #include "bobint.h"
@@ -27,14 +28,17 @@ struct BobFrame {
 struct FrameDispatch {
     void (*restore)(BobInterpreter *c);
     BobValue *(*copy)(BobInterpreter *c,BobFrame *frame);
+    void (*relocate)(BobFrame *frame,BobValue *oldStack,BobValue *oldTop,BobValue *newTop);
 };
 
 /* call frame dispatch */
 static void CallRestore(BobInterpreter *c);
 static BobValue *CallCopy(BobInterpreter *c,BobFrame *frame);
+static void CallRelocate(BobFrame *frame,BobValue *oldStack,BobValue *oldTop,BobValue *newTop);
 FrameDispatch BobCallCDispatch = {
     CallRestore,
-    CallCopy
+    CallCopy,
+    CallRelocate
 };
 
 /* call frame */
@@ -48,19 +52,32 @@ struct CallFrame {
     BobEnvironment stackEnv;
 };
 
+/* nested call frame dispatch */
+FrameDispatch BobNestedCDispatch = {
+    CallRestore,
+    CallCopy,
+    CallRelocate
+};
+
+/* check for a frame made by a call from bytecode or a built-in method */
+#define CallFrameP(f)   ((f)->hdr.dispatch == &BobCallCDispatch || (f)->hdr.dispatch == &BobNestedCDispatch)
+
 /* top frame dispatch */
 static void TopRestore(BobInterpreter *c);
 FrameDispatch BobTopCDispatch = {
     TopRestore,
-    CallCopy
+    CallCopy,
+    CallRelocate
 };
 
 /* block frame dispatch */
 static void BlockRestore(BobInterpreter *c);
 static BobValue *BlockCopy(BobInterpreter *c,BobFrame *frame);
+static void BlockRelocate(BobFrame *frame,BobValue *oldStack,BobValue *oldTop,BobValue *newTop);
 FrameDispatch BobBlockCDispatch = {
     BlockRestore,
-    BlockCopy
+    BlockCopy,
+    BlockRelocate
 };
 
 /* block frame */
@@ -83,15 +100,16 @@ static void BinaryOp(BobInterpreter *c,int op);
 static int Send(BobInterpreter *c,FrameDispatch *d,int argc);
 static int Call(BobInterpreter *c,FrameDispatch *d,int argc);
 static void PushFrame(BobInterpreter *c,int size);
-static BobValue UnstackEnv(BobInterpreter *c,BobValue env);
+static BobValue UnstackEnv(BobInterpreter *c);
+static BobValue RelocateStackPointer(BobValue v,BobValue *oldStack,BobValue *oldTop,BobValue *newTop);
 static void BadOpcode(BobInterpreter *c,int opcode);
-static int CompareObjects(BobInterpreter *c,BobValue obj1,BobValue obj2);
 static int CompareStrings(BobValue str1,BobValue str2);
 static BobValue ConcatenateStrings(BobInterpreter *c,BobValue str1,BobValue str2);
 
 /* BobPushUnwindTarget - push an unwind target onto the stack */
 void BobPushUnwindTarget(BobInterpreter *c,BobUnwindTarget *target)
 {
+    BobOpenHandleScope(c,&target->handles);
     target->next = c->unwindTarget;
     c->unwindTarget = target;
 }
@@ -163,6 +181,7 @@ static void Execute(BobInterpreter *c)
 {
     for (;;) {
         BobValue p1,p2,*p;
+        FrameDispatch *d;
         unsigned int off;
         long n;
         int i;
@@ -176,6 +195,17 @@ static void Execute(BobInterpreter *c)
             Send(c,&BobCallCDispatch,*c->pc++);
             break;
         case BobOpRETURN:
+            d = c->fp->dispatch;
+            (*d->restore)(c);
+
+            /* destroy the cobjects found unreachable by the last collection */
+            if (c->finalizeQueueUsed)
+                BobRunFinalizers(c);
+
+            /* return to the built-in method that made a nested call */
+            if (d == &BobNestedCDispatch)
+                return;
+            break;
         case BobOpUNFRAME:
             (*c->fp->dispatch->restore)(c);
             break;
@@ -198,7 +228,7 @@ static void Execute(BobInterpreter *c)
             c->val = BobToBoolean(c,c->argc >= i);
             break;
         case BobOpCLOSE:
-            c->env = UnstackEnv(c,c->env);
+            c->env = UnstackEnv(c);
             c->val = BobMakeMethod(c,c->val,c->env);
             break;
         case BobOpEREF:
@@ -213,6 +243,7 @@ static void Execute(BobInterpreter *c)
             for (p2 = c->env; --i >= 0; )
                 p2 = BobEnvNextFrame(p2);
             i = BobEnvSize(p2) - *c->pc++;
+            BobWriteBarrier(c,p2,c->val);
             BobSetEnvElement(p2,i,c->val);
             break;
         case BobOpBRT:
@@ -308,11 +339,11 @@ static void Execute(BobInterpreter *c)
             break;
         case BobOpLT:
             p1 = BobPop(c);
-            c->val = BobToBoolean(c,CompareObjects(c,p1,c->val) < 0);
+            c->val = BobToBoolean(c,BobCompareObjects(c,p1,c->val) < 0);
             break;
         case BobOpLE:
             p1 = BobPop(c);
-            c->val = BobToBoolean(c,CompareObjects(c,p1,c->val) <= 0);
+            c->val = BobToBoolean(c,BobCompareObjects(c,p1,c->val) <= 0);
             break;
         case BobOpEQ:
             p1 = BobPop(c);
@@ -324,11 +355,11 @@ static void Execute(BobInterpreter *c)
             break;
         case BobOpGE:
             p1 = BobPop(c);
-            c->val = BobToBoolean(c,CompareObjects(c,p1,c->val) >= 0);
+            c->val = BobToBoolean(c,BobCompareObjects(c,p1,c->val) >= 0);
             break;
         case BobOpGT:
             p1 = BobPop(c);
-            c->val = BobToBoolean(c,CompareObjects(c,p1,c->val) > 0);
+            c->val = BobToBoolean(c,BobCompareObjects(c,p1,c->val) > 0);
             break;
         case BobOpLIT:
             off = *c->pc++;
@@ -343,7 +374,9 @@ static void Execute(BobInterpreter *c)
         case BobOpGSET:
             off = *c->pc++;
             off |= *c->pc++ << 8;
-            BobSetGlobalValue(BobCompiledCodeLiteral(c->code,off),c->val);
+            p1 = BobCompiledCodeLiteral(c->code,off);
+            BobWriteBarrier(c,p1,c->val);
+            BobSetGlobalValue(p1,c->val);
             break;
         case BobOpGETP:
             p1 = BobPop(c);
@@ -652,6 +685,34 @@ BobValue BobInternalCall(BobInterpreter *c,int argc)
     return 0; /* never reached */
 }
 
+/* BobNestedCall - call a function from a built-in method */
+BobValue BobNestedCall(BobInterpreter *c,int argc)
+{
+    /* the argument pointer is kept as an offset since the stack can move */
+    long argvOffset = c->stackTop - c->argv;
+    int oldArgC = c->argc;
+    BobUnwindTarget target;
+    int sts;
+
+    /* restore the arguments of the built-in method before passing on an error */
+    BobPushUnwindTarget(c,&target);
+    if ((sts = BobUnwindCatch(c)) != 0) {
+        c->argv = c->stackTop - argvOffset;
+        c->argc = oldArgC;
+        BobPopAndUnwind(c,sts);
+    }
+
+    /* the interpreter returns here when the function returns */
+    if (!Call(c,&BobNestedCDispatch,argc))
+        Execute(c);
+    BobPopUnwindTarget(c);
+
+    /* restore the arguments of the built-in method */
+    c->argv = c->stackTop - argvOffset;
+    c->argc = oldArgC;
+    return c->val;
+}
+
 /* Call - setup to call a function */
 static int Call(BobInterpreter *c,FrameDispatch *d,int argc)
 {
@@ -670,6 +731,10 @@ static int Call(BobInterpreter *c,FrameDispatch *d,int argc)
     if (BobCMethodP(method)) {
         c->val = (*BobCMethodHandler(method))(c);
         BobDrop(c,argc + 1);
+
+        /* destroy the cobjects found unreachable during the call */
+        if (c->finalizeQueueUsed)
+            BobRunFinalizers(c);
         return TRUE;
     }
     
@@ -711,6 +776,13 @@ static int Call(BobInterpreter *c,FrameDispatch *d,int argc)
             *--p = BobPop(c);
         BobCPush(c,value);
         ++targc;
+
+        /* the allocation may have moved the method and its code */
+        rcnt = pc - cbase;
+        method = *c->argv;
+        code = BobMethodCode(method);
+        cbase = BobStringAddress(BobCompiledCodeBytecodes(code));
+        pc = cbase + rcnt;
     }
     
     /* reserve space for the call frame */
@@ -797,6 +869,16 @@ static BobValue *CallCopy(BobInterpreter *c,BobFrame *frame)
     return data;
 }
 
+/* CallRelocate - relocate a call frame after the stack moves */
+static void CallRelocate(BobFrame *frame,BobValue *oldStack,BobValue *oldTop,BobValue *newTop)
+{
+    CallFrame *call = (CallFrame *)frame;
+    BobValue env = (BobValue)&call->stackEnv;
+    call->env = RelocateStackPointer(call->env,oldStack,oldTop,newTop);
+    if (BobStackEnvironmentP(env))
+        BobSetEnvNextFrame(env,RelocateStackPointer(BobEnvNextFrame(env),oldStack,oldTop,newTop));
+}
+
 /* PushFrame - push a frame on the stack */
 static void PushFrame(BobInterpreter *c,int size)
 {
@@ -860,14 +942,25 @@ static BobValue *BlockCopy(BobInterpreter *c,BobFrame *frame)
     return data;
 }
 
-/* UnstackEnv - unstack the environment */
-static BobValue UnstackEnv(BobInterpreter *c,BobValue env)
+/* BlockRelocate - relocate a block frame after the stack moves */
+static void BlockRelocate(BobFrame *frame,BobValue *oldStack,BobValue *oldTop,BobValue *newTop)
 {
-    BobValue new,*src,*dst;
+    BlockFrame *block = (BlockFrame *)frame;
+    BobValue env = (BobValue)&block->stackEnv;
+    block->env = RelocateStackPointer(block->env,oldStack,oldTop,newTop);
+    if (BobStackEnvironmentP(env))
+        BobSetEnvNextFrame(env,RelocateStackPointer(BobEnvNextFrame(env),oldStack,oldTop,newTop));
+}
+
+/* UnstackEnv - unstack the current environment */
+static BobValue UnstackEnv(BobInterpreter *c)
+{
+    BobValue env,new,*src,*dst;
     long size;
 
-    /* initialize */
+    /* initialize (the environment is fetched after the stack may have moved) */
     BobCheck(c,3);
+    env = c->env;
     BobPush(c,c->nilValue);
     BobPush(c,c->nilValue);
 
@@ -889,8 +982,10 @@ static BobValue UnstackEnv(BobInterpreter *c,BobValue env)
         /* link the new frame into the new environment */
         if (BobTop(c) == c->nilValue)
             c->sp[1] = new;
-        else
+        else {
+            BobWriteBarrier(c,BobTop(c),new);
             BobSetEnvNextFrame(BobTop(c),new);
+        }
         BobSetTop(c,new);
         
         /* get next frame */
@@ -907,8 +1002,10 @@ static BobValue UnstackEnv(BobInterpreter *c,BobValue env)
     /* link the first heap frame into the new environment */
     if (BobTop(c) == c->nilValue)
         c->sp[1] = env;
-    else
+    else {
+        BobWriteBarrier(c,BobTop(c),env);
         BobSetEnvNextFrame(BobTop(c),env);
+    }
     BobDrop(c,1);
 
     /* return the new environment */
@@ -975,13 +1072,15 @@ int BobEql(BobValue obj1,BobValue obj2)
     }
 #endif
     else if (BobStringP(obj1))
-        return BobStringP(obj2) && CompareStrings(obj1,obj2) == 0;
+        return BobStringP(obj2)
+            && BobStringSize(obj1) == BobStringSize(obj2)
+            && memcmp(BobStringAddress(obj1),BobStringAddress(obj2),BobStringSize(obj1)) == 0;
     else
         return obj1 == obj2;
 }
 
-/* CompareObjects - compare two objects */
-static int CompareObjects(BobInterpreter *c,BobValue obj1,BobValue obj2)
+/* BobCompareObjects - compare two objects */
+int BobCompareObjects(BobInterpreter *c,BobValue obj1,BobValue obj2)
 {
     if (BobIntegerP(obj1) && BobIntegerP(obj2)) {
         BobIntegerType diff = BobIntegerValue(obj1) - BobIntegerValue(obj2);
@@ -1022,15 +1121,11 @@ static int CompareObjects(BobInterpreter *c,BobValue obj1,BobValue obj2)
 /* CompareStrings - compare two strings */
 static int CompareStrings(BobValue str1,BobValue str2)
 {
-    unsigned char *p1 = BobStringAddress(str1);
     long len1 = BobStringSize(str1);
-    unsigned char *p2 = BobStringAddress(str2);
     long len2 = BobStringSize(str2);
-    while (len1 > 0 && len2 > 0 && *p1++ == *p2++)
-        --len1, --len2;
-    if (len1 == 0) return len2 == 0 ? 0 : -1;
-    if (len2 == 0) return 1;
-    return *--p1 - *--p2 < 0 ? -1 : *p1 == *p2 ? 0 : 1;
+    int cmp = memcmp(BobStringAddress(str1),BobStringAddress(str2),len1 < len2 ? len1 : len2);
+    if (cmp != 0) return cmp < 0 ? -1 : 1;
+    return len1 < len2 ? -1 : len1 == len2 ? 0 : 1;
 }
 
 /* ConcatenateStrings - concatenate two strings */
@@ -1056,6 +1151,33 @@ static BobValue ConcatenateStrings(BobInterpreter *c,BobValue str1,BobValue str2
     return new;
 }
 
+/* BobRelocateStack - relocate the registers and frames after the stack moves */
+void BobRelocateStack(BobInterpreter *c,BobValue *oldStack,BobValue *oldTop,BobValue *newTop)
+{
+    BobFrame *fp;
+
+    /* relocate the registers */
+    c->argv = (BobValue *)RelocateStackPointer((BobValue)c->argv,oldStack,oldTop,newTop);
+    c->fp = (BobFrame *)RelocateStackPointer((BobValue)c->fp,oldStack,oldTop,newTop);
+    c->env = RelocateStackPointer(c->env,oldStack,oldTop,newTop);
+    c->sp = newTop - (oldTop - c->sp);
+
+    /* relocate the frame links and the environment pointers in each frame */
+    for (fp = c->fp; fp < (BobFrame *)newTop; fp = fp->next) {
+        fp->next = (BobFrame *)RelocateStackPointer((BobValue)fp->next,oldStack,oldTop,newTop);
+        (*fp->dispatch->relocate)(fp,oldStack,oldTop,newTop);
+    }
+}
+
+/* RelocateStackPointer - move a pointer into the old stack to the new stack */
+static BobValue RelocateStackPointer(BobValue v,BobValue *oldStack,BobValue *oldTop,BobValue *newTop)
+{
+    BobValue *p = (BobValue *)v;
+    if (p >= oldStack && p <= oldTop)
+        return (BobValue)(newTop - (oldTop - p));
+    return v;
+}
+
 /* BobCopyStack - copy the stack for the garbage collector */
 void BobCopyStack(BobInterpreter *c)
 {
@@ -1073,6 +1195,22 @@ void BobCopyStack(BobInterpreter *c)
     }
 }
 
+/* BobGetCallStack - get the code objects of the active functions (innermost first) */
+int BobGetCallStack(BobInterpreter *c,BobValue *codes,int max)
+{
+    BobFrame *fp = c->fp;
+    int n = 0;
+    if (c->code && n < max)
+        codes[n++] = c->code;
+    while (n < max && fp < (BobFrame *)c->stackTop) {
+        CallFrame *frame = (CallFrame *)fp;
+        if (CallFrameP(frame) && frame->code)
+            codes[n++] = frame->code;
+        fp = fp->next;
+    }
+    return n;
+}
+
 /* BobStackTrace - display a stack trace */
 void BobStackTrace(BobInterpreter *c)
 {
@@ -1089,7 +1227,7 @@ void BobStackTrace(BobInterpreter *c)
     }
     while (fp < (BobFrame *)c->stackTop) {
         CallFrame *frame = (CallFrame *)fp;
-        if (frame->hdr.dispatch == &BobCallCDispatch && frame->code) {
+        if (CallFrameP(frame) && frame->code) {
             BobValue name = BobCompiledCodeName(frame->code);
             if (!calledFromP) {
                 BobStreamPutS("Called from:\n",c->standardOutput);
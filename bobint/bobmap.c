@@ -0,0 +1,712 @@
+/* bobmap.c - 'SortedMap' handler */
+/*
+        Copyright (c) 2001, by David Michael Betz
+        All rights reserved
+*/
+
+/*
+    A sorted map keeps its entries ordered by key in a B-tree.  Each node
+    holds up to 31 keys in a flat array so a search touches a handful of
+    nodes and does a binary search within each one instead of following
+    a pointer per comparison.  Leaves don't have room for children which
+    makes them a little over half the size of an interior node.
+
+    Keys are integers, floats or strings and are ordered the same way
+    '<' orders them.  An integer and a float with the same value are the
+    same key.  Mixing strings and numbers in the same map is a type error.
+
+    Nodes are split on the way down when a key is inserted and refilled
+    on the way down when one is removed so neither ever has to walk back
+    up the tree.  Since allocating a node can move the map, an insert
+    that needs a new node allocates it, leaves it in the map as a spare
+    and then starts over from the root.
+*/
+
+#include <stddef.h>
+#include <string.h>
+#include "bob.h"
+
+/* minimum degree of the tree (a node other than the root has from
+   SortedMapDegree - 1 to SortedMapMaxKeys keys) */
+#define SortedMapDegree             16
+#define SortedMapMaxKeys            (SortedMapDegree * 2 - 1)
+
+/* tree node structure */
+typedef struct {
+    BobDispatch *dispatch;
+    BobIntegerType count;           /* number of keys */
+    BobIntegerType leafP;           /* node has no children */
+    BobValue keys[SortedMapMaxKeys];
+    BobValue values[SortedMapMaxKeys];
+    BobValue children[SortedMapMaxKeys + 1]; /* interior nodes only */
+} MapNode;
+
+#define NodeCount(o)                (((MapNode *)o)->count)
+#define SetNodeCount(o,v)           (((MapNode *)o)->count = (v))
+#define NodeLeafP(o)                (((MapNode *)o)->leafP)
+#define SetNodeLeafP(o,v)           (((MapNode *)o)->leafP = (v))
+#define NodeKeys(o)                 (((MapNode *)o)->keys)
+#define NodeValues(o)               (((MapNode *)o)->values)
+#define NodeChildren(o)             (((MapNode *)o)->children)
+#define NodeFullP(o)                (NodeCount(o) == SortedMapMaxKeys)
+#define NodeMinimalP(o)             (NodeCount(o) < SortedMapDegree)
+
+/* sorted map structure */
+typedef struct {
+    BobCObject hdr;
+    BobValue root;                  /* root node or nil */
+    BobValue spare;                 /* node allocated for an insert or nil */
+    BobIntegerType count;           /* number of entries */
+} SortedMap;
+
+#define MapRoot(o)                  (((SortedMap *)o)->root)
+#define SetMapRoot(o,v)             (((SortedMap *)o)->root = (v))
+#define MapSpare(o)                 (((SortedMap *)o)->spare)
+#define SetMapSpare(o,v)            (((SortedMap *)o)->spare = (v))
+#define MapCount(o)                 (((SortedMap *)o)->count)
+#define SetMapCount(o,v)            (((SortedMap *)o)->count = (v))
+
+/* 'SortedMap' dispatch */
+BobDispatch *BobSortedMapDispatch = NULL;
+
+/* SortedMap methods */
+static BobValue BIF_initialize(BobInterpreter *c);
+static BobValue BIF_Get(BobInterpreter *c);
+static BobValue BIF_Set(BobInterpreter *c);
+static BobValue BIF_Remove(BobInterpreter *c);
+static BobValue BIF_Exists(BobInterpreter *c);
+static BobValue BIF_Floor(BobInterpreter *c);
+static BobValue BIF_Ceiling(BobInterpreter *c);
+static BobValue BIF_First(BobInterpreter *c);
+static BobValue BIF_Last(BobInterpreter *c);
+static BobValue BIF_Keys(BobInterpreter *c);
+static BobValue BIF_Values(BobInterpreter *c);
+static BobValue BIF_Clear(BobInterpreter *c);
+
+static BobCMethod methods[] = {
+BobMethodEntry( "initialize",       BIF_initialize      ),
+BobMethodEntry( "Get",              BIF_Get             ),
+BobMethodEntry( "Set",              BIF_Set             ),
+BobMethodEntry( "Remove",           BIF_Remove          ),
+BobMethodEntry( "Exists",           BIF_Exists          ),
+BobMethodEntry( "Floor",            BIF_Floor           ),
+BobMethodEntry( "Ceiling",          BIF_Ceiling         ),
+BobMethodEntry( "First",            BIF_First           ),
+BobMethodEntry( "Last",             BIF_Last            ),
+BobMethodEntry( "Keys",             BIF_Keys            ),
+BobMethodEntry( "Values",           BIF_Values          ),
+BobMethodEntry( "Clear",            BIF_Clear           ),
+BobMethodEntry(	0,                  0                   )
+};
+
+/* SortedMap properties */
+static BobValue BIF_size(BobInterpreter *c,BobValue obj);
+
+static BobVPMethod properties[] = {
+BobVPMethodEntry( "size",           BIF_size,           0                   ),
+BobVPMethodEntry( 0,                0,					0					)
+};
+
+/* prototypes */
+static BobValue SortedMapNewInstance(BobInterpreter *c,BobValue parent);
+static void SortedMapScan(BobInterpreter *c,BobValue obj);
+static long MapNodeSize(BobValue obj);
+static void MapNodeScan(BobInterpreter *c,BobValue obj);
+static BobValue MakeNode(BobInterpreter *c,int leafP);
+static BobValue TakeSpare(BobInterpreter *c,BobValue map,int leafP);
+static int Insert(BobInterpreter *c,BobValue map,BobValue key,BobValue value,int *pLeafP);
+static int Delete(BobInterpreter *c,BobValue map,BobValue key);
+static BobValue *Find(BobInterpreter *c,BobValue map,BobValue key);
+static BobValue FindBound(BobInterpreter *c,int ceilingP);
+static BobValue MakeRangeVector(BobInterpreter *c,int valuesP);
+static BobIntegerType VisitRange(BobInterpreter *c,BobValue node,BobValue lo,BobValue hi,int valuesP,BobValue **pp);
+static int Search(BobInterpreter *c,BobValue node,BobValue key,int *pFoundP);
+static void SplitChild(BobInterpreter *c,BobValue node,int i,BobValue sibling);
+static void MergeChildren(BobInterpreter *c,BobValue node,int i);
+static void RotateRight(BobInterpreter *c,BobValue node,int i);
+static void RotateLeft(BobInterpreter *c,BobValue node,int i);
+static void CheckKey(BobInterpreter *c,BobValue key);
+
+/* MapNode dispatch */
+static BobDispatch MapNodeDispatch = {
+    "MapNode",
+    &MapNodeDispatch,
+    BobDefaultGetProperty,
+    BobDefaultSetProperty,
+    BobDefaultNewInstance,
+    BobDefaultPrint,
+    MapNodeSize,
+    BobDefaultCopy,
+    MapNodeScan,
+    BobDefaultHash
+};
+
+/* BobInitSortedMap - initialize the 'SortedMap' object */
+void BobInitSortedMap(BobInterpreter *c)
+{
+    if (!(BobSortedMapDispatch = BobEnterCObjectType(c,NULL,"SortedMap",methods,properties,
+                                                     sizeof(SortedMap) - sizeof(BobCObject))))
+        BobInsufficientMemory(c);
+    BobSortedMapDispatch->newInstance = SortedMapNewInstance;
+    BobSortedMapDispatch->scan = SortedMapScan;
+}
+
+/* SortedMapNewInstance - SortedMap new instance handler */
+static BobValue SortedMapNewInstance(BobInterpreter *c,BobValue parent)
+{
+    BobValue obj = BobMakeCObject(c,BobSortedMapDispatch);
+    SetMapRoot(obj,c->nilValue);
+    SetMapSpare(obj,c->nilValue);
+    SetMapCount(obj,0);
+    return obj;
+}
+
+/* SortedMapScan - SortedMap scan handler */
+static void SortedMapScan(BobInterpreter *c,BobValue obj)
+{
+    BobCObjectDispatch.scan(c,obj);
+    SetMapRoot(obj,BobCopyValue(c,MapRoot(obj)));
+    SetMapSpare(obj,BobCopyValue(c,MapSpare(obj)));
+}
+
+/* MapNodeSize - MapNode size handler */
+static long MapNodeSize(BobValue obj)
+{
+    return NodeLeafP(obj) ? offsetof(MapNode,children) : sizeof(MapNode);
+}
+
+/* MapNodeScan - MapNode scan handler */
+static void MapNodeScan(BobInterpreter *c,BobValue obj)
+{
+    BobIntegerType count = NodeCount(obj),i;
+    for (i = 0; i < count; ++i) {
+        NodeKeys(obj)[i] = BobCopyValue(c,NodeKeys(obj)[i]);
+        NodeValues(obj)[i] = BobCopyValue(c,NodeValues(obj)[i]);
+    }
+    if (!NodeLeafP(obj))
+        for (i = 0; i <= count; ++i)
+            NodeChildren(obj)[i] = BobCopyValue(c,NodeChildren(obj)[i]);
+}
+
+/* BIF_initialize - built-in method 'initialize' */
+static BobValue BIF_initialize(BobInterpreter *c)
+{
+    BobValue obj;
+    BobParseArguments(c,"V=*",&obj,BobSortedMapDispatch);
+    return obj;
+}
+
+/* BIF_Get - built-in method 'Get' */
+static BobValue BIF_Get(BobInterpreter *c)
+{
+    BobValue map,key,*p;
+    BobValue value = c->nilValue;
+    BobParseArguments(c,"V=*V|V",&map,BobSortedMapDispatch,&key,&value);
+    CheckKey(c,key);
+    if ((p = Find(c,map,key)) == NULL)
+        return value;
+    return *p;
+}
+
+/* BIF_Set - built-in method 'Set' */
+static BobValue BIF_Set(BobInterpreter *c)
+{
+    BobValue map,key,value,node;
+    int leafP;
+    BobParseArguments(c,"V=*VV",&map,BobSortedMapDispatch,&key,&value);
+    CheckKey(c,key);
+    while (!Insert(c,map,key,value,&leafP)) {
+        node = MakeNode(c,leafP);
+        map = BobGetArg(c,1);
+        key = BobGetArg(c,3);
+        value = BobGetArg(c,4);
+        BobWriteBarrier(c,map,node);
+        SetMapSpare(map,node);
+    }
+    return value;
+}
+
+/* BIF_Remove - built-in method 'Remove' */
+static BobValue BIF_Remove(BobInterpreter *c)
+{
+    BobValue map,key;
+    BobParseArguments(c,"V=*V",&map,BobSortedMapDispatch,&key);
+    CheckKey(c,key);
+    return BobToBoolean(c,Delete(c,map,key));
+}
+
+/* BIF_Exists - built-in method 'Exists' */
+static BobValue BIF_Exists(BobInterpreter *c)
+{
+    BobValue map,key;
+    BobParseArguments(c,"V=*V",&map,BobSortedMapDispatch,&key);
+    CheckKey(c,key);
+    return BobToBoolean(c,Find(c,map,key) != NULL);
+}
+
+/* BIF_Floor - built-in method 'Floor' */
+static BobValue BIF_Floor(BobInterpreter *c)
+{
+    BobValue map,key;
+    BobParseArguments(c,"V=*V",&map,BobSortedMapDispatch,&key);
+    CheckKey(c,key);
+    return FindBound(c,FALSE);
+}
+
+/* BIF_Ceiling - built-in method 'Ceiling' */
+static BobValue BIF_Ceiling(BobInterpreter *c)
+{
+    BobValue map,key;
+    BobParseArguments(c,"V=*V",&map,BobSortedMapDispatch,&key);
+    CheckKey(c,key);
+    return FindBound(c,TRUE);
+}
+
+/* BIF_First - built-in method 'First' */
+static BobValue BIF_First(BobInterpreter *c)
+{
+    BobValue map,node;
+    BobParseArguments(c,"V=*",&map,BobSortedMapDispatch);
+    if ((node = MapRoot(map)) == c->nilValue)
+        return c->nilValue;
+    while (!NodeLeafP(node))
+        node = NodeChildren(node)[0];
+    return NodeKeys(node)[0];
+}
+
+/* BIF_Last - built-in method 'Last' */
+static BobValue BIF_Last(BobInterpreter *c)
+{
+    BobValue map,node;
+    BobParseArguments(c,"V=*",&map,BobSortedMapDispatch);
+    if ((node = MapRoot(map)) == c->nilValue)
+        return c->nilValue;
+    while (!NodeLeafP(node))
+        node = NodeChildren(node)[NodeCount(node)];
+    return NodeKeys(node)[NodeCount(node) - 1];
+}
+
+/* BIF_Keys - built-in method 'Keys' */
+static BobValue BIF_Keys(BobInterpreter *c)
+{
+    return MakeRangeVector(c,FALSE);
+}
+
+/* BIF_Values - built-in method 'Values' */
+static BobValue BIF_Values(BobInterpreter *c)
+{
+    return MakeRangeVector(c,TRUE);
+}
+
+/* BIF_Clear - built-in method 'Clear' */
+static BobValue BIF_Clear(BobInterpreter *c)
+{
+    BobValue map;
+    BobParseArguments(c,"V=*",&map,BobSortedMapDispatch);
+    SetMapRoot(map,c->nilValue);
+    SetMapSpare(map,c->nilValue);
+    SetMapCount(map,0);
+    return map;
+}
+
+/* BIF_size - built-in property 'size' */
+static BobValue BIF_size(BobInterpreter *c,BobValue obj)
+{
+    return BobMakeInteger(c,MapCount(obj));
+}
+
+/* MakeNode - make an empty tree node */
+static BobValue MakeNode(BobInterpreter *c,int leafP)
+{
+    BobValue node = BobAllocate(c,leafP ? offsetof(MapNode,children) : sizeof(MapNode));
+    BobSetDispatch(node,&MapNodeDispatch);
+    SetNodeCount(node,0);
+    SetNodeLeafP(node,leafP);
+    return node;
+}
+
+/* TakeSpare - take the spare node if it is the right kind */
+static BobValue TakeSpare(BobInterpreter *c,BobValue map,int leafP)
+{
+    BobValue node = MapSpare(map);
+    if (node == c->nilValue || NodeLeafP(node) != leafP)
+        return NULL;
+    SetMapSpare(map,c->nilValue);
+    SetNodeCount(node,0);
+    return node;
+}
+
+/* Insert - insert or replace an entry splitting full nodes on the way down */
+static int Insert(BobInterpreter *c,BobValue map,BobValue key,BobValue value,int *pLeafP)
+{
+    BobValue node,sibling;
+    int i,foundP;
+
+    /* make the first leaf */
+    if ((node = MapRoot(map)) == c->nilValue) {
+        if ((node = TakeSpare(c,map,TRUE)) == NULL) {
+            *pLeafP = TRUE;
+            return FALSE;
+        }
+        BobWriteBarrier(c,map,node);
+        SetMapRoot(map,node);
+    }
+
+    /* grow the tree at the root when the root is full */
+    else if (NodeFullP(node)) {
+        BobValue root;
+        if ((root = TakeSpare(c,map,FALSE)) == NULL) {
+            *pLeafP = FALSE;
+            return FALSE;
+        }
+        BobWriteBarrier(c,root,node);
+        NodeChildren(root)[0] = node;
+        BobWriteBarrier(c,map,root);
+        SetMapRoot(map,root);
+        node = root;
+    }
+
+    /* find the leaf where the key belongs */
+    for (;;) {
+        i = Search(c,node,key,&foundP);
+        if (foundP) {
+            BobWriteBarrier(c,node,value);
+            NodeValues(node)[i] = value;
+            return TRUE;
+        }
+        if (NodeLeafP(node))
+            break;
+
+        /* split a full child before moving down into it */
+        if (NodeFullP(NodeChildren(node)[i])) {
+            BobValue child = NodeChildren(node)[i];
+            int cmp;
+            if ((sibling = TakeSpare(c,map,(int)NodeLeafP(child))) == NULL) {
+                *pLeafP = (int)NodeLeafP(child);
+                return FALSE;
+            }
+            SplitChild(c,node,i,sibling);
+            if ((cmp = BobCompareObjects(c,key,NodeKeys(node)[i])) == 0) {
+                BobWriteBarrier(c,node,value);
+                NodeValues(node)[i] = value;
+                return TRUE;
+            }
+            else if (cmp > 0)
+                ++i;
+        }
+        node = NodeChildren(node)[i];
+    }
+
+    /* add the entry to the leaf */
+    memmove(&NodeKeys(node)[i + 1],&NodeKeys(node)[i],(NodeCount(node) - i) * sizeof(BobValue));
+    memmove(&NodeValues(node)[i + 1],&NodeValues(node)[i],(NodeCount(node) - i) * sizeof(BobValue));
+    BobWriteBarrier(c,node,key);
+    BobWriteBarrier(c,node,value);
+    NodeKeys(node)[i] = key;
+    NodeValues(node)[i] = value;
+    SetNodeCount(node,NodeCount(node) + 1);
+    SetMapCount(map,MapCount(map) + 1);
+    return TRUE;
+}
+
+/* Delete - remove an entry refilling minimal nodes on the way down */
+static int Delete(BobInterpreter *c,BobValue map,BobValue key)
+{
+    BobValue root = MapRoot(map),node,child;
+    int i,foundP,deletedP = FALSE;
+
+    /* check for an empty map */
+    if ((node = root) == c->nilValue)
+        return FALSE;
+
+    for (;;) {
+        i = Search(c,node,key,&foundP);
+
+        /* remove the key from a leaf */
+        if (NodeLeafP(node)) {
+            if (foundP) {
+                int n = (int)NodeCount(node) - i - 1;
+                memmove(&NodeKeys(node)[i],&NodeKeys(node)[i + 1],n * sizeof(BobValue));
+                memmove(&NodeValues(node)[i],&NodeValues(node)[i + 1],n * sizeof(BobValue));
+                SetNodeCount(node,NodeCount(node) - 1);
+                deletedP = TRUE;
+            }
+            break;
+        }
+
+        /* replace a key in an interior node with its predecessor or successor */
+        if (foundP) {
+            BobValue left = NodeChildren(node)[i];
+            BobValue right = NodeChildren(node)[i + 1];
+            if (!NodeMinimalP(left)) {
+                for (child = left; !NodeLeafP(child); )
+                    child = NodeChildren(child)[NodeCount(child)];
+                BobWriteBarrierAll(c,node);
+                key = NodeKeys(node)[i] = NodeKeys(child)[NodeCount(child) - 1];
+                NodeValues(node)[i] = NodeValues(child)[NodeCount(child) - 1];
+                node = left;
+            }
+            else if (!NodeMinimalP(right)) {
+                for (child = right; !NodeLeafP(child); )
+                    child = NodeChildren(child)[0];
+                BobWriteBarrierAll(c,node);
+                key = NodeKeys(node)[i] = NodeKeys(child)[0];
+                NodeValues(node)[i] = NodeValues(child)[0];
+                node = right;
+            }
+            else {
+                MergeChildren(c,node,i);
+                node = left;
+            }
+            continue;
+        }
+
+        /* make sure the child has a key to spare before moving down into it
+           (a root without keys is left by an insert that ran out of memory) */
+        if (NodeCount(node) > 0 && NodeMinimalP(NodeChildren(node)[i])) {
+            if (i > 0 && !NodeMinimalP(NodeChildren(node)[i - 1]))
+                RotateRight(c,node,i);
+            else if (i < NodeCount(node) && !NodeMinimalP(NodeChildren(node)[i + 1]))
+                RotateLeft(c,node,i);
+            else if (i < NodeCount(node))
+                MergeChildren(c,node,i);
+            else
+                MergeChildren(c,node,--i);
+        }
+        node = NodeChildren(node)[i];
+    }
+
+    /* shrink the tree when the root runs out of keys */
+    if (NodeCount(root) == 0) {
+        BobWriteBarrierAll(c,map);
+        SetMapRoot(map,NodeLeafP(root) ? c->nilValue : NodeChildren(root)[0]);
+    }
+
+    /* update the entry count */
+    if (deletedP)
+        SetMapCount(map,MapCount(map) - 1);
+    return deletedP;
+}
+
+/* Find - find the value of an entry */
+static BobValue *Find(BobInterpreter *c,BobValue map,BobValue key)
+{
+    BobValue node = MapRoot(map);
+    int i,foundP;
+    if (node == c->nilValue)
+        return NULL;
+    for (;;) {
+        i = Search(c,node,key,&foundP);
+        if (foundP)
+            return &NodeValues(node)[i];
+        if (NodeLeafP(node))
+            return NULL;
+        node = NodeChildren(node)[i];
+    }
+}
+
+/* FindBound - find the greatest key not above or the least key not below the second argument */
+static BobValue FindBound(BobInterpreter *c,int ceilingP)
+{
+    BobValue node = MapRoot(BobGetArg(c,1)),key = BobGetArg(c,3);
+    BobValue bound = c->nilValue;
+    int i,foundP;
+    if (node == c->nilValue)
+        return bound;
+    for (;;) {
+        i = Search(c,node,key,&foundP);
+        if (foundP)
+            return NodeKeys(node)[i];
+        if (ceilingP) {
+            if (i < NodeCount(node))
+                bound = NodeKeys(node)[i];
+        }
+        else if (i > 0)
+            bound = NodeKeys(node)[i - 1];
+        if (NodeLeafP(node))
+            return bound;
+        node = NodeChildren(node)[i];
+    }
+}
+
+/* MakeRangeVector - make a vector of the keys or values from the first key not below
+   the optional lower bound up to but not including the optional upper bound */
+static BobValue MakeRangeVector(BobInterpreter *c,int valuesP)
+{
+    BobValue map,lo = c->nilValue,hi = c->nilValue,vector,*p;
+    BobIntegerType count;
+    BobParseArguments(c,"V=*|VV",&map,BobSortedMapDispatch,&lo,&hi);
+    if (lo != c->nilValue)
+        CheckKey(c,lo);
+    if (hi != c->nilValue)
+        CheckKey(c,hi);
+
+    /* count the entries in the range */
+    if (MapRoot(map) == c->nilValue)
+        count = 0;
+    else if (lo == c->nilValue && hi == c->nilValue)
+        count = MapCount(map);
+    else
+        count = VisitRange(c,MapRoot(map),lo,hi,valuesP,NULL);
+
+    /* make the vector and fill it */
+    vector = BobMakeVector(c,count);
+    if (count > 0) {
+        map = BobGetArg(c,1);
+        lo = BobArgCnt(c) >= 3 ? BobGetArg(c,3) : c->nilValue;
+        hi = BobArgCnt(c) >= 4 ? BobGetArg(c,4) : c->nilValue;
+        p = BobVectorAddress(vector);
+        VisitRange(c,MapRoot(map),lo,hi,valuesP,&p);
+    }
+    return vector;
+}
+
+/* VisitRange - count or collect the entries of a subtree that are in a range */
+static BobIntegerType VisitRange(BobInterpreter *c,BobValue node,BobValue lo,BobValue hi,int valuesP,BobValue **pp)
+{
+    BobIntegerType count = 0;
+    int i = 0,foundP;
+
+    /* skip the keys below the lower bound */
+    if (lo != c->nilValue)
+        i = Search(c,node,lo,&foundP);
+
+    /* visit the entries and the subtrees between them */
+    for (;; ++i) {
+        if (!NodeLeafP(node)) {
+            count += VisitRange(c,NodeChildren(node)[i],lo,hi,valuesP,pp);
+            lo = c->nilValue;
+        }
+        if (i >= NodeCount(node)
+        ||  (hi != c->nilValue && BobCompareObjects(c,NodeKeys(node)[i],hi) >= 0))
+            break;
+        if (pp)
+            *(*pp)++ = valuesP ? NodeValues(node)[i] : NodeKeys(node)[i];
+        ++count;
+    }
+    return count;
+}
+
+/* Search - find the index of the first key in a node that is not below a key */
+static int Search(BobInterpreter *c,BobValue node,BobValue key,int *pFoundP)
+{
+    int lo = 0,hi = (int)NodeCount(node),mid,cmp;
+    BobValue *keys = NodeKeys(node);
+    *pFoundP = FALSE;
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        if ((cmp = BobCompareObjects(c,keys[mid],key)) < 0)
+            lo = mid + 1;
+        else if (cmp > 0)
+            hi = mid;
+        else {
+            *pFoundP = TRUE;
+            return mid;
+        }
+    }
+    return lo;
+}
+
+/* SplitChild - split the full child 'i' of a node moving its upper half to 'sibling' */
+static void SplitChild(BobInterpreter *c,BobValue node,int i,BobValue sibling)
+{
+    BobValue child = NodeChildren(node)[i];
+    int n = (int)NodeCount(node);
+
+    /* the spare sibling and the node may be older than the child */
+    BobWriteBarrierAll(c,sibling);
+    BobWriteBarrierAll(c,node);
+
+    /* move the upper half of the child to its new sibling */
+    memcpy(NodeKeys(sibling),&NodeKeys(child)[SortedMapDegree],(SortedMapDegree - 1) * sizeof(BobValue));
+    memcpy(NodeValues(sibling),&NodeValues(child)[SortedMapDegree],(SortedMapDegree - 1) * sizeof(BobValue));
+    if (!NodeLeafP(child))
+        memcpy(NodeChildren(sibling),&NodeChildren(child)[SortedMapDegree],SortedMapDegree * sizeof(BobValue));
+    SetNodeCount(sibling,SortedMapDegree - 1);
+    SetNodeCount(child,SortedMapDegree - 1);
+
+    /* move the middle key of the child up into the node */
+    memmove(&NodeChildren(node)[i + 2],&NodeChildren(node)[i + 1],(n - i) * sizeof(BobValue));
+    memmove(&NodeKeys(node)[i + 1],&NodeKeys(node)[i],(n - i) * sizeof(BobValue));
+    memmove(&NodeValues(node)[i + 1],&NodeValues(node)[i],(n - i) * sizeof(BobValue));
+    NodeChildren(node)[i + 1] = sibling;
+    NodeKeys(node)[i] = NodeKeys(child)[SortedMapDegree - 1];
+    NodeValues(node)[i] = NodeValues(child)[SortedMapDegree - 1];
+    SetNodeCount(node,n + 1);
+}
+
+/* MergeChildren - merge child 'i + 1' and key 'i' of a node into child 'i' */
+static void MergeChildren(BobInterpreter *c,BobValue node,int i)
+{
+    BobValue left = NodeChildren(node)[i],right = NodeChildren(node)[i + 1];
+    int n = (int)NodeCount(node),ln = (int)NodeCount(left),rn = (int)NodeCount(right);
+    BobWriteBarrierAll(c,left);
+
+    /* move the key down and the right child's entries into the left child */
+    NodeKeys(left)[ln] = NodeKeys(node)[i];
+    NodeValues(left)[ln] = NodeValues(node)[i];
+    memcpy(&NodeKeys(left)[ln + 1],NodeKeys(right),rn * sizeof(BobValue));
+    memcpy(&NodeValues(left)[ln + 1],NodeValues(right),rn * sizeof(BobValue));
+    if (!NodeLeafP(left))
+        memcpy(&NodeChildren(left)[ln + 1],NodeChildren(right),(rn + 1) * sizeof(BobValue));
+    SetNodeCount(left,ln + rn + 1);
+
+    /* remove the key and the right child from the node */
+    memmove(&NodeKeys(node)[i],&NodeKeys(node)[i + 1],(n - i - 1) * sizeof(BobValue));
+    memmove(&NodeValues(node)[i],&NodeValues(node)[i + 1],(n - i - 1) * sizeof(BobValue));
+    memmove(&NodeChildren(node)[i + 1],&NodeChildren(node)[i + 2],(n - i - 1) * sizeof(BobValue));
+    SetNodeCount(node,n - 1);
+}
+
+/* RotateRight - move a key from child 'i - 1' of a node through the node into child 'i' */
+static void RotateRight(BobInterpreter *c,BobValue node,int i)
+{
+    BobValue left = NodeChildren(node)[i - 1],child = NodeChildren(node)[i];
+    int ln = (int)NodeCount(left),n = (int)NodeCount(child);
+    BobWriteBarrierAll(c,node);
+    BobWriteBarrierAll(c,child);
+    memmove(&NodeKeys(child)[1],NodeKeys(child),n * sizeof(BobValue));
+    memmove(&NodeValues(child)[1],NodeValues(child),n * sizeof(BobValue));
+    NodeKeys(child)[0] = NodeKeys(node)[i - 1];
+    NodeValues(child)[0] = NodeValues(node)[i - 1];
+    if (!NodeLeafP(child)) {
+        memmove(&NodeChildren(child)[1],NodeChildren(child),(n + 1) * sizeof(BobValue));
+        NodeChildren(child)[0] = NodeChildren(left)[ln];
+    }
+    NodeKeys(node)[i - 1] = NodeKeys(left)[ln - 1];
+    NodeValues(node)[i - 1] = NodeValues(left)[ln - 1];
+    SetNodeCount(left,ln - 1);
+    SetNodeCount(child,n + 1);
+}
+
+/* RotateLeft - move a key from child 'i + 1' of a node through the node into child 'i' */
+static void RotateLeft(BobInterpreter *c,BobValue node,int i)
+{
+    BobValue child = NodeChildren(node)[i],right = NodeChildren(node)[i + 1];
+    int n = (int)NodeCount(child),rn = (int)NodeCount(right);
+    BobWriteBarrierAll(c,node);
+    BobWriteBarrierAll(c,child);
+    NodeKeys(child)[n] = NodeKeys(node)[i];
+    NodeValues(child)[n] = NodeValues(node)[i];
+    if (!NodeLeafP(child))
+        NodeChildren(child)[n + 1] = NodeChildren(right)[0];
+    NodeKeys(node)[i] = NodeKeys(right)[0];
+    NodeValues(node)[i] = NodeValues(right)[0];
+    memmove(NodeKeys(right),&NodeKeys(right)[1],(rn - 1) * sizeof(BobValue));
+    memmove(NodeValues(right),&NodeValues(right)[1],(rn - 1) * sizeof(BobValue));
+    if (!NodeLeafP(right))
+        memmove(NodeChildren(right),&NodeChildren(right)[1],rn * sizeof(BobValue));
+    SetNodeCount(child,n + 1);
+    SetNodeCount(right,rn - 1);
+}
+
+/* CheckKey - make sure a value can be used as a key */
+static void CheckKey(BobInterpreter *c,BobValue key)
+{
+    if (!BobIntegerP(key)
+#ifdef BOB_INCLUDE_FLOAT_SUPPORT
+    &&  !BobFloatP(key)
+#endif
+    &&  !BobStringP(key))
+        BobTypeError(c,key);
+}
@@ -46,8 +46,8 @@ BobMethodEntry( "pow",              BIF_pow             ),
 BobMethodEntry( 0,					0					)
 };
 
-/* local variables */
-static BobFloatType oneOverLog2;
+/* inverse of the log of 2 */
+#define OneOverLog2     1.44269504088896340736
 
 /* prototypes */
 static BobFloatType FloatValue(BobValue val);
@@ -55,9 +55,6 @@ static BobFloatType FloatValue(BobValue val);
 /* BobUseMath - initialize the math functions */
 void BobUseMath(BobInterpreter *c)
 {
-    /* compute the inverse of the log of 2 */
-    oneOverLog2 = 1.0 / log(2.0);
-
     /* enter the built-in functions */
     BobEnterFunctions(c,functionTable);
 
@@ -186,7 +183,7 @@ static BobValue BIF_log2(BobInterpreter *c)
 {
     BobCheckArgCnt(c,3);
     BobCheckType(c,3,BobNumberP);
-    return BobMakeFloat(c,(BobFloatType)log(FloatValue(BobGetArg(c,3))) * oneOverLog2);
+    return BobMakeFloat(c,(BobFloatType)log(FloatValue(BobGetArg(c,3))) * OneOverLog2);
 }
 
 /* BIF_log10 - built-in function 'log10' */
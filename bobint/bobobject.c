@@ -196,8 +196,10 @@ static int SetObjectProperty(BobInterpreter *c,BobValue obj,BobValue tag,BobValu
     BobValue p;
     if (!(p = BobFindProperty(c,obj,tag,&hashValue,&i)))
         BobAddProperty(c,obj,tag,value,hashValue,i);
-    else
+    else {
+        BobWriteBarrier(c,p,value);
         BobSetPropertyValue(p,value);
+    }
     return TRUE;
 }
 
@@ -236,9 +238,11 @@ BobValue BobCloneObject(BobInterpreter *c,BobValue obj)
     BobPush(c,BobMakeObject(c,BobObjectClass(obj)));
     properties = BobObjectProperties(c->sp[1]);
     if (BobHashTableP(properties))
-        BobSetObjectProperties(BobTop(c),CopyPropertyTable(c,properties));
+        properties = CopyPropertyTable(c,properties);
     else
-        BobSetObjectProperties(BobTop(c),CopyPropertyList(c,properties));
+        properties = CopyPropertyList(c,properties);
+    BobWriteBarrier(c,BobTop(c),properties);
+    BobSetObjectProperties(BobTop(c),properties);
     BobSetObjectPropertyCount(BobTop(c),BobObjectPropertyCount(c->sp[1]));
     obj = BobPop(c);
     BobDrop(c,1);
@@ -275,6 +279,7 @@ static BobValue CopyPropertyTable(BobInterpreter *c,BobValue table)
     BobPush(c,table);
     for (i = 0; i < size; ++i) {
         BobValue properties = CopyPropertyList(c,BobHashTableElement(BobTop(c),i));
+        BobWriteBarrier(c,c->sp[1],properties);
         BobSetHashTableElement(c->sp[1],i,properties);
     }
     BobDrop(c,1);
@@ -314,6 +319,7 @@ void BobAddProperty(BobInterpreter *c,BobValue obj,BobValue tag,BobValue value,B
             obj = BobPop(c);
         }
         BobSetPropertyNext(p,BobHashTableElement(BobObjectProperties(obj),i));
+        BobWriteBarrier(c,BobObjectProperties(obj),p);
         BobSetHashTableElement(BobObjectProperties(obj),i,p);
     }
     else {
@@ -321,6 +327,7 @@ void BobAddProperty(BobInterpreter *c,BobValue obj,BobValue tag,BobValue value,B
             CreateHashTable(c,obj,p);
         else {
             BobSetPropertyNext(p,BobObjectProperties(obj));
+            BobWriteBarrier(c,obj,p);
             BobSetObjectProperties(obj,p);
         }
     }
@@ -338,10 +345,12 @@ static void CreateHashTable(BobInterpreter *c,BobValue obj,BobValue p)
     table = BobMakeHashTable(c,BobHashTableCreateThreshold);
     obj = BobPop(c);
     p = BobObjectProperties(obj);
+    BobWriteBarrier(c,obj,table);
     BobSetObjectProperties(obj,table);
     while (p != c->nilValue) {
         BobValue next = BobPropertyNext(p);
         i = BobHashValue(BobPropertyTag(p)) & (BobHashTableCreateThreshold - 1);
+        BobWriteBarrier(c,p,BobHashTableElement(table,i));
         BobSetPropertyNext(p,BobHashTableElement(table,i));
         BobSetHashTableElement(table,i,p);
         p = next;
@@ -371,10 +380,12 @@ static int ExpandHashTable(BobInterpreter *c,BobValue obj,BobIntegerType hashVal
             while (p != c->nilValue) {
                 BobValue next = BobPropertyNext(p);
                 if (BobHashValue(BobPropertyTag(p)) & oldSize) {
+                    BobWriteBarrier(c,p,new1);
                     BobSetPropertyNext(p,new1);
                     new1 = p;
                 }
                 else {
+                    BobWriteBarrier(c,p,new0);
                     BobSetPropertyNext(p,new0);
                     new0 = p;
                 }
@@ -383,8 +394,11 @@ static int ExpandHashTable(BobInterpreter *c,BobValue obj,BobIntegerType hashVal
             BobSetHashTableElement(newTable,j,new0);
             BobSetHashTableElement(newTable,j + oldSize,new1);
         }
+        BobWriteBarrier(c,BobTop(c),newTable);
         BobSetObjectProperties(BobPop(c),newTable);
     }
+    else
+        newSize = oldSize;
     return hashValue & (newSize - 1);
 }
 
@@ -4,17 +4,27 @@
         All rights reserved
 */
 
+#include <string.h>
 #include "bob.h"
 
+/* prototypes */
+static void FlattenStringArguments(BobInterpreter *c,char *fmt);
+
 /* BobParseArguments - parse the argument list of a method */
 void BobParseArguments(BobInterpreter *c,char *fmt,...)
 {
     int spec,optionalP;
-    BobValue *argv = c->argv;
-    int argc = c->argc;
+    BobValue *argv;
+    int argc;
     BobValue arg;
     va_list ap;
 
+    /* string arguments without a size are returned as C strings */
+    if (strchr(fmt,'S'))
+        FlattenStringArguments(c,fmt);
+    argv = c->argv;
+    argc = c->argc;
+
     /* get the variable argument list */
     va_start(ap,fmt);
 
@@ -177,3 +187,29 @@ void BobParseArguments(BobInterpreter *c,char *fmt,...)
     else if (argc < 0 && !optionalP)
 	BobTooFewArguments(c);
 }
+
+/* FlattenStringArguments - replace slices passed for 'S' specifiers without a size with strings */
+static void FlattenStringArguments(BobInterpreter *c,char *fmt)
+{
+    BobValue arg;
+    int n = 0;
+    for (; *fmt; ++fmt)
+        switch (*fmt) {
+        case '|':
+        case '?':
+        case '#':
+        case '=':
+            break;
+        default:
+            if (++n > c->argc)
+                return;
+
+            /* a slice with a size is used in place, as is one that ends with its string */
+            if (*fmt == 'S'
+            &&  fmt[fmt[1] == '?' ? 2 : 1] != '#'
+            &&  BobStringSliceP(arg = BobGetArg(c,n))
+            &&  BobStringSliceOffset(arg) + BobStringSize(arg) != BobStringSize(BobStringSliceString(arg)))
+                BobGetArg(c,n) = BobFlattenString(c,arg);
+            break;
+        }
+}
@@ -0,0 +1,321 @@
+/* bobprof.c - allocation profiler */
+/*
+        Copyright (c) 2001, by David Michael Betz
+        All rights reserved
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "bob.h"
+
+/* initial size of the profile table */
+#define InitialTableSize    64          /* power of 2 */
+
+/* profile table entry */
+typedef struct ProfileEntry ProfileEntry;
+struct ProfileEntry {
+    BobDispatch *dispatch;              /* type of the allocated objects */
+    long pcOffset;                      /* offset of the allocating instruction */
+    int depth;                          /* number of code objects in the stack */
+    BobValue stack[BobProfileDepth];    /* allocating code objects (innermost first) */
+    unsigned long samples;              /* number of samples */
+    unsigned long bytes;                /* estimated bytes allocated */
+};
+
+/* allocation profile structure */
+struct BobAllocProfile {
+    unsigned long interval;             /* bytes between samples (zero for every allocation) */
+    long countdown;                     /* bytes until the next sample */
+    ProfileEntry pending;               /* sample waiting for its type */
+    BobValue pendingObject;             /* object allocated by the pending sample */
+    ProfileEntry *entries;              /* hash table of entries */
+    long size;                          /* size of the hash table */
+    long count;                         /* number of entries in use */
+};
+
+/* prototypes */
+static void RecordPendingSample(BobInterpreter *c,BobAllocProfile *p);
+static ProfileEntry *FindEntry(BobAllocProfile *p,ProfileEntry *key);
+static int RebuildTable(BobInterpreter *c,BobAllocProfile *p,long newSize);
+static unsigned long HashEntry(ProfileEntry *entry);
+static int SameSite(ProfileEntry *e1,ProfileEntry *e2);
+static int CompareEntries(const void *p1,const void *p2);
+static void PrintCodeName(BobInterpreter *c,BobValue code,BobStream *s);
+
+/* BobStartAllocProfile - start profiling allocations */
+int BobStartAllocProfile(BobInterpreter *c,unsigned long interval)
+{
+    BobAllocProfile *p;
+    long tableSize = InitialTableSize * sizeof(ProfileEntry);
+
+    /* discard any previous profile */
+    BobStopAllocProfile(c);
+
+    /* allocate the profile structure and hash table */
+    if ((p = (BobAllocProfile *)BobAlloc(c,sizeof(BobAllocProfile))) == NULL)
+        return FALSE;
+    memset(p,0,sizeof(BobAllocProfile));
+    if ((p->entries = (ProfileEntry *)BobAlloc(c,tableSize)) == NULL) {
+        BobFree(c,p);
+        return FALSE;
+    }
+    memset(p->entries,0,tableSize);
+    p->size = InitialTableSize;
+    p->interval = interval;
+    p->countdown = (long)interval;
+
+    /* start profiling */
+    c->allocProfile = p;
+    return TRUE;
+}
+
+/* BobStopAllocProfile - stop profiling allocations and discard the profile */
+void BobStopAllocProfile(BobInterpreter *c)
+{
+    BobAllocProfile *p = c->allocProfile;
+    if (p) {
+        c->allocProfile = NULL;
+        BobFree(c,p->entries);
+        BobFree(c,p);
+    }
+}
+
+/* BobProfileAllocation - sample an allocation (called by BobAllocate) */
+void BobProfileAllocation(BobInterpreter *c,BobValue obj,long size)
+{
+    BobAllocProfile *p = c->allocProfile;
+
+    /* the previous sample has been initialized by now */
+    RecordPendingSample(c,p);
+
+    /* check for the next sample */
+    if ((p->countdown -= size) > 0)
+        return;
+    p->countdown += (long)p->interval;
+    if (p->countdown <= 0)
+        p->countdown = (long)p->interval;
+
+    /* remember where the object was allocated */
+    p->pending.depth = BobGetCallStack(c,p->pending.stack,BobProfileDepth);
+    p->pending.pcOffset = c->code ? (long)(c->pc - c->cbase) : 0;
+    p->pending.samples = 1;
+    p->pending.bytes = p->interval ? p->interval : (unsigned long)size;
+
+    /* its type isn't known until the caller initializes it */
+    p->pendingObject = obj;
+}
+
+/* BobCopyAllocProfile - copy the code objects referenced by the profile */
+void BobCopyAllocProfile(BobInterpreter *c)
+{
+    BobAllocProfile *p = c->allocProfile;
+    ProfileEntry *entry;
+    long i;
+    int j;
+
+    /* a heap walk only visits the code objects since nothing moves */
+    if (c->heapVisitor) {
+        for (i = 0, entry = p->entries; i < p->size; ++i, ++entry)
+            if (entry->dispatch)
+                for (j = 0; j < entry->depth; ++j)
+                    BobCopyValue(c,entry->stack[j]);
+        if (p->pendingObject)
+            for (j = 0; j < p->pending.depth; ++j)
+                BobCopyValue(c,p->pending.stack[j]);
+        return;
+    }
+
+    /* record the pending sample before it moves */
+    RecordPendingSample(c,p);
+
+    /* copy the code objects */
+    for (i = 0, entry = p->entries; i < p->size; ++i, ++entry)
+        if (entry->dispatch)
+            for (j = 0; j < entry->depth; ++j)
+                entry->stack[j] = BobCopyValue(c,entry->stack[j]);
+
+    /* the code objects have moved so the table must be rehashed */
+    if (!RebuildTable(c,p,p->size))
+        BobStopAllocProfile(c);
+}
+
+/* BobDumpAllocProfile - write an allocation profile report */
+void BobDumpAllocProfile(BobInterpreter *c,BobStream *s,int foldedP)
+{
+    BobAllocProfile *p = c->allocProfile;
+    ProfileEntry *entry,**sorted;
+    unsigned long totalBytes = 0;
+    long count,i;
+    int j;
+
+    /* make sure there is a profile */
+    if (!p)
+        return;
+
+    /* include the last sample */
+    RecordPendingSample(c,p);
+
+    /* sort the entries by the number of bytes allocated */
+    if (p->count == 0
+    ||  (sorted = (ProfileEntry **)BobAlloc(c,p->count * sizeof(ProfileEntry *))) == NULL)
+        return;
+    for (i = 0, count = 0, entry = p->entries; i < p->size; ++i, ++entry)
+        if (entry->dispatch) {
+            sorted[count++] = entry;
+            totalBytes += entry->bytes;
+        }
+    qsort(sorted,count,sizeof(ProfileEntry *),CompareEntries);
+
+    /* folded stacks (outermost function first) for flame graph tools */
+    if (foldedP) {
+        for (i = 0; i < count; ++i) {
+            entry = sorted[i];
+            for (j = entry->depth; --j >= 0; ) {
+                PrintCodeName(c,entry->stack[j],s);
+                if (j == 0)
+                    BobStreamPrintF(s,"@%04lx",entry->pcOffset);
+                BobStreamPutC(';',s);
+            }
+            BobStreamPrintF(s,"%s %lu\n",entry->dispatch->typeName,entry->bytes);
+        }
+    }
+
+    /* sorted report */
+    else {
+        BobStreamPrintF(s,"%10s %6s %8s  %-16s %s\n","bytes","%","samples","type","site");
+        for (i = 0; i < count; ++i) {
+            entry = sorted[i];
+            BobStreamPrintF(s,"%10lu %5lu%% %8lu  %-16s ",
+                            entry->bytes,
+                            totalBytes ? (entry->bytes * 100) / totalBytes : 0,
+                            entry->samples,
+                            entry->dispatch->typeName);
+            if (entry->depth == 0)
+                BobStreamPutS("<native>",s);
+            else {
+                PrintCodeName(c,entry->stack[0],s);
+                BobStreamPrintF(s,"@%04lx",entry->pcOffset);
+                for (j = 1; j < entry->depth; ++j) {
+                    BobStreamPutS(" < ",s);
+                    PrintCodeName(c,entry->stack[j],s);
+                }
+            }
+            BobStreamPutC('\n',s);
+        }
+    }
+
+    /* free the sort array */
+    BobFree(c,sorted);
+}
+
+/* RecordPendingSample - add the pending sample to the profile */
+static void RecordPendingSample(BobInterpreter *c,BobAllocProfile *p)
+{
+    BobValue obj = p->pendingObject;
+    ProfileEntry *entry;
+
+    /* check for a pending sample */
+    if (!obj)
+        return;
+    p->pendingObject = NULL;
+
+    /* get the type of the sampled object */
+    p->pending.dispatch = BobQuickGetDispatch(obj);
+
+    /* make sure there is room for a new entry */
+    if (p->count * 2 >= p->size && !RebuildTable(c,p,p->size * 2))
+        return;
+
+    /* add the sample to its entry */
+    entry = FindEntry(p,&p->pending);
+    if (entry->dispatch) {
+        entry->samples += p->pending.samples;
+        entry->bytes += p->pending.bytes;
+    }
+    else {
+        *entry = p->pending;
+        ++p->count;
+    }
+}
+
+/* FindEntry - find the entry for an allocation site or an empty slot */
+static ProfileEntry *FindEntry(BobAllocProfile *p,ProfileEntry *key)
+{
+    unsigned long mask = (unsigned long)p->size - 1;
+    unsigned long i = HashEntry(key) & mask;
+    while (p->entries[i].dispatch && !SameSite(&p->entries[i],key))
+        i = (i + 1) & mask;
+    return &p->entries[i];
+}
+
+/* RebuildTable - rehash the profile entries into a new table */
+static int RebuildTable(BobInterpreter *c,BobAllocProfile *p,long newSize)
+{
+    ProfileEntry *oldEntries = p->entries,*entry;
+    long oldSize = p->size,i;
+    ProfileEntry *newEntries;
+
+    /* allocate the new table */
+    if ((newEntries = (ProfileEntry *)BobAlloc(c,newSize * sizeof(ProfileEntry))) == NULL)
+        return FALSE;
+    memset(newEntries,0,newSize * sizeof(ProfileEntry));
+
+    /* move the entries to the new table */
+    p->entries = newEntries;
+    p->size = newSize;
+    for (i = 0, entry = oldEntries; i < oldSize; ++i, ++entry)
+        if (entry->dispatch)
+            *FindEntry(p,entry) = *entry;
+    BobFree(c,oldEntries);
+    return TRUE;
+}
+
+/* HashEntry - compute the hash value of an allocation site */
+static unsigned long HashEntry(ProfileEntry *entry)
+{
+    unsigned long hash = (unsigned long)(BobPointerType)entry->dispatch;
+    int i;
+    hash = hash * 31 + (unsigned long)entry->pcOffset;
+    for (i = 0; i < entry->depth; ++i)
+        hash = hash * 31 + ((unsigned long)(BobPointerType)entry->stack[i] >> 3);
+    return hash ^ (hash >> 16);
+}
+
+/* SameSite - check whether two entries are for the same allocation site */
+static int SameSite(ProfileEntry *e1,ProfileEntry *e2)
+{
+    int i;
+    if (e1->dispatch != e2->dispatch
+    ||  e1->pcOffset != e2->pcOffset
+    ||  e1->depth != e2->depth)
+        return FALSE;
+    for (i = 0; i < e1->depth; ++i)
+        if (e1->stack[i] != e2->stack[i])
+            return FALSE;
+    return TRUE;
+}
+
+/* CompareEntries - compare entries for sorting by decreasing size */
+static int CompareEntries(const void *p1,const void *p2)
+{
+    ProfileEntry *e1 = *(ProfileEntry **)p1;
+    ProfileEntry *e2 = *(ProfileEntry **)p2;
+
+    /* sites with the same number of bytes are ordered by offset and depth so
+       the order doesn't depend on where the code objects are in the heap */
+    if (e1->bytes != e2->bytes)
+        return e1->bytes < e2->bytes ? 1 : -1;
+    else if (e1->pcOffset != e2->pcOffset)
+        return e1->pcOffset < e2->pcOffset ? -1 : 1;
+    return e1->depth - e2->depth;
+}
+
+/* PrintCodeName - print the name of a code object */
+static void PrintCodeName(BobInterpreter *c,BobValue code,BobStream *s)
+{
+    BobValue name = BobCompiledCodeName(code);
+    if (name == c->nilValue)
+        BobStreamPutS("<anonymous>",s);
+    else
+        BobDisplay(c,name,s);
+}
@@ -157,6 +157,7 @@ static int ReadCodeValue(BobInterpreter *c,BobValue *pv,BobStream *s)
             BobDrop(c,1);
             return FALSE;
         }
+        BobWriteBarrier(c,BobTop(c),v);
         BobSetBasicVectorElement(BobTop(c),i,v);
     }
     *pv = BobPop(c);
@@ -176,6 +177,7 @@ static int ReadVectorValue(BobInterpreter *c,BobValue *pv,BobStream *s)
             BobDrop(c,1);
             return FALSE;
         }
+        BobWriteBarrier(c,BobTop(c),v);
         BobSetVectorElement(BobTop(c),i,v);
     }
     *pv = BobPop(c);
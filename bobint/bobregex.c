@@ -0,0 +1,1263 @@
+/* bobregex.c - 'Regex' handler */
+/*
+        Copyright (c) 2001, by David Michael Betz
+        All rights reserved
+*/
+
+/*
+    A regular expression is compiled once into a small program for a
+    Thompson style machine.  The machine runs every possible match in
+    step, one character of the subject at a time, so it takes time
+    proportional to the length of the pattern times the length of the
+    subject no matter how the pattern is written.  Each thread carries
+    its own copy of the capture offsets and threads are kept in priority
+    order so the match found is the one a backtracking matcher would
+    find: alternatives are tried from left to right and '*', '+', '?'
+    and '{n,m}' take as much as they can unless followed by '?'.  The
+    one difference is that a repeat never runs an iteration that matches
+    the empty string, so '(a?)*' leaves the group set by the last 'a'.
+
+    The syntax is the usual one: '.', '[...]', '[^...]', '^', '$', '|',
+    '(...)', '(?:...)', '*', '+', '?', '{n}', '{n,}', '{n,m}', the
+    escapes \d \w \s \D \W \S \b \B \n \r \t \f \v and \xHH, and '\'
+    before any other character to match it literally.  '.' matches any
+    character except a newline.  '^' and '$' match only at the start and
+    end of the subject.
+
+    The program is compiled in two passes.  The first finds its size and
+    reports any errors.  The second writes it into a string on the heap.
+    Matching doesn't allocate anything on the heap so the program and
+    the subject can't move while it runs.  The machine's thread lists
+    are kept in a heap string allocated before the match starts.
+
+    The String methods 'Match', 'Search' and 'FindAll' take a pattern
+    string.  Patterns are compiled through a small cache so a loop that
+    uses the same pattern compiles it only once.  A pattern without any
+    special characters is searched for with BobFindBytes.
+*/
+
+#include <string.h>
+#include "bob.h"
+
+/* limits */
+#define RegexMaxInstructions    10000   /* instructions in a program */
+#define RegexMaxGroups          32      /* capture groups in a pattern */
+#define RegexMaxRepeat          1000    /* count in '{n,m}' */
+#define RegexMaxSlots           (2 * (RegexMaxGroups + 1))
+
+/* number of entries in the cache of compiled patterns */
+#define RegexCacheSize          64
+
+/* size of a character class bitmap */
+#define RegexClassSize          32
+
+/* instruction opcodes */
+#define RxChar              1   /* match the character 'x' */
+#define RxAny               2   /* match any character but a newline */
+#define RxClass             3   /* match a character in class 'x' */
+#define RxBol               4   /* match the start of the subject */
+#define RxEol               5   /* match the end of the subject */
+#define RxWordBoundary      6   /* match between a word character and anything else */
+#define RxNotWordBoundary   7   /* match anywhere else */
+#define RxSplit             8   /* continue at 'x' and at 'y' with 'x' preferred */
+#define RxJmp               9   /* continue at 'x' */
+#define RxSave              10  /* save the position in capture slot 'x' */
+#define RxMatch             11  /* a match has been found */
+
+/* program instruction */
+typedef struct {
+    int op,x,y;
+} RegexInstruction;
+
+/* compiled program header */
+typedef struct {
+    long instructionCount;          /* number of instructions */
+    long classOffset;               /* offset to the character class bitmaps */
+    long visitedOffset;             /* offset to the instruction flags used by FirstSet */
+    long groupCount;                /* number of capture groups */
+    long literalP;                  /* the pattern has no special characters */
+    long anchoredP;                 /* the pattern starts with '^' */
+    long firstByte;                 /* character every match starts with or -1 */
+    long firstSetP;                 /* every match starts with a character in 'firstSet' */
+    unsigned char firstSet[RegexClassSize];
+/*  RegexInstruction code[instructionCount]; */
+/*  unsigned char classes[][RegexClassSize]; */
+/*  unsigned char visited[instructionCount]; */
+} RegexProgram;
+
+#define ProgramCode(p)              ((RegexInstruction *)((unsigned char *)(p) + sizeof(RegexProgram)))
+#define ProgramClasses(p)           ((unsigned char *)(p) + (p)->classOffset)
+#define ProgramVisited(p)           ((unsigned char *)(p) + (p)->visitedOffset)
+
+/* regular expression structure */
+typedef struct {
+    BobCObject hdr;
+    BobValue pattern;               /* copy of the pattern */
+    BobValue program;               /* string holding the compiled program or nil */
+} Regex;
+
+#define RegexPattern(o)             (((Regex *)o)->pattern)
+#define SetRegexPattern(o,v)        (((Regex *)o)->pattern = (v))
+#define RegexProgramString(o)       (((Regex *)o)->program)
+#define SetRegexProgramString(o,v)  (((Regex *)o)->program = (v))
+#define RegexProgramAddress(o)      ((RegexProgram *)BobStringAddress(RegexProgramString(o)))
+
+/* compiler structure */
+typedef struct {
+    unsigned char *p,*end;          /* pattern being compiled */
+    RegexInstruction *code;         /* instructions or NULL while sizing */
+    unsigned char *classes;         /* character classes or NULL while sizing */
+    int count;                      /* number of instructions */
+    int maxCount;                   /* most instructions at any time */
+    int classCount;                 /* number of character classes */
+    int groupCount;                 /* number of capture groups */
+    char *error;                    /* error message */
+} RegexCompiler;
+
+/* thread list structure */
+typedef struct {
+    long count;                     /* number of threads */
+    long *pcs;                      /* thread program counters */
+    long *caps;                     /* thread capture slots */
+} ThreadList;
+
+/* matching machine structure */
+typedef struct {
+    RegexProgram *program;          /* program */
+    RegexInstruction *code;         /* program instructions */
+    unsigned char *classes;         /* program character classes */
+    unsigned char *str;             /* subject */
+    long len;                       /* length of the subject */
+    unsigned char *pat;             /* pattern (for literal patterns) */
+    long patLen;                    /* length of the pattern */
+    int slotCount;                  /* number of capture slots */
+    long *generation;               /* current step (in the scratch string) */
+    long *marks;                    /* step each instruction was last added in */
+    long *initial;                  /* capture slots of a new thread */
+    ThreadList lists[2];            /* current and next thread lists */
+} RegexMachine;
+
+/* 'Regex' dispatch */
+BobDispatch *BobRegexDispatch = NULL;
+
+/* Regex methods */
+static BobValue BIF_initialize(BobInterpreter *c);
+static BobValue BIF_Match(BobInterpreter *c);
+static BobValue BIF_Search(BobInterpreter *c);
+static BobValue BIF_Offsets(BobInterpreter *c);
+static BobValue BIF_FindAll(BobInterpreter *c);
+
+static BobCMethod methods[] = {
+BobMethodEntry( "initialize",       BIF_initialize      ),
+BobMethodEntry( "Match",            BIF_Match           ),
+BobMethodEntry( "Search",           BIF_Search          ),
+BobMethodEntry( "Offsets",          BIF_Offsets         ),
+BobMethodEntry( "FindAll",          BIF_FindAll         ),
+BobMethodEntry(	0,                  0                   )
+};
+
+/* Regex properties */
+static BobValue BIF_pattern(BobInterpreter *c,BobValue obj);
+static BobValue BIF_groups(BobInterpreter *c,BobValue obj);
+
+static BobVPMethod properties[] = {
+BobVPMethodEntry( "pattern",        BIF_pattern,        0                   ),
+BobVPMethodEntry( "groups",         BIF_groups,         0                   ),
+BobVPMethodEntry( 0,                0,					0					)
+};
+
+/* String methods */
+static BobValue BIF_StringMatch(BobInterpreter *c);
+static BobValue BIF_StringSearch(BobInterpreter *c);
+static BobValue BIF_StringFindAll(BobInterpreter *c);
+
+static BobCMethod stringMethods[] = {
+BobMethodEntry( "Match",            BIF_StringMatch     ),
+BobMethodEntry( "Search",           BIF_StringSearch    ),
+BobMethodEntry( "FindAll",          BIF_StringFindAll   ),
+BobMethodEntry(	0,                  0                   )
+};
+
+/* prototypes */
+static BobValue RegexNewInstance(BobInterpreter *c,BobValue parent);
+static void RegexScan(BobInterpreter *c,BobValue obj);
+static BobValue CachedRegex(BobInterpreter *c,int n);
+static void CompilePattern(BobInterpreter *c,int n);
+static BobValue MatchResult(BobInterpreter *c,int rn,int sn,long start,int searchP,int offsetsP);
+static BobValue FindAll(BobInterpreter *c,int rn,int sn);
+static BobValue CheckRegex(BobInterpreter *c,BobValue obj);
+static BobValue MakeScratch(BobInterpreter *c,int rn);
+static void InitMachine(RegexMachine *m,BobValue regex,BobValue str,BobValue scratch);
+static int FindMatch(RegexMachine *m,long start,int searchP,long *caps);
+static int Run(RegexMachine *m,long start,int searchP,long *caps);
+static void AddThread(RegexMachine *m,ThreadList *list,long pc,long *caps,long sp);
+static int WordCharP(int ch);
+static int FirstSet(RegexProgram *p,long pc);
+static int CompileProgram(RegexCompiler *rc);
+static int ParseAlternation(RegexCompiler *rc);
+static int ParseConcatenation(RegexCompiler *rc);
+static int ParseRepeat(RegexCompiler *rc);
+static int ParseCount(RegexCompiler *rc,int *pMin,int *pMax);
+static int Repeat(RegexCompiler *rc,unsigned char *atom,int start,int groups,int min,int max,int lazyP);
+static int ParseAtom(RegexCompiler *rc);
+static int ParseClass(RegexCompiler *rc);
+static int EscapeChar(RegexCompiler *rc,int ch);
+static void AddEscapeClass(unsigned char *set,int ch);
+static void EmitClass(RegexCompiler *rc,unsigned char *set);
+static int Emit(RegexCompiler *rc,int op,int x,int y);
+static void Insert(RegexCompiler *rc,int pos,int op,int x,int y);
+static void Patch(RegexCompiler *rc,int pc,int x,int y);
+static void Star(RegexCompiler *rc,int start,int lazyP);
+static void Plus(RegexCompiler *rc,int start,int lazyP);
+static void Optional(RegexCompiler *rc,int start,int lazyP);
+static int LiteralP(unsigned char *p,long len);
+
+/* BobInitRegex - initialize the 'Regex' object */
+void BobInitRegex(BobInterpreter *c)
+{
+    if (!(BobRegexDispatch = BobEnterCObjectType(c,NULL,"Regex",methods,properties,
+                                                 sizeof(Regex) - sizeof(BobCObject))))
+        BobInsufficientMemory(c);
+    BobRegexDispatch->newInstance = RegexNewInstance;
+    BobRegexDispatch->scan = RegexScan;
+    BobEnterMethods(c,c->stringObject,stringMethods);
+}
+
+/* RegexNewInstance - Regex new instance handler */
+static BobValue RegexNewInstance(BobInterpreter *c,BobValue parent)
+{
+    BobValue obj = BobMakeCObject(c,BobRegexDispatch);
+    SetRegexPattern(obj,c->nilValue);
+    SetRegexProgramString(obj,c->nilValue);
+    return obj;
+}
+
+/* RegexScan - Regex scan handler */
+static void RegexScan(BobInterpreter *c,BobValue obj)
+{
+    BobCObjectDispatch.scan(c,obj);
+    SetRegexPattern(obj,BobCopyValue(c,RegexPattern(obj)));
+    SetRegexProgramString(obj,BobCopyValue(c,RegexProgramString(obj)));
+}
+
+/* BIF_initialize - built-in method 'initialize' */
+static BobValue BIF_initialize(BobInterpreter *c)
+{
+    BobValue obj,pattern;
+    BobParseArguments(c,"V=*V=",&obj,BobRegexDispatch,&pattern,&BobStringDispatch);
+    BobCPush(c,obj);
+    CompilePattern(c,3);
+    return BobPop(c);
+}
+
+/* BIF_Match - built-in method 'Match' */
+static BobValue BIF_Match(BobInterpreter *c)
+{
+    BobValue obj,str;
+    BobParseArguments(c,"V=*V=",&obj,BobRegexDispatch,&str,&BobStringDispatch);
+    return MatchResult(c,1,3,0,FALSE,FALSE);
+}
+
+/* BIF_Search - built-in method 'Search' */
+static BobValue BIF_Search(BobInterpreter *c)
+{
+    BobValue obj,str;
+    long start = 0;
+    BobParseArguments(c,"V=*V=|l",&obj,BobRegexDispatch,&str,&BobStringDispatch,&start);
+    return MatchResult(c,1,3,start,TRUE,FALSE);
+}
+
+/* BIF_Offsets - built-in method 'Offsets' */
+static BobValue BIF_Offsets(BobInterpreter *c)
+{
+    BobValue obj,str;
+    long start = 0;
+    BobParseArguments(c,"V=*V=|l",&obj,BobRegexDispatch,&str,&BobStringDispatch,&start);
+    return MatchResult(c,1,3,start,TRUE,TRUE);
+}
+
+/* BIF_FindAll - built-in method 'FindAll' */
+static BobValue BIF_FindAll(BobInterpreter *c)
+{
+    BobValue obj,str;
+    BobParseArguments(c,"V=*V=",&obj,BobRegexDispatch,&str,&BobStringDispatch);
+    return FindAll(c,1,3);
+}
+
+/* BIF_pattern - built-in property 'pattern' */
+static BobValue BIF_pattern(BobInterpreter *c,BobValue obj)
+{
+    BobValue pattern = RegexPattern(obj);
+    if (pattern == c->nilValue)
+        return pattern;
+    BobCPush(c,pattern);
+    pattern = BobMakeString(c,NULL,BobStringSize(BobTop(c)));
+    obj = BobPop(c);
+    memcpy(BobStringAddress(pattern),BobStringAddress(obj),BobStringSize(pattern));
+    return pattern;
+}
+
+/* BIF_groups - built-in property 'groups' */
+static BobValue BIF_groups(BobInterpreter *c,BobValue obj)
+{
+    return BobMakeInteger(c,RegexProgramString(obj) == c->nilValue ? 0 : RegexProgramAddress(obj)->groupCount);
+}
+
+/* BIF_StringMatch - built-in String method 'Match' */
+static BobValue BIF_StringMatch(BobInterpreter *c)
+{
+    BobValue str,pattern;
+    BobParseArguments(c,"V=*V",&str,&BobStringDispatch,&pattern);
+    CachedRegex(c,3);
+    return MatchResult(c,3,1,0,FALSE,FALSE);
+}
+
+/* BIF_StringSearch - built-in String method 'Search' */
+static BobValue BIF_StringSearch(BobInterpreter *c)
+{
+    BobValue str,pattern;
+    long start = 0;
+    BobParseArguments(c,"V=*V|l",&str,&BobStringDispatch,&pattern,&start);
+    CachedRegex(c,3);
+    return MatchResult(c,3,1,start,TRUE,FALSE);
+}
+
+/* BIF_StringFindAll - built-in String method 'FindAll' */
+static BobValue BIF_StringFindAll(BobInterpreter *c)
+{
+    BobValue str,pattern;
+    BobParseArguments(c,"V=*V",&str,&BobStringDispatch,&pattern);
+    CachedRegex(c,3);
+    return FindAll(c,3,1);
+}
+
+/* CachedRegex - replace the pattern string passed as argument 'n' with a compiled regex */
+static BobValue CachedRegex(BobInterpreter *c,int n)
+{
+    BobValue pattern = BobGetArg(c,n),cache,regex,cached;
+    long i;
+
+    /* check for a pattern that is already compiled */
+    if (BobRegexP(pattern))
+        return pattern;
+    else if (!BobStringP(pattern))
+        BobTypeError(c,pattern);
+
+    /* make the cache the first time it's needed */
+    if (c->regexCache == c->nilValue) {
+        cache = BobMakeVector(c,RegexCacheSize);
+        c->regexCache = cache;
+        pattern = BobGetArg(c,n);
+    }
+
+    /* look for the pattern in the cache */
+    i = (long)((unsigned long)BobHashValue(pattern) % RegexCacheSize);
+    cached = BobVectorAddress(c->regexCache)[i];
+    if (cached != c->nilValue) {
+        BobValue source = RegexPattern(cached);
+        if (BobStringSize(source) == BobStringSize(pattern)
+        &&  memcmp(BobStringAddress(source),BobStringAddress(pattern),BobStringSize(pattern)) == 0)
+            return c->argv[-n] = cached;
+    }
+
+    /* compile the pattern and add it to the cache */
+    regex = RegexNewInstance(c,c->nilValue);
+    BobCPush(c,regex);
+    CompilePattern(c,n);
+    regex = BobPop(c);
+    BobWriteBarrier(c,c->regexCache,regex);
+    BobVectorAddress(c->regexCache)[i] = regex;
+    return c->argv[-n] = regex;
+}
+
+/* CompilePattern - compile the pattern passed as argument 'n' into the regex on top of the stack */
+static void CompilePattern(BobInterpreter *c,int n)
+{
+    BobValue pattern = BobGetArg(c,n),copy,program;
+    long len = BobStringSize(pattern),size;
+    RegexProgram *p;
+    int pc,count;
+    RegexCompiler rc;
+
+    /* find the size of the program and check for errors */
+    rc.p = BobStringAddress(pattern);
+    rc.end = rc.p + len;
+    rc.code = NULL;
+    rc.classes = NULL;
+    if (!CompileProgram(&rc))
+        BobCallErrorHandler(c,BobErrBadRegex,rc.error,pattern);
+    size = sizeof(RegexProgram) + rc.maxCount * sizeof(RegexInstruction) + rc.classCount * RegexClassSize + rc.maxCount;
+
+    /* copy the pattern so changing the original doesn't change the regex */
+    copy = BobMakeString(c,NULL,len);
+    memcpy(BobStringAddress(copy),BobStringAddress(BobGetArg(c,n)),len);
+    BobWriteBarrier(c,BobTop(c),copy);
+    SetRegexPattern(BobTop(c),copy);
+
+    /* make the program */
+    program = BobMakeString(c,NULL,size);
+    BobWriteBarrier(c,BobTop(c),program);
+    SetRegexProgramString(BobTop(c),program);
+    p = RegexProgramAddress(BobTop(c));
+    p->classOffset = sizeof(RegexProgram) + rc.maxCount * sizeof(RegexInstruction);
+    p->visitedOffset = p->classOffset + rc.classCount * RegexClassSize;
+
+    /* generate the code */
+    rc.p = BobStringAddress(RegexPattern(BobTop(c)));
+    rc.end = rc.p + len;
+    rc.code = ProgramCode(p);
+    rc.classes = ProgramClasses(p);
+    CompileProgram(&rc);
+
+    /* fill in the program header */
+    p->instructionCount = rc.count;
+    p->groupCount = rc.groupCount;
+    p->literalP = LiteralP(BobStringAddress(RegexPattern(BobTop(c))),len);
+    p->anchoredP = rc.code[1].op == RxBol;
+
+    /* find the characters a match can start with */
+    memset(p->firstSet,0,RegexClassSize);
+    memset(ProgramVisited(p),0,rc.count);
+    p->firstSetP = FirstSet(p,0);
+    p->firstByte = -1;
+    for (pc = 0, count = 0; p->firstSetP && pc < 256; ++pc)
+        if (p->firstSet[pc >> 3] & (1 << (pc & 7))) {
+            p->firstByte = pc;
+            ++count;
+        }
+    if (count != 1)
+        p->firstByte = -1;
+}
+
+/* FirstSet - add the characters a match starting at 'pc' can start with to the first set */
+static int FirstSet(RegexProgram *p,long pc)
+{
+    RegexInstruction *ip = &ProgramCode(p)[pc];
+    unsigned char *visited = ProgramVisited(p),*class;
+    int i;
+    if (visited[pc])
+        return TRUE;
+    visited[pc] = TRUE;
+    switch (ip->op) {
+    case RxChar:
+        p->firstSet[ip->x >> 3] |= 1 << (ip->x & 7);
+        return TRUE;
+    case RxClass:
+        class = ProgramClasses(p) + ip->x * RegexClassSize;
+        for (i = 0; i < RegexClassSize; ++i)
+            p->firstSet[i] |= class[i];
+        return TRUE;
+    case RxSplit:
+        return FirstSet(p,ip->x) && FirstSet(p,ip->y);
+    case RxJmp:
+        return FirstSet(p,ip->x);
+    case RxSave:
+        return FirstSet(p,pc + 1);
+    }
+    return FALSE;
+}
+
+/* MatchResult - match the string passed as argument 'sn' with the regex passed as argument 'rn'
+   and return a vector of the captured strings or their offsets */
+static BobValue MatchResult(BobInterpreter *c,int rn,int sn,long start,int searchP,int offsetsP)
+{
+    long caps[RegexMaxSlots];
+    RegexMachine m;
+    BobValue result,value,scratch;
+    int slotCount,i;
+
+    /* find the match */
+    CheckRegex(c,BobGetArg(c,rn));
+    if (start < 0 || start > BobStringSize(BobGetArg(c,sn)))
+        return c->nilValue;
+    scratch = MakeScratch(c,rn);
+    InitMachine(&m,BobGetArg(c,rn),BobGetArg(c,sn),scratch);
+    if (!FindMatch(&m,start,searchP,caps))
+        return c->nilValue;
+    slotCount = m.slotCount;
+
+    /* make the result vector */
+    result = BobMakeVector(c,offsetsP ? slotCount : slotCount / 2);
+    BobCPush(c,result);
+    for (i = 0; i < slotCount; i += 2) {
+        if (caps[i] >= 0) {
+            if (offsetsP) {
+                value = BobMakeInteger(c,caps[i]);
+                BobWriteBarrier(c,BobTop(c),value);
+                BobSetVectorElementI(BobTop(c),i,value);
+                value = BobMakeInteger(c,caps[i + 1]);
+                BobWriteBarrier(c,BobTop(c),value);
+                BobSetVectorElementI(BobTop(c),i + 1,value);
+            }
+            else {
+                value = BobMakeString(c,NULL,caps[i + 1] - caps[i]);
+                memcpy(BobStringAddress(value),BobStringAddress(BobGetArg(c,sn)) + caps[i],caps[i + 1] - caps[i]);
+                BobWriteBarrier(c,BobTop(c),value);
+                BobSetVectorElementI(BobTop(c),i / 2,value);
+            }
+        }
+    }
+    return BobPop(c);
+}
+
+/* FindAll - find all of the matches of the regex passed as argument 'rn' in the string passed as argument 'sn' */
+static BobValue FindAll(BobInterpreter *c,int rn,int sn)
+{
+    long caps[RegexMaxSlots],pos,count,i,*offsets;
+    BobValue scratch,buffer,vector,value;
+    RegexMachine m;
+
+    /* make the thread lists and a buffer for the match offsets */
+    CheckRegex(c,BobGetArg(c,rn));
+    scratch = MakeScratch(c,rn);
+    BobCPush(c,scratch);
+    buffer = BobMakeString(c,NULL,16 * 2 * sizeof(long));
+    BobCPush(c,buffer);
+
+    /* find the matches (an empty match moves the next search ahead a character) */
+    InitMachine(&m,BobGetArg(c,rn),BobGetArg(c,sn),c->sp[1]);
+    for (count = 0, pos = 0; pos <= m.len && FindMatch(&m,pos,TRUE,caps); ++count) {
+        if ((count + 1) * 2 * (long)sizeof(long) > BobStringSize(BobTop(c))) {
+            buffer = BobMakeString(c,NULL,2 * BobStringSize(BobTop(c)));
+            memcpy(BobStringAddress(buffer),BobStringAddress(BobTop(c)),BobStringSize(BobTop(c)));
+            BobSetTop(c,buffer);
+            InitMachine(&m,BobGetArg(c,rn),BobGetArg(c,sn),c->sp[1]);
+        }
+        offsets = (long *)BobStringAddress(BobTop(c)) + 2 * count;
+        offsets[0] = caps[0];
+        offsets[1] = caps[1];
+        pos = caps[1] > caps[0] ? caps[1] : caps[1] + 1;
+    }
+
+    /* make the vector of matched strings */
+    vector = BobMakeVector(c,count);
+    BobCPush(c,vector);
+    for (i = 0; i < count; ++i) {
+        offsets = (long *)BobStringAddress(c->sp[1]) + 2 * i;
+        value = BobMakeString(c,NULL,offsets[1] - offsets[0]);
+        offsets = (long *)BobStringAddress(c->sp[1]) + 2 * i;
+        memcpy(BobStringAddress(value),BobStringAddress(BobGetArg(c,sn)) + offsets[0],offsets[1] - offsets[0]);
+        BobWriteBarrier(c,BobTop(c),value);
+        BobSetVectorElementI(BobTop(c),i,value);
+    }
+    vector = BobPop(c);
+    BobDrop(c,2);
+    return vector;
+}
+
+/* CheckRegex - make sure a regex has been compiled */
+static BobValue CheckRegex(BobInterpreter *c,BobValue obj)
+{
+    if (RegexProgramString(obj) == c->nilValue)
+        BobTypeError(c,obj);
+    return obj;
+}
+
+/* MakeScratch - make the thread lists for the regex passed as argument 'rn' */
+static BobValue MakeScratch(BobInterpreter *c,int rn)
+{
+    RegexProgram *p = RegexProgramAddress(BobGetArg(c,rn));
+    long n = p->instructionCount,slots = 2 * (p->groupCount + 1);
+    if (p->literalP)
+        return c->nilValue;
+    return BobMakeString(c,NULL,(1 + 3 * n + 2 * n * slots + slots) * sizeof(long));
+}
+
+/* InitMachine - initialize a matching machine */
+static void InitMachine(RegexMachine *m,BobValue regex,BobValue str,BobValue scratch)
+{
+    RegexProgram *p = RegexProgramAddress(regex);
+    long n = p->instructionCount,*data;
+    int i;
+    m->program = p;
+    m->code = ProgramCode(p);
+    m->classes = ProgramClasses(p);
+    m->str = BobStringAddress(str);
+    m->len = BobStringSize(str);
+    m->pat = BobStringAddress(RegexPattern(regex));
+    m->patLen = BobStringSize(RegexPattern(regex));
+    m->slotCount = (int)(2 * (p->groupCount + 1));
+    if (!p->literalP) {
+        data = (long *)BobStringAddress(scratch);
+        m->generation = data++;
+        m->marks = data; data += n;
+        for (i = 0; i < 2; ++i) {
+            m->lists[i].pcs = data; data += n;
+            m->lists[i].caps = data; data += n * m->slotCount;
+        }
+        m->initial = data;
+        for (i = 0; i < m->slotCount; ++i)
+            m->initial[i] = -1;
+    }
+}
+
+/* FindMatch - find a match at or after a position or a match of the whole subject */
+static int FindMatch(RegexMachine *m,long start,int searchP,long *caps)
+{
+    long offset;
+
+    /* use the machine unless the pattern is a plain string */
+    if (!m->program->literalP)
+        return Run(m,start,searchP,caps);
+
+    /* find the pattern as a string */
+    if (searchP) {
+        if ((offset = BobFindBytes(m->str + start,m->len - start,m->pat,m->patLen)) < 0)
+            return FALSE;
+        offset += start;
+    }
+    else {
+        if (m->len != m->patLen || memcmp(m->str,m->pat,m->patLen) != 0)
+            return FALSE;
+        offset = 0;
+    }
+    caps[0] = offset;
+    caps[1] = offset + m->patLen;
+    return TRUE;
+}
+
+/* Run - run the machine from a position */
+static int Run(RegexMachine *m,long start,int searchP,long *caps)
+{
+    ThreadList *clist = &m->lists[0],*nlist = &m->lists[1],*tmp;
+    int slotCount = m->slotCount,matchedP = FALSE;
+    RegexInstruction *ip;
+    unsigned char *p;
+    long sp,i,*tcaps;
+    int ch;
+
+    /* start with no threads */
+    clist->count = 0;
+    ++*m->generation;
+
+    /* step through the subject */
+    for (sp = start; ; ++sp) {
+
+        /* start a new thread here until a match is found */
+        if (!matchedP && (sp == start || (searchP && !m->program->anchoredP))) {
+
+            /* skip ahead to the first possible match */
+            if (clist->count == 0 && m->program->firstSetP && searchP) {
+                if (m->program->firstByte >= 0) {
+                    if (!(p = memchr(m->str + sp,(int)m->program->firstByte,m->len - sp)))
+                        break;
+                    sp = p - m->str;
+                }
+                else {
+                    while (sp < m->len && !(m->program->firstSet[m->str[sp] >> 3] & (1 << (m->str[sp] & 7))))
+                        ++sp;
+                    if (sp >= m->len)
+                        break;
+                }
+                ++*m->generation;
+            }
+            AddThread(m,clist,0,m->initial,sp);
+        }
+
+        /* advance each thread past the current character in priority order */
+        ++*m->generation;
+        nlist->count = 0;
+        ch = sp < m->len ? m->str[sp] : -1;
+        for (i = 0; i < clist->count; ++i) {
+            ip = &m->code[clist->pcs[i]];
+            tcaps = &clist->caps[i * slotCount];
+            switch (ip->op) {
+            case RxChar:
+                if (ch == ip->x)
+                    AddThread(m,nlist,clist->pcs[i] + 1,tcaps,sp + 1);
+                break;
+            case RxAny:
+                if (ch >= 0 && ch != '\n')
+                    AddThread(m,nlist,clist->pcs[i] + 1,tcaps,sp + 1);
+                break;
+            case RxClass:
+                if (ch >= 0 && (m->classes[ip->x * RegexClassSize + (ch >> 3)] & (1 << (ch & 7))))
+                    AddThread(m,nlist,clist->pcs[i] + 1,tcaps,sp + 1);
+                break;
+            case RxMatch:
+                if (searchP || sp == m->len) {
+                    memcpy(caps,tcaps,slotCount * sizeof(long));
+                    matchedP = TRUE;
+
+                    /* threads after this one have lower priority */
+                    i = clist->count;
+                }
+                break;
+            }
+        }
+
+        /* the next list becomes the current one */
+        tmp = clist;
+        clist = nlist;
+        nlist = tmp;
+
+        /* stop at the end of the subject or when no thread is left and no new one will start */
+        if (sp >= m->len || (clist->count == 0 && (matchedP || !searchP || m->program->anchoredP)))
+            break;
+    }
+    return matchedP;
+}
+
+/* AddThread - add a thread and the threads it splits into to a list */
+static void AddThread(RegexMachine *m,ThreadList *list,long pc,long *caps,long sp)
+{
+    RegexInstruction *ip;
+    long saved;
+    int beforeP,afterP;
+
+    /* only add each instruction once per step */
+    if (m->marks[pc] == *m->generation)
+        return;
+    m->marks[pc] = *m->generation;
+
+    /* follow instructions that don't consume a character */
+    ip = &m->code[pc];
+    switch (ip->op) {
+    case RxJmp:
+        AddThread(m,list,ip->x,caps,sp);
+        break;
+    case RxSplit:
+        AddThread(m,list,ip->x,caps,sp);
+        AddThread(m,list,ip->y,caps,sp);
+        break;
+    case RxSave:
+        saved = caps[ip->x];
+        caps[ip->x] = sp;
+        AddThread(m,list,pc + 1,caps,sp);
+        caps[ip->x] = saved;
+        break;
+    case RxBol:
+        if (sp == 0)
+            AddThread(m,list,pc + 1,caps,sp);
+        break;
+    case RxEol:
+        if (sp == m->len)
+            AddThread(m,list,pc + 1,caps,sp);
+        break;
+    case RxWordBoundary:
+    case RxNotWordBoundary:
+        beforeP = sp > 0 && WordCharP(m->str[sp - 1]);
+        afterP = sp < m->len && WordCharP(m->str[sp]);
+        if ((beforeP != afterP) == (ip->op == RxWordBoundary))
+            AddThread(m,list,pc + 1,caps,sp);
+        break;
+    default:
+        list->pcs[list->count] = pc;
+        memcpy(&list->caps[list->count * m->slotCount],caps,m->slotCount * sizeof(long));
+        ++list->count;
+        break;
+    }
+}
+
+/* WordCharP - check for a character that can be part of a word */
+static int WordCharP(int ch)
+{
+    return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || (ch >= '0' && ch <= '9') || ch == '_';
+}
+
+/* CompileProgram - compile a pattern */
+static int CompileProgram(RegexCompiler *rc)
+{
+    rc->count = rc->maxCount = 0;
+    rc->classCount = rc->groupCount = 0;
+    rc->error = NULL;
+    Emit(rc,RxSave,0,0);
+    if (!ParseAlternation(rc))
+        return FALSE;
+    if (rc->p < rc->end) {
+        rc->error = "unmatched ')'";
+        return FALSE;
+    }
+    Emit(rc,RxSave,1,0);
+    Emit(rc,RxMatch,0,0);
+    return rc->error == NULL;
+}
+
+/* ParseAlternation - parse alternatives separated by '|' */
+static int ParseAlternation(RegexCompiler *rc)
+{
+    int start = rc->count,jmp;
+    if (!ParseConcatenation(rc))
+        return FALSE;
+    if (rc->p < rc->end && *rc->p == '|') {
+        ++rc->p;
+        Insert(rc,start,RxSplit,start + 1,0);
+        jmp = Emit(rc,RxJmp,0,0);
+        Patch(rc,start,start + 1,rc->count);
+        if (!ParseAlternation(rc))
+            return FALSE;
+        Patch(rc,jmp,rc->count,0);
+    }
+    return rc->error == NULL;
+}
+
+/* ParseConcatenation - parse a sequence of terms */
+static int ParseConcatenation(RegexCompiler *rc)
+{
+    while (rc->p < rc->end && *rc->p != '|' && *rc->p != ')')
+        if (!ParseRepeat(rc))
+            return FALSE;
+    return TRUE;
+}
+
+/* ParseRepeat - parse an atom and the quantifier that follows it */
+static int ParseRepeat(RegexCompiler *rc)
+{
+    unsigned char *atom = rc->p;
+    int start = rc->count,groups = rc->groupCount,min,max,op,lazyP;
+
+    /* parse the atom */
+    if (!ParseAtom(rc))
+        return FALSE;
+
+    /* check for a quantifier */
+    if (rc->p >= rc->end)
+        return TRUE;
+    switch (op = *rc->p) {
+    case '*':
+    case '+':
+    case '?':
+        ++rc->p;
+        break;
+    case '{':
+        if (!ParseCount(rc,&min,&max))
+            return rc->error == NULL;
+        break;
+    default:
+        return TRUE;
+    }
+
+    /* check for a lazy quantifier */
+    if ((lazyP = rc->p < rc->end && *rc->p == '?') != FALSE)
+        ++rc->p;
+
+    /* repeat the atom */
+    switch (op) {
+    case '*':
+        Star(rc,start,lazyP);
+        break;
+    case '+':
+        Plus(rc,start,lazyP);
+        break;
+    case '?':
+        Optional(rc,start,lazyP);
+        break;
+    case '{':
+        if (!Repeat(rc,atom,start,groups,min,max,lazyP))
+            return FALSE;
+        break;
+    }
+
+    /* only one quantifier is allowed */
+    if (rc->p < rc->end && (*rc->p == '*' || *rc->p == '+' || *rc->p == '?')) {
+        rc->error = "multiple repeat";
+        return FALSE;
+    }
+    return rc->error == NULL;
+}
+
+/* ParseCount - parse a '{n}', '{n,}' or '{n,m}' quantifier (a '{' that doesn't start one is literal) */
+static int ParseCount(RegexCompiler *rc,int *pMin,int *pMax)
+{
+    unsigned char *p = rc->p + 1;
+    long min = 0,max;
+
+    /* parse the minimum (every digit is consumed but the value stops growing past the limit) */
+    if (p >= rc->end || *p < '0' || *p > '9')
+        return FALSE;
+    for (; p < rc->end && *p >= '0' && *p <= '9'; ++p)
+        if (min <= RegexMaxRepeat)
+            min = min * 10 + *p - '0';
+
+    /* parse the maximum */
+    if (p < rc->end && *p == ',') {
+        if (++p < rc->end && *p >= '0' && *p <= '9') {
+            max = 0;
+            for (; p < rc->end && *p >= '0' && *p <= '9'; ++p)
+                if (max <= RegexMaxRepeat)
+                    max = max * 10 + *p - '0';
+        }
+        else
+            max = -1;
+    }
+    else
+        max = min;
+    if (p >= rc->end || *p != '}')
+        return FALSE;
+
+    /* check the counts */
+    if (min > RegexMaxRepeat || max > RegexMaxRepeat) {
+        rc->error = "repeat count too large";
+        return FALSE;
+    }
+    else if (max >= 0 && max < min) {
+        rc->error = "bad repeat count";
+        return FALSE;
+    }
+    rc->p = p + 1;
+    *pMin = (int)min;
+    *pMax = (int)max;
+    return TRUE;
+}
+
+/* Repeat - repeat an atom between 'min' and 'max' times (no limit if 'max' is -1) */
+static int Repeat(RegexCompiler *rc,unsigned char *atom,int start,int groups,int min,int max,int lazyP)
+{
+    unsigned char *next = rc->p;
+    int lastGroup = rc->groupCount,fragment,i;
+
+    /* the atom has been compiled once already */
+    if (min == 0) {
+        if (max == 0) {
+            rc->count = start;
+            return TRUE;
+        }
+        else if (max < 0) {
+            Star(rc,start,lazyP);
+            return TRUE;
+        }
+        Optional(rc,start,lazyP);
+        min = 1;
+    }
+
+    /* compile the rest of the required copies */
+    for (i = 1; i < min; ++i) {
+        rc->p = atom;
+        rc->groupCount = groups;
+        if (!ParseAtom(rc))
+            return FALSE;
+    }
+
+    /* compile the optional copies */
+    if (max < 0) {
+        fragment = rc->count;
+        rc->p = atom;
+        rc->groupCount = groups;
+        if (!ParseAtom(rc))
+            return FALSE;
+        Star(rc,fragment,lazyP);
+    }
+    else {
+        for (i = min; i < max; ++i) {
+            fragment = rc->count;
+            rc->p = atom;
+            rc->groupCount = groups;
+            if (!ParseAtom(rc))
+                return FALSE;
+            Optional(rc,fragment,lazyP);
+        }
+    }
+
+    /* continue after the quantifier */
+    rc->p = next;
+    rc->groupCount = lastGroup;
+    return rc->error == NULL;
+}
+
+/* ParseAtom - parse a character, class, anchor or group */
+static int ParseAtom(RegexCompiler *rc)
+{
+    unsigned char set[RegexClassSize];
+    int ch,group;
+    switch (ch = *rc->p++) {
+    case '.':
+        Emit(rc,RxAny,0,0);
+        break;
+    case '^':
+        Emit(rc,RxBol,0,0);
+        break;
+    case '$':
+        Emit(rc,RxEol,0,0);
+        break;
+    case '[':
+        return ParseClass(rc);
+    case '(':
+        if (rc->p + 1 < rc->end && rc->p[0] == '?' && rc->p[1] == ':') {
+            rc->p += 2;
+            group = -1;
+        }
+        else {
+            if ((group = ++rc->groupCount) > RegexMaxGroups) {
+                rc->error = "too many groups";
+                return FALSE;
+            }
+            Emit(rc,RxSave,2 * group,0);
+        }
+        if (!ParseAlternation(rc))
+            return FALSE;
+        if (rc->p >= rc->end || *rc->p != ')') {
+            rc->error = "missing ')'";
+            return FALSE;
+        }
+        ++rc->p;
+        if (group >= 0)
+            Emit(rc,RxSave,2 * group + 1,0);
+        break;
+    case '*':
+    case '+':
+    case '?':
+        rc->error = "nothing to repeat";
+        return FALSE;
+    case '\\':
+        if (rc->p >= rc->end) {
+            rc->error = "trailing '\\'";
+            return FALSE;
+        }
+        switch (ch = *rc->p++) {
+        case 'd': case 'D':
+        case 'w': case 'W':
+        case 's': case 'S':
+            memset(set,0,sizeof(set));
+            AddEscapeClass(set,ch);
+            EmitClass(rc,set);
+            break;
+        case 'b':
+            Emit(rc,RxWordBoundary,0,0);
+            break;
+        case 'B':
+            Emit(rc,RxNotWordBoundary,0,0);
+            break;
+        default:
+            if ((ch = EscapeChar(rc,ch)) < 0)
+                return FALSE;
+            Emit(rc,RxChar,ch,0);
+            break;
+        }
+        break;
+    default:
+        Emit(rc,RxChar,ch,0);
+        break;
+    }
+    return rc->error == NULL;
+}
+
+/* ParseClass - parse a character class (the '[' has been read) */
+static int ParseClass(RegexCompiler *rc)
+{
+    unsigned char set[RegexClassSize];
+    int negateP = FALSE,firstP = TRUE,lo,hi,i;
+
+    /* check for a negated class */
+    memset(set,0,sizeof(set));
+    if (rc->p < rc->end && *rc->p == '^') {
+        negateP = TRUE;
+        ++rc->p;
+    }
+
+    /* parse the characters and ranges (a ']' first is literal) */
+    for (;; firstP = FALSE) {
+        if (rc->p >= rc->end) {
+            rc->error = "missing ']'";
+            return FALSE;
+        }
+        if ((lo = *rc->p++) == ']' && !firstP)
+            break;
+        if (lo == '\\') {
+            if (rc->p >= rc->end) {
+                rc->error = "missing ']'";
+                return FALSE;
+            }
+            lo = *rc->p++;
+            if (lo && strchr("dDwWsS",lo)) {
+                AddEscapeClass(set,lo);
+                continue;
+            }
+            else if ((lo = EscapeChar(rc,lo)) < 0)
+                return FALSE;
+        }
+        if (rc->p + 1 < rc->end && rc->p[0] == '-' && rc->p[1] != ']') {
+            ++rc->p;
+            if ((hi = *rc->p++) == '\\') {
+                if (rc->p >= rc->end) {
+                    rc->error = "missing ']'";
+                    return FALSE;
+                }
+                if ((hi = EscapeChar(rc,*rc->p++)) < 0)
+                    return FALSE;
+            }
+            if (hi < lo) {
+                rc->error = "bad range";
+                return FALSE;
+            }
+        }
+        else
+            hi = lo;
+        for (; lo <= hi; ++lo)
+            set[lo >> 3] |= 1 << (lo & 7);
+    }
+
+    /* negate the class if necessary */
+    if (negateP)
+        for (i = 0; i < RegexClassSize; ++i)
+            set[i] = ~set[i];
+    EmitClass(rc,set);
+    return rc->error == NULL;
+}
+
+/* EscapeChar - get the character matched by an escape sequence (the '\' and 'ch' have been read) */
+static int EscapeChar(RegexCompiler *rc,int ch)
+{
+    int value,digit,i;
+    switch (ch) {
+    case 'n':   return '\n';
+    case 'r':   return '\r';
+    case 't':   return '\t';
+    case 'f':   return '\f';
+    case 'v':   return '\v';
+    case 'x':
+        for (value = 0, i = 0; i < 2; ++i) {
+            if (rc->p >= rc->end) {
+                rc->error = "bad '\\x' escape";
+                return -1;
+            }
+            ch = *rc->p++;
+            if (ch >= '0' && ch <= '9')
+                digit = ch - '0';
+            else if (ch >= 'a' && ch <= 'f')
+                digit = ch - 'a' + 10;
+            else if (ch >= 'A' && ch <= 'F')
+                digit = ch - 'A' + 10;
+            else {
+                rc->error = "bad '\\x' escape";
+                return -1;
+            }
+            value = value * 16 + digit;
+        }
+        return value;
+    }
+    return ch;
+}
+
+/* AddEscapeClass - add the characters matched by \d, \w, \s or their negations to a class */
+static void AddEscapeClass(unsigned char *set,int ch)
+{
+    unsigned char class[RegexClassSize];
+    int i;
+    memset(class,0,sizeof(class));
+    for (i = 0; i < 256; ++i) {
+        switch (ch) {
+        case 'd': case 'D':
+            if (i >= '0' && i <= '9')
+                class[i >> 3] |= 1 << (i & 7);
+            break;
+        case 'w': case 'W':
+            if (WordCharP(i))
+                class[i >> 3] |= 1 << (i & 7);
+            break;
+        case 's': case 'S':
+            if (i == ' ' || (i >= '\t' && i <= '\r'))
+                class[i >> 3] |= 1 << (i & 7);
+            break;
+        }
+    }
+    for (i = 0; i < RegexClassSize; ++i)
+        set[i] |= ch >= 'a' ? class[i] : ~class[i];
+}
+
+/* EmitClass - emit an instruction to match a character class */
+static void EmitClass(RegexCompiler *rc,unsigned char *set)
+{
+    if (rc->classes)
+        memcpy(rc->classes + rc->classCount * RegexClassSize,set,RegexClassSize);
+    Emit(rc,RxClass,rc->classCount++,0);
+}
+
+/* Emit - add an instruction to the end of the program */
+static int Emit(RegexCompiler *rc,int op,int x,int y)
+{
+    if (rc->count >= RegexMaxInstructions) {
+        rc->error = "pattern too large";
+        return rc->count - 1;
+    }
+    if (rc->code) {
+        rc->code[rc->count].op = op;
+        rc->code[rc->count].x = x;
+        rc->code[rc->count].y = y;
+    }
+    if (++rc->count > rc->maxCount)
+        rc->maxCount = rc->count;
+    return rc->count - 1;
+}
+
+/* Insert - insert an instruction in front of the fragment starting at 'pos' */
+static void Insert(RegexCompiler *rc,int pos,int op,int x,int y)
+{
+    RegexInstruction *ip;
+    int i;
+    if (rc->count >= RegexMaxInstructions) {
+        rc->error = "pattern too large";
+        return;
+    }
+    if (rc->code) {
+
+        /* move the fragment */
+        memmove(&rc->code[pos + 1],&rc->code[pos],(rc->count - pos) * sizeof(RegexInstruction));
+
+        /* fix up jumps into the fragment (jumps to its start from outside go to the new instruction) */
+        for (i = 0; i <= rc->count; ++i) {
+            ip = &rc->code[i];
+            if (i != pos && (ip->op == RxJmp || ip->op == RxSplit)) {
+                int first = i < pos ? pos + 1 : pos;
+                if (ip->x >= first)
+                    ++ip->x;
+                if (ip->op == RxSplit && ip->y >= first)
+                    ++ip->y;
+            }
+        }
+
+        /* store the new instruction */
+        rc->code[pos].op = op;
+        rc->code[pos].x = x;
+        rc->code[pos].y = y;
+    }
+    if (++rc->count > rc->maxCount)
+        rc->maxCount = rc->count;
+}
+
+/* Patch - set the operands of an instruction */
+static void Patch(RegexCompiler *rc,int pc,int x,int y)
+{
+    if (rc->code) {
+        rc->code[pc].x = x;
+        rc->code[pc].y = y;
+    }
+}
+
+/* Star - repeat the fragment starting at 'start' zero or more times */
+static void Star(RegexCompiler *rc,int start,int lazyP)
+{
+    Insert(rc,start,RxSplit,0,0);
+    Emit(rc,RxJmp,start,0);
+    if (lazyP)
+        Patch(rc,start,rc->count,start + 1);
+    else
+        Patch(rc,start,start + 1,rc->count);
+}
+
+/* Plus - repeat the fragment starting at 'start' one or more times */
+static void Plus(RegexCompiler *rc,int start,int lazyP)
+{
+    if (lazyP)
+        Emit(rc,RxSplit,rc->count + 1,start);
+    else
+        Emit(rc,RxSplit,start,rc->count + 1);
+}
+
+/* Optional - match the fragment starting at 'start' zero or one times */
+static void Optional(RegexCompiler *rc,int start,int lazyP)
+{
+    Insert(rc,start,RxSplit,0,0);
+    if (lazyP)
+        Patch(rc,start,rc->count,start + 1);
+    else
+        Patch(rc,start,start + 1,rc->count);
+}
+
+/* LiteralP - check for a pattern without any special characters */
+static int LiteralP(unsigned char *p,long len)
+{
+    while (--len >= 0)
+        if (*p && strchr(".^$|()[]{}*+?\\",*p++))
+            return FALSE;
+    return TRUE;
+}
@@ -0,0 +1,225 @@
+/* bobregion.c - allocation regions */
+/*
+        Copyright (c) 2001, by David Michael Betz
+        All rights reserved
+*/
+
+/*
+    An allocation region marks the current end of the heap.  Everything
+    allocated while the region is open is placed after the mark.  Closing
+    the region frees the objects allocated in it that can't be reached from
+    the roots or from an object allocated before the region was opened.
+
+    A write barrier (BobWriteBarrier) remembers each older object that is
+    given a reference to an object in an open region.  Closing a region is
+    a small copying collection of the region alone: the objects reachable
+    from the roots and the remembered objects are copied past the end of
+    the region and then back to the mark, which frees everything else.  Its
+    cost depends on the roots, the remembered objects and the survivors
+    rather than the size of the heap, and only the objects that escaped are
+    kept.
+
+    A garbage collection while a region is open moves the mark of every
+    open region to the end of the copied objects, so the objects that
+    survive it are kept and the remembered set is emptied.  If the
+    remembered set can't be expanded, closing the region collects the
+    whole heap instead.  References from older weak tables and weak
+    references to region objects are treated as strong.
+
+    Regions nest.  The value register is a root, so the result of the last
+    expression evaluated in a region is kept.  Interning a new symbol is an
+    escape since the symbol table refers to the symbol.
+
+    Compiling with BOB_VERIFY_REGIONS checks the write barrier by visiting
+    every older object when a region is closed and reporting any reference
+    to a region object from an object that wasn't remembered.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "bob.h"
+
+/* initial size of the remembered set */
+#define RememberedInitialSize   256
+
+/* prototypes */
+static void Remember(BobInterpreter *c,BobValue obj,unsigned char *mark);
+static void SortRemembered(BobInterpreter *c);
+static int CompareObjects(const void *p1,const void *p2);
+static void KeepRemembered(BobInterpreter *c,unsigned char *mark);
+#ifdef BOB_VERIFY_REGIONS
+static void VerifyRemembered(BobInterpreter *c,unsigned char *mark);
+static BobValue VisitReference(BobInterpreter *c,BobHeapVisitor *v,BobValue obj);
+#endif
+
+/* BobOpenRegion - open an allocation region */
+void BobOpenRegion(BobInterpreter *c,BobRegion *region)
+{
+    region->mark = c->newSpace->free;
+    region->prev = c->regions;
+    c->regions = region;
+}
+
+/* BobCloseRegion - close an allocation region freeing its unreachable objects */
+int BobCloseRegion(BobInterpreter *c,BobRegion *region)
+{
+    int freedP;
+
+    /* close the region and any regions opened after it */
+    c->regions = region->prev;
+
+    /* check for an empty region */
+    if (region->mark == c->newSpace->free)
+        freedP = TRUE;
+
+    /* collect the whole heap if an older object may not have been remembered */
+    else if (c->rememberedOverflowP) {
+        BobCollectGarbage(c);
+        freedP = FALSE;
+    }
+
+    /* collect the region */
+    else {
+        SortRemembered(c);
+#ifdef BOB_VERIFY_REGIONS
+        VerifyRemembered(c,region->mark);
+#endif
+        freedP = BobCollectRegion(c,region->mark);
+    }
+
+    /* objects in the enclosing region don't need to be remembered */
+    KeepRemembered(c,c->regions ? c->regions->mark : NULL);
+    return freedP;
+}
+
+/* BobRememberStore - remember an older object that is given a reference to a region object */
+void BobRememberStore(BobInterpreter *c,BobValue obj,BobValue value)
+{
+    BobRegion *region;
+
+    /* find the innermost region containing the value */
+    if (!BobPointerP(value) || (unsigned char *)value >= c->newSpace->free)
+        return;
+    for (region = c->regions; region != NULL; region = region->prev)
+        if ((unsigned char *)value >= region->mark) {
+            Remember(c,obj,region->mark);
+            break;
+        }
+}
+
+/* BobRememberObject - remember an older object that is given values from another object */
+void BobRememberObject(BobInterpreter *c,BobValue obj)
+{
+    Remember(c,obj,c->regions->mark);
+}
+
+/* Remember - add an object allocated before a region mark to the remembered set */
+static void Remember(BobInterpreter *c,BobValue obj,unsigned char *mark)
+{
+    /* only heap objects allocated before the mark are remembered */
+    if ((unsigned char *)obj < c->newSpace->base || (unsigned char *)obj >= mark)
+        return;
+
+    /* the same object is often stored into several times in a row */
+    if (c->rememberedCount > 0 && c->remembered[c->rememberedCount - 1] == obj)
+        return;
+
+    /* expand the remembered set if necessary */
+    if (c->rememberedCount >= c->rememberedSize) {
+        long newSize = c->rememberedSize ? c->rememberedSize * 2 : RememberedInitialSize;
+        BobValue *newSet;
+        if ((newSet = (BobValue *)BobAlloc(c,newSize * sizeof(BobValue))) == NULL) {
+            c->rememberedOverflowP = TRUE;
+            return;
+        }
+        if (c->remembered) {
+            memcpy(newSet,c->remembered,c->rememberedCount * sizeof(BobValue));
+            BobFree(c,c->remembered);
+        }
+        c->remembered = newSet;
+        c->rememberedSize = newSize;
+    }
+
+    /* remember the object */
+    c->remembered[c->rememberedCount++] = obj;
+}
+
+/* SortRemembered - sort the remembered set and remove duplicates */
+static void SortRemembered(BobInterpreter *c)
+{
+    long i,j;
+    if (c->rememberedCount > 1) {
+        qsort(c->remembered,(size_t)c->rememberedCount,sizeof(BobValue),CompareObjects);
+        for (i = 1, j = 0; i < c->rememberedCount; ++i)
+            if (c->remembered[i] != c->remembered[j])
+                c->remembered[++j] = c->remembered[i];
+        c->rememberedCount = j + 1;
+    }
+}
+
+/* CompareObjects - compare the addresses of two objects */
+static int CompareObjects(const void *p1,const void *p2)
+{
+    unsigned char *obj1 = *(unsigned char **)p1;
+    unsigned char *obj2 = *(unsigned char **)p2;
+    return obj1 < obj2 ? -1 : obj1 == obj2 ? 0 : 1;
+}
+
+/* KeepRemembered - keep the remembered objects allocated before a mark (or none) */
+static void KeepRemembered(BobInterpreter *c,unsigned char *mark)
+{
+    long i,j = 0;
+    if (mark != NULL) {
+        for (i = 0; i < c->rememberedCount; ++i)
+            if ((unsigned char *)c->remembered[i] < mark)
+                c->remembered[j++] = c->remembered[i];
+    }
+    c->rememberedCount = j;
+}
+
+#ifdef BOB_VERIFY_REGIONS
+
+/* verify visitor structure */
+typedef struct {
+    BobHeapVisitor hdr;         /* visitor header */
+    unsigned char *mark;        /* start of the region */
+    unsigned char *free;        /* end of the region */
+    int referenceP;             /* a region object is referenced */
+} VerifyVisitor;
+
+/* VerifyRemembered - check that the older objects referring to the region were remembered */
+static void VerifyRemembered(BobInterpreter *c,unsigned char *mark)
+{
+    unsigned char *scan;
+    VerifyVisitor v;
+
+    /* initialize the visitor */
+    v.hdr.visit = VisitReference;
+    v.mark = mark;
+    v.free = c->newSpace->free;
+
+    /* check each object allocated before the region */
+    for (scan = c->newSpace->base; scan < mark; ) {
+        BobValue obj = (BobValue)scan;
+        scan += (*BobQuickGetDispatch(obj)->size)(obj);
+        v.referenceP = FALSE;
+        BobVisitObject(c,&v.hdr,obj);
+        if (v.referenceP
+        &&  !bsearch(&obj,c->remembered,(size_t)c->rememberedCount,sizeof(BobValue),CompareObjects)) {
+            BobStreamPutS("[Region reference not remembered in a ",c->standardError);
+            BobStreamPutS(BobTypeName(obj),c->standardError);
+            BobStreamPutS("]\n",c->standardError);
+        }
+    }
+}
+
+/* VisitReference - check for a reference to an object in the region */
+static BobValue VisitReference(BobInterpreter *c,BobHeapVisitor *v,BobValue obj)
+{
+    VerifyVisitor *vv = (VerifyVisitor *)v;
+    if ((unsigned char *)obj >= vv->mark && (unsigned char *)obj < vv->free)
+        vv->referenceP = TRUE;
+    return obj;
+}
+
+#endif
@@ -0,0 +1,259 @@
+/* bobsnap.c - heap snapshot writer */
+/*
+        Copyright (c) 2001, by David Michael Betz
+        All rights reserved
+*/
+
+/*
+    A heap snapshot is written right after a garbage collection so the
+    heap contains only reachable objects.  Objects are identified by their
+    offset from the base of the heap.  The file format is:
+
+        'B' 'O' 'B' 'H' version
+        records...
+        BobSnapTagEnd
+
+    Each record starts with a tag byte followed by unsigned LEB128 integers:
+
+        BobSnapTagType      id name-length name-bytes
+        BobSnapTagRoot      root-kind object
+        BobSnapTagObject    object type-id size label-length label-bytes
+                            reference-count references...
+
+    Type records appear before the first object of that type.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "bob.h"
+
+/* maximum length of an object label */
+#define MaxLabelLength  40
+
+/* snapshot writer structure */
+typedef struct {
+    BobHeapVisitor hdr;         /* visitor header */
+    BobStream *s;               /* output stream */
+    int errorP;                 /* an error has occurred */
+    BobValue *refs;             /* references from the current object */
+    long refCount;              /* number of references */
+    long refSize;               /* size of the reference array */
+    BobDispatch **types;        /* types written so far */
+    long typeCount;             /* number of types */
+    long typeSize;              /* size of the type array */
+} SnapshotWriter;
+
+/* prototypes */
+static BobValue VisitRoot(BobInterpreter *c,BobHeapVisitor *v,BobValue obj);
+static BobValue VisitReference(BobInterpreter *c,BobHeapVisitor *v,BobValue obj);
+static BobValue HeapReferent(BobInterpreter *c,BobValue obj);
+static long TypeID(BobInterpreter *c,SnapshotWriter *w,BobDispatch *d);
+static void WriteObject(BobInterpreter *c,SnapshotWriter *w,BobValue obj,long size);
+static void WriteLabel(BobInterpreter *c,SnapshotWriter *w,BobValue obj);
+static void WriteBytes(SnapshotWriter *w,unsigned char *p,long length);
+static void WriteNumber(SnapshotWriter *w,unsigned long n);
+static void WriteByte(SnapshotWriter *w,int byte);
+
+/* BobWriteHeapSnapshot - write a snapshot of the heap to a stream */
+int BobWriteHeapSnapshot(BobInterpreter *c,BobStream *s)
+{
+    unsigned char *scan;
+    SnapshotWriter w;
+
+    /* collect the garbage so only reachable objects remain */
+    BobCollectGarbage(c);
+
+    /* initialize the writer */
+    memset(&w,0,sizeof(w));
+    w.s = s;
+
+    /* write the header */
+    WriteBytes(&w,(unsigned char *)"BOBH",4);
+    WriteNumber(&w,BobSnapshotVersion);
+
+    /* write the roots */
+    w.hdr.visit = VisitRoot;
+    BobVisitRoots(c,&w.hdr);
+
+    /* write each heap object */
+    w.hdr.visit = VisitReference;
+    scan = c->newSpace->base;
+    while (!w.errorP && scan < c->newSpace->free) {
+        BobValue obj = (BobValue)scan;
+        long size = BobQuickGetDispatch(obj)->size(obj);
+        w.refCount = 0;
+        BobVisitObject(c,&w.hdr,obj);
+        WriteObject(c,&w,obj,size);
+        scan += size;
+    }
+    WriteByte(&w,BobSnapTagEnd);
+
+    /* free the work arrays */
+    if (w.refs)
+        BobFree(c,w.refs);
+    if (w.types)
+        BobFree(c,w.types);
+
+    /* return status */
+    return !w.errorP;
+}
+
+/* VisitRoot - write a root record */
+static BobValue VisitRoot(BobInterpreter *c,BobHeapVisitor *v,BobValue obj)
+{
+    SnapshotWriter *w = (SnapshotWriter *)v;
+    BobValue referent = HeapReferent(c,obj);
+    if (referent) {
+        WriteByte(w,BobSnapTagRoot);
+        WriteNumber(w,v->rootKind);
+        WriteNumber(w,(unsigned char *)referent - c->newSpace->base);
+    }
+    return obj;
+}
+
+/* VisitReference - record a reference from the current object */
+static BobValue VisitReference(BobInterpreter *c,BobHeapVisitor *v,BobValue obj)
+{
+    SnapshotWriter *w = (SnapshotWriter *)v;
+    BobValue referent = HeapReferent(c,obj);
+    if (referent) {
+        if (w->refCount >= w->refSize) {
+            long newSize = w->refSize ? w->refSize * 2 : 64;
+            BobValue *newRefs = (BobValue *)BobAlloc(c,newSize * sizeof(BobValue));
+            if (!newRefs) {
+                w->errorP = TRUE;
+                return obj;
+            }
+            if (w->refs) {
+                memcpy(newRefs,w->refs,w->refCount * sizeof(BobValue));
+                BobFree(c,w->refs);
+            }
+            w->refs = newRefs;
+            w->refSize = newSize;
+        }
+        w->refs[w->refCount++] = referent;
+    }
+    return obj;
+}
+
+/* HeapReferent - get the heap object referenced by a value */
+static BobValue HeapReferent(BobInterpreter *c,BobValue obj)
+{
+    /* stack environments that have been moved refer to heap environments */
+    if (BobMovedEnvironmentP(obj))
+        obj = BobMovedEnvForwardingAddr(obj);
+
+    /* only report heap objects */
+    if ((unsigned char *)obj < c->newSpace->base
+    ||  (unsigned char *)obj >= c->newSpace->free)
+        return NULL;
+    return obj;
+}
+
+/* TypeID - get the id of a type writing a type record if necessary */
+static long TypeID(BobInterpreter *c,SnapshotWriter *w,BobDispatch *d)
+{
+    long i;
+
+    /* look for a type that has already been written */
+    for (i = 0; i < w->typeCount; ++i)
+        if (w->types[i] == d)
+            return i;
+
+    /* expand the type array if necessary */
+    if (w->typeCount >= w->typeSize) {
+        long newSize = w->typeSize ? w->typeSize * 2 : 32;
+        BobDispatch **newTypes = (BobDispatch **)BobAlloc(c,newSize * sizeof(BobDispatch *));
+        if (!newTypes) {
+            w->errorP = TRUE;
+            return 0;
+        }
+        if (w->types) {
+            memcpy(newTypes,w->types,w->typeCount * sizeof(BobDispatch *));
+            BobFree(c,w->types);
+        }
+        w->types = newTypes;
+        w->typeSize = newSize;
+    }
+
+    /* write the type record */
+    WriteByte(w,BobSnapTagType);
+    WriteNumber(w,w->typeCount);
+    WriteNumber(w,strlen(d->typeName));
+    WriteBytes(w,(unsigned char *)d->typeName,strlen(d->typeName));
+    w->types[w->typeCount] = d;
+    return w->typeCount++;
+}
+
+/* WriteObject - write an object record */
+static void WriteObject(BobInterpreter *c,SnapshotWriter *w,BobValue obj,long size)
+{
+    long typeID = TypeID(c,w,BobQuickGetDispatch(obj));
+    long i;
+    WriteByte(w,BobSnapTagObject);
+    WriteNumber(w,(unsigned char *)obj - c->newSpace->base);
+    WriteNumber(w,typeID);
+    WriteNumber(w,size);
+    WriteLabel(c,w,obj);
+    WriteNumber(w,w->refCount);
+    for (i = 0; i < w->refCount; ++i)
+        WriteNumber(w,(unsigned char *)w->refs[i] - c->newSpace->base);
+}
+
+/* WriteLabel - write a label to help identify an object */
+static void WriteLabel(BobInterpreter *c,SnapshotWriter *w,BobValue obj)
+{
+    BobValue name = NULL;
+    long length;
+
+    /* find a string describing the object */
+    if (BobSymbolP(obj) || BobStringP(obj))
+        name = obj;
+    else if (BobCompiledCodeP(obj)) {
+        name = BobCompiledCodeName(obj);
+        if (!BobSymbolP(name) && !BobStringP(name))
+            name = NULL;
+    }
+
+    /* write the label */
+    if (!name)
+        WriteNumber(w,0);
+    else if (BobSymbolP(name)) {
+        length = BobSymbolPrintNameLength(name);
+        if (length > MaxLabelLength)
+            length = MaxLabelLength;
+        WriteNumber(w,length);
+        WriteBytes(w,BobSymbolPrintName(name),length);
+    }
+    else {
+        length = BobStringSize(name);
+        if (length > MaxLabelLength)
+            length = MaxLabelLength;
+        WriteNumber(w,length);
+        WriteBytes(w,BobStringAddress(name),length);
+    }
+}
+
+/* WriteBytes - write a sequence of bytes */
+static void WriteBytes(SnapshotWriter *w,unsigned char *p,long length)
+{
+    while (--length >= 0)
+        WriteByte(w,*p++);
+}
+
+/* WriteNumber - write an unsigned LEB128 number */
+static void WriteNumber(SnapshotWriter *w,unsigned long n)
+{
+    while (n >= 0x80) {
+        WriteByte(w,(int)(n & 0x7f) | 0x80);
+        n >>= 7;
+    }
+    WriteByte(w,(int)n);
+}
+
+/* WriteByte - write a byte */
+static void WriteByte(SnapshotWriter *w,int byte)
+{
+    if (!w->errorP && BobStreamPutC(byte,w->s) == EOF)
+        w->errorP = TRUE;
+}
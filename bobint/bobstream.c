@@ -253,6 +253,12 @@ BobStream *BobMakeIndirectStream(BobInterpreter *c,BobStream **pStream)
     return (BobStream *)s;
 }
 
+/* BobIndirectStreamTarget - get the stream pointer of an indirect stream */
+BobStream **BobIndirectStreamTarget(BobStream *s)
+{
+    return s->d == &indirectDispatch ? ((BobIndirectStream *)s)->pStream : NULL;
+}
+
 static int CloseIndirectStream(BobStream *s)
 {
     free((void *)s);
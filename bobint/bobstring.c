@@ -14,6 +14,13 @@ static BobValue BIF_Intern(BobInterpreter *c);
 static BobValue BIF_Index(BobInterpreter *c);
 static BobValue BIF_ReverseIndex(BobInterpreter *c);
 static BobValue BIF_Substring(BobInterpreter *c);
+static BobValue BIF_Slice(BobInterpreter *c);
+static BobValue BIF_Split(BobInterpreter *c);
+static BobValue BIF_Join(BobInterpreter *c);
+static BobValue BIF_Replace(BobInterpreter *c);
+static BobValue BIF_Trim(BobInterpreter *c);
+static BobValue BIF_StartsWith(BobInterpreter *c);
+static BobValue BIF_EndsWith(BobInterpreter *c);
 static BobValue BIF_toInteger(BobInterpreter *c);
 #ifdef BOB_INCLUDE_FLOAT_SUPPORT
 static BobValue BIF_toFloat(BobInterpreter *c);
@@ -22,6 +29,16 @@ static BobValue BIF_toFloat(BobInterpreter *c);
 /* virtual property methods */
 static BobValue BIF_size(BobInterpreter *c,BobValue obj);
 
+/* prototypes */
+static int SubstringRange(long len,long *pStart,long *pCount);
+static unsigned char *SearchPattern(BobInterpreter *c,BobValue pat,unsigned char *pCh,long *pLen);
+static BobValue CopySubstring(BobInterpreter *c,int n,long offset,long count);
+static BobValue SplitWords(BobInterpreter *c);
+static int SpaceP(int ch);
+
+/* patterns at least this long are searched by skipping ahead instead of by their first byte */
+#define SkipSearchMinimum   16
+
 /* String methods */
 static BobCMethod methods[] = {
 BobMethodEntry( "initialize",       BIF_initialize      ),
@@ -29,6 +46,13 @@ BobMethodEntry( "Intern",           BIF_Intern          ),
 BobMethodEntry( "Index",            BIF_Index           ),
 BobMethodEntry( "ReverseIndex",     BIF_ReverseIndex    ),
 BobMethodEntry( "Substring",        BIF_Substring       ),
+BobMethodEntry( "Slice",            BIF_Slice           ),
+BobMethodEntry( "Split",            BIF_Split           ),
+BobMethodEntry( "Join",             BIF_Join            ),
+BobMethodEntry( "Replace",          BIF_Replace         ),
+BobMethodEntry( "Trim",             BIF_Trim            ),
+BobMethodEntry( "StartsWith",       BIF_StartsWith      ),
+BobMethodEntry( "EndsWith",         BIF_EndsWith        ),
 BobMethodEntry( "toInteger",        BIF_toInteger       ),
 #ifdef BOB_INCLUDE_FLOAT_SUPPORT
 BobMethodEntry( "toFloat",          BIF_toFloat         ),
@@ -70,83 +94,404 @@ static BobValue BIF_Intern(BobInterpreter *c)
 /* BIF_Index - built-in method 'Index' */
 static BobValue BIF_Index(BobInterpreter *c)
 {
-    char *str,*p;
-    int len,ch;
+    unsigned char *pat,ch;
+    BobValue obj;
+    long patLen,i,start = 0;
+    char *str;
+    int len;
     
     /* parse the arguments */
-    BobParseArguments(c,"S#*i",&str,&len,&ch);
+    BobParseArguments(c,"S#*V|l",&str,&len,&obj,&start);
+    pat = SearchPattern(c,obj,&ch,&patLen);
 
-    /* find the character */
-    if (!(p = strchr(str,ch)))
+    /* find the pattern */
+    if (start < 0 || start > len
+    ||  (i = BobFindBytes((unsigned char *)str + start,len - start,pat,patLen)) < 0)
         return c->nilValue;
     
-    /* return the index of the character */
-    return BobMakeInteger(c,p - str);
+    /* return the index of the pattern */
+    return BobMakeInteger(c,start + i);
 }
 
 /* BIF_ReverseIndex - built-in method 'ReverseIndex' */
 static BobValue BIF_ReverseIndex(BobInterpreter *c)
 {
-    char *str,*p;
-    int len,ch;
+    unsigned char *pat,ch;
+    BobValue obj;
+    long patLen,i,start = -1;
+    char *str;
+    int len;
     
     /* parse the arguments */
-    BobParseArguments(c,"S#*i",&str,&len,&ch);
+    BobParseArguments(c,"S#*V|l",&str,&len,&obj,&start);
+    pat = SearchPattern(c,obj,&ch,&patLen);
 
-    /* find the character */
-    if (!(p = strrchr(str,ch)))
+    /* find the last occurrence of the pattern that starts at or before 'start' */
+    if (BobArgCnt(c) < 4 || start > len - patLen)
+        start = len - patLen;
+    if (start < 0
+    ||  (i = BobFindLastBytes((unsigned char *)str,start + patLen,pat,patLen)) < 0)
         return c->nilValue;
     
-    /* return the index of the character */
-    return BobMakeInteger(c,p - str);
+    /* return the index of the pattern */
+    return BobMakeInteger(c,i);
 }
 
 /* BIF_Substring - built-in method 'Substring' */
 static BobValue BIF_Substring(BobInterpreter *c)
 {
-    int len,i,cnt = -1;
+    long i,cnt = -1;
     char *str;
+    int len;
+    
+    /* parse the arguments */
+    BobParseArguments(c,"S#*l|l",&str,&len,&i,&cnt);
+
+    /* check the range */
+    if (!SubstringRange((long)len,&i,&cnt))
+        return c->nilValue;
+    
+    /* return the substring */
+    return CopySubstring(c,1,i,cnt);
+}
+
+/* BIF_Slice - built-in method 'Slice' */
+static BobValue BIF_Slice(BobInterpreter *c)
+{
+    long i,cnt = -1;
+    BobValue obj;
+    
+    /* parse the arguments */
+    BobParseArguments(c,"V=*l|l",&obj,&BobStringDispatch,&i,&cnt);
+
+    /* check the range */
+    if (!SubstringRange((long)BobStringSize(obj),&i,&cnt))
+        return c->nilValue;
     
+    /* return the slice */
+    return BobMakeStringSlice(c,obj,i,cnt);
+}
+
+/* BIF_Split - built-in method 'Split' */
+static BobValue BIF_Split(BobInterpreter *c)
+{
+    unsigned char *pat,ch;
+    long len,patLen,pos,end,count,i;
+    BobValue obj,sep,vector;
+
+    /* parse the arguments */
+    BobParseArguments(c,"V=*|V",&obj,&BobStringDispatch,&sep);
+
+    /* split at runs of white space without a separator */
+    if (BobArgCnt(c) < 3)
+        return SplitWords(c);
+
+    /* count the fields (an empty separator splits the string into characters) */
+    pat = SearchPattern(c,sep,&ch,&patLen);
+    len = BobStringSize(obj);
+    if (patLen == 0)
+        count = len;
+    else {
+        for (count = 1, pos = 0; (i = BobFindBytes(BobStringAddress(obj) + pos,len - pos,pat,patLen)) >= 0; ++count)
+            pos += i + patLen;
+    }
+
+    /* make the vector and fill it */
+    vector = BobMakeVector(c,count);
+    BobCPush(c,vector);
+    for (i = 0, pos = 0; i < count; ++i, pos = end + patLen) {
+        if (patLen == 0)
+            end = pos + 1;
+        else if (i == count - 1)
+            end = len;
+        else {
+            obj = BobGetArg(c,1);
+            pat = SearchPattern(c,BobGetArg(c,3),&ch,&patLen);
+            end = pos + BobFindBytes(BobStringAddress(obj) + pos,len - pos,pat,patLen);
+        }
+        obj = CopySubstring(c,1,pos,end - pos);
+        BobWriteBarrier(c,BobTop(c),obj);
+        BobSetVectorElementI(BobTop(c),i,obj);
+    }
+    return BobPop(c);
+}
+
+/* SplitWords - split the string passed as the first argument at runs of white space */
+static BobValue SplitWords(BobInterpreter *c)
+{
+    long len = BobStringSize(BobGetArg(c,1)),pos,start,count = 0,i;
+    unsigned char *str = BobStringAddress(BobGetArg(c,1));
+    BobValue vector,word;
+
+    /* count the words */
+    for (pos = 0; pos < len; ) {
+        while (pos < len && SpaceP(str[pos]))
+            ++pos;
+        if (pos < len) {
+            ++count;
+            while (pos < len && !SpaceP(str[pos]))
+                ++pos;
+        }
+    }
+
+    /* make the vector and fill it */
+    vector = BobMakeVector(c,count);
+    BobCPush(c,vector);
+    for (i = 0, pos = 0; i < count; ++i) {
+        str = BobStringAddress(BobGetArg(c,1));
+        while (SpaceP(str[pos]))
+            ++pos;
+        for (start = pos; pos < len && !SpaceP(str[pos]); )
+            ++pos;
+        word = CopySubstring(c,1,start,pos - start);
+        BobWriteBarrier(c,BobTop(c),word);
+        BobSetVectorElementI(BobTop(c),i,word);
+    }
+    return BobPop(c);
+}
+
+/* BIF_Join - built-in method 'Join' */
+static BobValue BIF_Join(BobInterpreter *c)
+{
+    BobValue sep,vector,str,*p;
+    long size,count,i;
+    unsigned char *dst;
+
     /* parse the arguments */
-    BobParseArguments(c,"S#*i|i",&str,&len,&i,&cnt);
+    BobParseArguments(c,"V=*V=",&sep,&BobStringDispatch,&vector,&BobVectorDispatch);
+
+    /* compute the size of the result */
+    count = BobVectorSize(vector);
+    p = BobVectorAddress(vector);
+    for (size = 0, i = 0; i < count; ++i) {
+        if (!BobStringP(p[i]))
+            BobTypeError(c,p[i]);
+        size += BobStringSize(p[i]);
+    }
+    if (count > 1)
+        size += (count - 1) * BobStringSize(sep);
+
+    /* make the result and copy the strings into it */
+    str = BobMakeString(c,NULL,size);
+    sep = BobGetArg(c,1);
+    p = BobVectorAddress(BobGetArg(c,3));
+    for (dst = BobStringAddress(str), i = 0; i < count; ++i) {
+        if (i > 0) {
+            memcpy(dst,BobStringAddress(sep),BobStringSize(sep));
+            dst += BobStringSize(sep);
+        }
+        memcpy(dst,BobStringAddress(p[i]),BobStringSize(p[i]));
+        dst += BobStringSize(p[i]);
+    }
+    return str;
+}
+
+/* BIF_Replace - built-in method 'Replace' */
+static BobValue BIF_Replace(BobInterpreter *c)
+{
+    BobValue obj,old,new,str;
+    long len,oldLen,newLen,pos,count,i;
+    unsigned char *dst;
+
+    /* parse the arguments */
+    BobParseArguments(c,"V=*V=V=",&obj,&BobStringDispatch,&old,&BobStringDispatch,&new,&BobStringDispatch);
+    len = BobStringSize(obj);
+    oldLen = BobStringSize(old);
+    newLen = BobStringSize(new);
+
+    /* count the occurrences */
+    count = 0;
+    if (oldLen > 0) {
+        for (pos = 0; (i = BobFindBytes(BobStringAddress(obj) + pos,len - pos,BobStringAddress(old),oldLen)) >= 0; ++count)
+            pos += i + oldLen;
+    }
+    if (count == 0)
+        return obj;
+
+    /* make the result and build it */
+    str = BobMakeString(c,NULL,len + count * (newLen - oldLen));
+    obj = BobGetArg(c,1);
+    old = BobGetArg(c,3);
+    new = BobGetArg(c,4);
+    for (dst = BobStringAddress(str), pos = 0; --count >= 0; pos += i + oldLen) {
+        i = BobFindBytes(BobStringAddress(obj) + pos,len - pos,BobStringAddress(old),oldLen);
+        memcpy(dst,BobStringAddress(obj) + pos,i);
+        memcpy(dst + i,BobStringAddress(new),newLen);
+        dst += i + newLen;
+    }
+    memcpy(dst,BobStringAddress(obj) + pos,len - pos);
+    return str;
+}
+
+/* BIF_Trim - built-in method 'Trim' */
+static BobValue BIF_Trim(BobInterpreter *c)
+{
+    long start,end;
+    unsigned char *str;
+    BobValue obj;
+    BobParseArguments(c,"V=*",&obj,&BobStringDispatch);
+    str = BobStringAddress(obj);
+    for (start = 0, end = BobStringSize(obj); start < end && SpaceP(str[start]); )
+        ++start;
+    while (end > start && SpaceP(str[end - 1]))
+        --end;
+    if (start == 0 && end == BobStringSize(obj))
+        return obj;
+    return CopySubstring(c,1,start,end - start);
+}
+
+/* BIF_StartsWith - built-in method 'StartsWith' */
+static BobValue BIF_StartsWith(BobInterpreter *c)
+{
+    BobValue obj,prefix;
+    BobParseArguments(c,"V=*V=",&obj,&BobStringDispatch,&prefix,&BobStringDispatch);
+    return BobToBoolean(c,BobStringSize(prefix) <= BobStringSize(obj)
+                       && memcmp(BobStringAddress(obj),BobStringAddress(prefix),BobStringSize(prefix)) == 0);
+}
+
+/* BIF_EndsWith - built-in method 'EndsWith' */
+static BobValue BIF_EndsWith(BobInterpreter *c)
+{
+    BobValue obj,suffix;
+    long offset;
+    BobParseArguments(c,"V=*V=",&obj,&BobStringDispatch,&suffix,&BobStringDispatch);
+    if ((offset = BobStringSize(obj) - BobStringSize(suffix)) < 0)
+        return c->falseValue;
+    return BobToBoolean(c,memcmp(BobStringAddress(obj) + offset,BobStringAddress(suffix),BobStringSize(suffix)) == 0);
+}
+
+/* CopySubstring - copy part of the string passed as argument 'n' to a new string */
+static BobValue CopySubstring(BobInterpreter *c,int n,long offset,long count)
+{
+    BobValue str = BobMakeString(c,NULL,count);
+    memcpy(BobStringAddress(str),BobStringAddress(BobGetArg(c,n)) + offset,count);
+    return str;
+}
+
+/* SpaceP - check for a white space character */
+static int SpaceP(int ch)
+{
+    return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r' || ch == '\f' || ch == '\v';
+}
+
+/* SubstringRange - compute the start and count of a substring */
+static int SubstringRange(long len,long *pStart,long *pCount)
+{
+    long i = *pStart,cnt = *pCount;
 
     /* handle indexing from the left */
     if (i > 0) {
         if (i > len)
-            return c->nilValue;
+            return FALSE;
     }
     
     /* handle indexing from the right */
     else if (i < 0) {
         if ((i = len + i) < 0)
-            return c->nilValue;
+            return FALSE;
     }
 
     /* handle the count */
     if (cnt < 0)
         cnt = len - i;
     else if (i + cnt > len)
-        return c->nilValue;
-    
-    /* return the substring */
-    return BobMakeString(c,(unsigned char *)(str + i),cnt);
+        return FALSE;
+
+    /* return the range */
+    *pStart = i;
+    *pCount = cnt;
+    return TRUE;
+}
+
+/* SearchPattern - get the bytes of a character or string to search for */
+static unsigned char *SearchPattern(BobInterpreter *c,BobValue pat,unsigned char *pCh,long *pLen)
+{
+    if (BobIntegerP(pat)) {
+        *pCh = (unsigned char)BobIntegerValue(pat);
+        *pLen = 1;
+        return pCh;
+    }
+    else if (BobStringP(pat)) {
+        *pLen = BobStringSize(pat);
+        return BobStringAddress(pat);
+    }
+    BobTypeError(c,pat);
+    return NULL; /* never reached */
+}
+
+/* BobFindBytes - find the first occurrence of a pattern in a block of bytes */
+long BobFindBytes(unsigned char *str,long len,unsigned char *pat,long patLen)
+{
+    unsigned char *p,*end;
+
+    /* handle patterns that can't be found and the empty pattern */
+    if (patLen > len)
+        return -1;
+    else if (patLen == 0)
+        return 0;
+
+    /* scan for the first byte and compare the rest (memchr and memcmp are vectorized) */
+    if (patLen < SkipSearchMinimum) {
+        end = str + len - patLen + 1;
+        for (p = str; (p = memchr(p,pat[0],end - p)) != NULL; ++p)
+            if (memcmp(p + 1,pat + 1,patLen - 1) == 0)
+                return p - str;
+    }
+
+    /* skip ahead by the distance from the last occurrence of the byte
+       under the end of the pattern to the end of the pattern (Horspool) */
+    else {
+        long skip[256],i;
+        unsigned char last = pat[patLen - 1];
+        for (i = 0; i < 256; ++i)
+            skip[i] = patLen;
+        for (i = 0; i < patLen - 1; ++i)
+            skip[pat[i]] = patLen - 1 - i;
+        end = str + len - patLen;
+        for (p = str; p <= end; p += skip[p[patLen - 1]])
+            if (p[patLen - 1] == last && memcmp(p,pat,patLen - 1) == 0)
+                return p - str;
+    }
+
+    /* not found */
+    return -1;
+}
+
+/* BobFindLastBytes - find the last occurrence of a pattern in a block of bytes */
+long BobFindLastBytes(unsigned char *str,long len,unsigned char *pat,long patLen)
+{
+    unsigned char *p;
+
+    /* handle patterns that can't be found and the empty pattern */
+    if (patLen > len)
+        return -1;
+    else if (patLen == 0)
+        return len;
+
+    /* scan backward for the first byte and compare the rest */
+    for (p = str + len - patLen; p >= str; --p)
+        if (*p == pat[0] && memcmp(p + 1,pat + 1,patLen - 1) == 0)
+            return p - str;
+
+    /* not found */
+    return -1;
 }
 
 /* BIF_toInteger - built-in method 'toInteger' */
 static BobValue BIF_toInteger(BobInterpreter *c)
 {
-    BobValue obj;
-    BobParseArguments(c,"V=*",&obj,&BobStringDispatch);
-    return BobMakeInteger(c,atoi((char *)BobStringAddress(obj)));
+    char *str;
+    BobParseArguments(c,"S*",&str);
+    return BobMakeInteger(c,atoi(str));
 }
 
 /* BIF_toFloat - built-in method 'toFloat' */
 #ifdef BOB_INCLUDE_FLOAT_SUPPORT
 static BobValue BIF_toFloat(BobInterpreter *c)
 {
-    BobValue obj;
-    BobParseArguments(c,"V=*",&obj,&BobStringDispatch);
-    return BobMakeFloat(c,atof((char *)BobStringAddress(obj)));
+    char *str;
+    BobParseArguments(c,"S*",&str);
+    return BobMakeFloat(c,atof(str));
 }
 #endif
 
@@ -163,6 +508,11 @@ static BobValue StringNewInstance(BobInterpreter *c,BobValue parent);
 static int StringPrint(BobInterpreter *c,BobValue val,BobStream *s);
 static long StringSize(BobValue obj);
 static BobIntegerType StringHash(BobValue obj);
+static long StringSliceSize(BobValue obj);
+static BobValue StringSliceCopy(BobInterpreter *c,BobValue obj);
+static void StringSliceScan(BobInterpreter *c,BobValue obj);
+static BobIntegerType StringSliceHash(BobValue obj);
+static BobValue DetachSlice(BobInterpreter *c,BobValue obj);
 
 /* String dispatch */
 BobDispatch BobStringDispatch = {
@@ -178,6 +528,20 @@ BobDispatch BobStringDispatch = {
     StringHash
 };
 
+/* StringSlice dispatch */
+BobDispatch BobStringSliceDispatch = {
+    "String",
+    &BobStringDispatch,
+    GetStringProperty,
+    SetStringProperty,
+    StringNewInstance,
+    StringPrint,
+    StringSliceSize,
+    StringSliceCopy,
+    StringSliceScan,
+    StringSliceHash
+};
+
 /* GetStringProperty - String get property handler */
 static int GetStringProperty(BobInterpreter *c,BobValue obj,BobValue tag,BobValue *pValue)
 {
@@ -200,6 +564,10 @@ static int SetStringProperty(BobInterpreter *c,BobValue obj,BobValue tag,BobValu
             BobTypeError(c,value);
         if ((i = BobIntegerValue(tag)) < 0 || i >= BobStringSize(obj))
             BobCallErrorHandler(c,BobErrIndexOutOfBounds,tag);
+        if (BobFrozenP(c,obj))
+            BobCallErrorHandler(c,BobErrFrozenObject,obj);
+        if (BobStringSliceP(obj))
+            obj = DetachSlice(c,obj);
         BobSetStringElement(obj,i,(int)BobIntegerValue(value));
         return TRUE;
     }
@@ -234,7 +602,12 @@ static long StringSize(BobValue obj)
 /* StringHash - String hash handler */
 static BobIntegerType StringHash(BobValue obj)
 {
-    return BobHashString(BobStringAddress(obj),BobStringSize(obj));
+    BobIntegerType hash = BobStringHash(obj);
+    if (hash == 0) {
+        hash = BobHashString(BobStringAddress(obj),BobStringSize(obj));
+        BobSetStringHash(obj,hash);
+    }
+    return hash;
 }
 
 /* BobMakeString - make and initialize a new string value */
@@ -242,9 +615,10 @@ BobValue BobMakeString(BobInterpreter *c,unsigned char *data,BobIntegerType size
 {
     long allocSize = sizeof(BobString) + BobRoundSize(size + 1); /* space for zero terminator */
     BobValue new = BobAllocate(c,allocSize);
-    unsigned char *p = BobStringAddress(new);
+    unsigned char *p = BobStringInlineAddress(new);
     BobSetDispatch(new,&BobStringDispatch);
     BobSetStringSize(new,size);
+    BobSetStringHash(new,0);
     if (data)
         memcpy(p,data,size);
     else
@@ -258,3 +632,129 @@ BobValue BobMakeCString(BobInterpreter *c,char *str)
 {
     return BobMakeString(c,(unsigned char *)str,(BobIntegerType)strlen(str));
 }
+
+/* SLICE */
+
+/*
+    A slice refers to a range of the characters of another string instead
+    of copying them.  Every user of BobStringAddress sees the characters
+    of the original string.  Storing into a slice first gives it its own
+    copy of its characters.  Storing into the original string is seen by
+    its slices.  That is why a slice never caches its hash value.
+
+    A slice keeps the string it refers to alive.  To avoid holding on to
+    a large string for the sake of a few characters, the collector copies
+    the characters of a slice into a new string when the slice covers less
+    than half of a string that hasn't been copied yet.  That can use more
+    space than the objects took before the collection, so the collector
+    only does it while the space left over (sliceBudget) allows it.
+*/
+
+/* StringSliceSize - StringSlice size handler */
+static long StringSliceSize(BobValue obj)
+{
+    return sizeof(BobStringSlice);
+}
+
+/* StringSliceCopy - StringSlice copy handler */
+static BobValue StringSliceCopy(BobInterpreter *c,BobValue obj)
+{
+    BobValue str = BobStringSliceString(obj),newObj;
+    BobIntegerType size = BobStringSize(obj);
+    long allocSize = sizeof(BobString) + BobRoundSize(size + 1);
+    long extra = allocSize - (long)sizeof(BobStringSlice);
+    unsigned char *p;
+
+    /* keep the slice if its string has been copied already or is frozen */
+    if (!BobOldObjectP(c,obj)
+    ||  !BobOldObjectP(c,str)
+    ||  BobBrokenHeartP(str)
+    ||  size >= BobStringSize(str) / 2
+    ||  extra > c->sliceBudget)
+        return BobDefaultCopy(c,obj);
+    c->sliceBudget -= extra > 0 ? extra : 0;
+
+    /* copy the characters into a new string */
+    newObj = (BobValue)c->newSpace->free;
+    c->newSpace->free += allocSize;
+    BobSetDispatch(newObj,&BobStringDispatch);
+    BobSetStringSize(newObj,size);
+    BobSetStringHash(newObj,0);
+    p = BobStringInlineAddress(newObj);
+    memcpy(p,BobStringInlineAddress(str) + BobStringSliceOffset(obj),size);
+    p[size] = '\0';
+
+    /* store a forwarding address in the old object */
+    BobSetDispatch(obj,&BobBrokenHeartDispatch);
+    BobBrokenHeartSetForwardingAddr(obj,newObj);
+    return newObj;
+}
+
+/* StringSliceScan - StringSlice scan handler */
+static void StringSliceScan(BobInterpreter *c,BobValue obj)
+{
+    BobSetStringSliceString(obj,BobCopyValue(c,BobStringSliceString(obj)));
+}
+
+/* StringSliceHash - StringSlice hash handler */
+static BobIntegerType StringSliceHash(BobValue obj)
+{
+    /* don't cache the hash since storing into the string changes it */
+    return BobHashString(BobStringAddress(obj),BobStringSize(obj));
+}
+
+/* DetachSlice - give a slice its own copy of its characters */
+static BobValue DetachSlice(BobInterpreter *c,BobValue obj)
+{
+    BobValue str;
+    BobCPush(c,obj);
+    str = BobMakeString(c,NULL,BobStringSize(obj));
+    obj = BobPop(c);
+    memcpy(BobStringInlineAddress(str),BobStringAddress(obj),BobStringSize(obj));
+    BobWriteBarrier(c,obj,str);
+    BobSetStringSliceString(obj,str);
+    BobSetStringSliceOffset(obj,0);
+    return obj;
+}
+
+/* BobMakeStringSlice - make a slice of a string */
+BobValue BobMakeStringSlice(BobInterpreter *c,BobValue str,BobIntegerType offset,BobIntegerType size)
+{
+    BobValue new;
+
+    /* slices always refer to a string that isn't a slice */
+    if (BobStringSliceP(str)) {
+        offset += BobStringSliceOffset(str);
+        str = BobStringSliceString(str);
+    }
+
+    /* copy short strings since the copy is no bigger than the slice */
+    BobCPush(c,str);
+    if (sizeof(BobString) + BobRoundSize(size + 1) <= sizeof(BobStringSlice)) {
+        new = BobMakeString(c,NULL,size);
+        memcpy(BobStringInlineAddress(new),BobStringInlineAddress(BobPop(c)) + offset,size);
+        return new;
+    }
+
+    /* make the slice */
+    new = BobAllocate(c,sizeof(BobStringSlice));
+    BobSetDispatch(new,&BobStringSliceDispatch);
+    BobSetStringSize(new,size);
+    BobSetStringHash(new,0);
+    BobSetStringSliceString(new,BobPop(c));
+    BobSetStringSliceOffset(new,offset);
+    return new;
+}
+
+/* BobFlattenString - return a string with its own characters */
+BobValue BobFlattenString(BobInterpreter *c,BobValue str)
+{
+    BobValue new;
+    if (!BobStringSliceP(str))
+        return str;
+    BobCPush(c,str);
+    new = BobMakeString(c,NULL,BobStringSize(str));
+    str = BobPop(c);
+    memcpy(BobStringInlineAddress(new),BobStringAddress(str),BobStringSize(str));
+    return new;
+}
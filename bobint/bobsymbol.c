@@ -48,6 +48,7 @@ static long SymbolSize(BobValue obj);
 static void SymbolScan(BobInterpreter *c,BobValue obj);
 static BobIntegerType SymbolHash(BobValue obj);
 static BobValue MakeSymbol(BobInterpreter *c,unsigned char *printName,int length,BobIntegerType hashValue);
+static void ExpandSymbolTable(BobInterpreter *c);
 
 BobDispatch BobSymbolDispatch = {
     "Symbol",
@@ -149,7 +150,59 @@ BobValue BobInternString(BobInterpreter *c,unsigned char *printName,int length)
             return sym;
     }
     sym = MakeSymbol(c,printName,length,hashValue);
+    if (++c->symbolCount > BobHashTableSize(c->symbols) * BobSymbolTableExpandThreshold) {
+        BobCPush(c,sym);
+        ExpandSymbolTable(c);
+        sym = BobPop(c);
+        i = hashValue & (BobHashTableSize(c->symbols) - 1);
+    }
+    BobWriteBarrier(c,sym,BobHashTableElement(c->symbols,i));
     BobSetSymbolNext(sym,BobHashTableElement(c->symbols,i));
+    BobWriteBarrier(c,c->symbols,sym);
     BobSetHashTableElement(c->symbols,i,sym);
     return sym;
 }
+
+/* ExpandSymbolTable - double the number of buckets in the symbol table */
+static void ExpandSymbolTable(BobInterpreter *c)
+{
+    BobIntegerType oldSize = BobHashTableSize(c->symbols);
+    BobIntegerType newSize = oldSize << 1;
+    BobValue newTable = BobMakeHashTable(c,newSize);
+    BobValue oldTable = c->symbols;
+    BobIntegerType j;
+    for (j = 0; j < oldSize; ++j) {
+        BobValue sym = BobHashTableElement(oldTable,j);
+        BobValue new0 = c->nilValue;
+        BobValue new1 = c->nilValue;
+        while (sym != c->nilValue) {
+            BobValue next = BobSymbolNext(sym);
+            if (SymbolHashValue(sym) & oldSize) {
+                BobWriteBarrier(c,sym,new1);
+                BobSetSymbolNext(sym,new1);
+                new1 = sym;
+            }
+            else {
+                BobWriteBarrier(c,sym,new0);
+                BobSetSymbolNext(sym,new0);
+                new0 = sym;
+            }
+            sym = next;
+        }
+        BobSetHashTableElement(newTable,j,new0);
+        BobSetHashTableElement(newTable,j + oldSize,new1);
+    }
+    c->symbols = newTable;
+}
+
+/* BobCountSymbols - count the symbols in the symbol table */
+long BobCountSymbols(BobInterpreter *c)
+{
+    BobIntegerType i;
+    long count = 0;
+    BobValue sym;
+    for (i = 0; i < BobHashTableSize(c->symbols); ++i)
+        for (sym = BobHashTableElement(c->symbols,i); sym != c->nilValue; sym = BobSymbolNext(sym))
+            ++count;
+    return count;
+}
@@ -62,6 +62,6 @@ void BobAddTypeSymbols(BobInterpreter *c)
 BobValue BobEnterType(BobInterpreter *c,char *name,BobDispatch *d)
 {
 	BobCPush(c,BobMakeCPtrObject(c,c->typeDispatch,d));
-    BobSetGlobalValue(BobInternCString(c,name),BobTop(c));
+    BobEnterVariable(c,name,BobTop(c));
     return BobPop(c);
 }
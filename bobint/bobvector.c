@@ -14,6 +14,12 @@ static BobValue BIF_Push(BobInterpreter *c);
 static BobValue BIF_PushFront(BobInterpreter *c);
 static BobValue BIF_Pop(BobInterpreter *c);
 static BobValue BIF_PopFront(BobInterpreter *c);
+static BobValue BIF_Sort(BobInterpreter *c);
+static BobValue BIF_Map(BobInterpreter *c);
+static BobValue BIF_Filter(BobInterpreter *c);
+static BobValue BIF_Reduce(BobInterpreter *c);
+static BobValue BIF_IndexOf(BobInterpreter *c);
+static BobValue BIF_Reverse(BobInterpreter *c);
 
 /* virtual property methods */
 static BobValue BIF_size(BobInterpreter *c,BobValue obj);
@@ -27,6 +33,12 @@ BobMethodEntry( "Push",             BIF_Push            ),
 BobMethodEntry( "PushFront",        BIF_PushFront       ),
 BobMethodEntry( "Pop",              BIF_Pop             ),
 BobMethodEntry( "PopFront",         BIF_PopFront        ),
+BobMethodEntry( "Sort",             BIF_Sort            ),
+BobMethodEntry( "Map",              BIF_Map             ),
+BobMethodEntry( "Filter",           BIF_Filter          ),
+BobMethodEntry( "Reduce",           BIF_Reduce          ),
+BobMethodEntry( "IndexOf",          BIF_IndexOf         ),
+BobMethodEntry( "Reverse",          BIF_Reverse         ),
 BobMethodEntry(	0,                  0                   )
 };
 
@@ -38,6 +50,20 @@ BobVPMethodEntry( 0,                0,					0					)
 
 /* prototypes */
 static BobValue ResizeVector(BobInterpreter *c,BobValue obj,BobIntegerType newSize);
+static BobValue ReallocateVector(BobInterpreter *c,BobValue obj,BobIntegerType maxSize,BobIntegerType start);
+static BobIntegerType ExpandAmount(BobIntegerType size);
+static BobValue CallElementFunction(BobInterpreter *c,int argc,BobValue arg1,BobValue arg2);
+static int CompareElements(BobInterpreter *c,BobValue obj1,BobValue obj2);
+static void InsertionSort(BobInterpreter *c,BobIntegerType start,BobIntegerType end);
+static void Merge(BobInterpreter *c,BobIntegerType from,BobIntegerType to,BobIntegerType lo,BobIntegerType mid,BobIntegerType hi);
+
+/* number of elements sorted by insertion before merging */
+#define SortRunSize     16
+
+/* sort work vector and element being inserted (see BIF_Sort) */
+#define SortWork(c)             ((c)->sp[1])
+#define SortTemp(c)             ((c)->sp[0])
+#define SortElement(c,i)        (BobVectorAddressI(SortWork(c))[i])
 
 /* BobInitVector - initialize the 'Vector' object */
 void BobInitVector(BobInterpreter *c)
@@ -75,6 +101,7 @@ static BobValue BIF_Push(BobInterpreter *c)
     obj = ResizeVector(c,obj,size + 1);
     if (BobMovedVectorP(obj))
         obj = BobVectorForwardingAddr(obj);
+    BobWriteBarrier(c,obj,BobTop(c));
     BobSetVectorElementI(obj,size,BobTop(c));
     return BobPop(c);
 }
@@ -82,18 +109,31 @@ static BobValue BIF_Push(BobInterpreter *c)
 /* BIF_PushFront - built-in method 'PushFront' */
 static BobValue BIF_PushFront(BobInterpreter *c)
 {
-    BobValue obj,val,*p;
-    BobIntegerType size;
+    BobValue obj,vector,val;
+    BobIntegerType start;
     BobParseArguments(c,"V=*V",&obj,&BobVectorDispatch,&val);
-    size = BobVectorSize(obj);
-    BobCPush(c,val);
-    obj = ResizeVector(c,obj,size + 1);
-    if (BobMovedVectorP(obj))
-        obj = BobVectorForwardingAddr(obj);
-    for (p = BobVectorAddress(obj) + size; --size >= 0; --p)
-        *p = p[-1];
-    BobSetVectorElementI(obj,0,BobTop(c));
-    return BobPop(c);
+    vector = BobMovedVectorP(obj) ? BobVectorForwardingAddr(obj) : obj;
+
+    /* make space at the front of the vector if there isn't any */
+    if ((start = BobVectorStart(vector)) == 0) {
+        BobIntegerType size = BobVectorSizeI(vector);
+        BobIntegerType back = BobVectorMaxSize(vector) - size;
+        BobIntegerType expand = ExpandAmount(size);
+        if (back > expand)
+            back = expand;
+        BobCPush(c,val);
+        obj = ReallocateVector(c,obj,expand + size + back,expand);
+        vector = BobVectorForwardingAddr(obj);
+        val = BobPop(c);
+        start = expand;
+    }
+
+    /* store the new first element */
+    BobSetVectorStart(vector,--start);
+    BobSetVectorSize(vector,BobVectorSizeI(vector) + 1);
+    BobWriteBarrier(c,vector,val);
+    BobSetVectorElementI(vector,0,val);
+    return val;
 }
 
 /* BIF_Pop - built-in method 'Pop' */
@@ -117,7 +157,7 @@ static BobValue BIF_Pop(BobInterpreter *c)
 /* BIF_PopFront - built-in method 'PopFront' */
 static BobValue BIF_PopFront(BobInterpreter *c)
 {
-    BobValue obj,vector,val,*p;
+    BobValue obj,vector,val;
     BobIntegerType size;
     BobParseArguments(c,"V=*",&obj,&BobVectorDispatch);
     if (BobMovedVectorP(obj))
@@ -128,12 +168,218 @@ static BobValue BIF_PopFront(BobInterpreter *c)
     if (size <= 0)
         BobCallErrorHandler(c,BobErrStackEmpty,obj);
     val = BobVectorElementI(vector,0);
-    BobSetVectorSize(vector,--size);
-    for (p = BobVectorAddress(vector); --size >= 0; ++p)
-        *p = p[1];
+    BobSetVectorElementI(vector,0,c->nilValue);
+    BobSetVectorStart(vector,--size == 0 ? 0 : BobVectorStart(vector) + 1);
+    BobSetVectorSize(vector,size);
     return val;
 }
 
+/* BIF_Sort - built-in method 'Sort' */
+static BobValue BIF_Sort(BobInterpreter *c)
+{
+    BobIntegerType size,width,lo,from = 0,to,tmp;
+    BobValue obj,fun;
+    BobParseArguments(c,"V=*|V",&obj,&BobVectorDispatch,&fun);
+    if ((size = BobVectorSize(obj)) < 2)
+        return obj;
+    to = size;
+
+    /* sort a copy since a comparison function can change the vector */
+    BobCheck(c,2);
+    BobPush(c,BobMakeVector(c,size * 2));
+    BobPush(c,c->nilValue);
+    memcpy(BobVectorAddress(SortWork(c)),BobVectorAddress(BobGetArg(c,1)),size * sizeof(BobValue));
+
+    /* sort short runs by insertion and then merge them */
+    for (lo = 0; lo < size; lo += SortRunSize)
+        InsertionSort(c,lo,lo + SortRunSize < size ? lo + SortRunSize : size);
+    for (width = SortRunSize; width < size; width *= 2) {
+        for (lo = 0; lo < size; lo += width * 2) {
+            BobIntegerType mid = lo + width < size ? lo + width : size;
+            BobIntegerType hi = mid + width < size ? mid + width : size;
+            Merge(c,from,to,lo,mid,hi);
+        }
+        tmp = from; from = to; to = tmp;
+    }
+
+    /* store the sorted elements back into the vector */
+    obj = BobGetArg(c,1);
+    if (BobVectorSize(obj) < size)
+        size = BobVectorSize(obj);
+    memcpy(BobVectorAddress(obj),BobVectorAddress(SortWork(c)) + from,size * sizeof(BobValue));
+    BobDrop(c,2);
+    return obj;
+}
+
+/* InsertionSort - sort a run of the sort work vector */
+static void InsertionSort(BobInterpreter *c,BobIntegerType start,BobIntegerType end)
+{
+    BobIntegerType i,lo,hi,mid;
+    BobValue *p;
+    for (i = start + 1; i < end; ++i) {
+        SortTemp(c) = SortElement(c,i);
+
+        /* find the position after the elements that aren't greater */
+        lo = start;
+        hi = i;
+        while (lo < hi) {
+            mid = (lo + hi) / 2;
+            if (CompareElements(c,SortTemp(c),SortElement(c,mid)) < 0)
+                hi = mid;
+            else
+                lo = mid + 1;
+        }
+
+        /* insert the element */
+        if (lo < i) {
+            p = BobVectorAddress(SortWork(c));
+            memmove(p + lo + 1,p + lo,(i - lo) * sizeof(BobValue));
+            p[lo] = SortTemp(c);
+        }
+    }
+}
+
+/* Merge - merge two sorted runs from one half of the sort work vector to the other */
+static void Merge(BobInterpreter *c,BobIntegerType from,BobIntegerType to,BobIntegerType lo,BobIntegerType mid,BobIntegerType hi)
+{
+    BobIntegerType i = lo,j = mid,k = lo;
+    BobValue *p;
+
+    /* merge the runs unless they are already in order */
+    if (mid < hi && CompareElements(c,SortElement(c,from + mid),SortElement(c,from + mid - 1)) < 0) {
+        while (i < mid && j < hi) {
+            if (CompareElements(c,SortElement(c,from + j),SortElement(c,from + i)) < 0)
+                SortElement(c,to + k++) = SortElement(c,from + j++);
+            else
+                SortElement(c,to + k++) = SortElement(c,from + i++);
+        }
+    }
+
+    /* copy what remains of the runs */
+    p = BobVectorAddress(SortWork(c));
+    memcpy(p + to + k,p + from + i,(mid - i) * sizeof(BobValue));
+    k += mid - i;
+    memcpy(p + to + k,p + from + j,(hi - j) * sizeof(BobValue));
+}
+
+/* CompareElements - compare two elements using the comparison function passed to 'Sort' */
+static int CompareElements(BobInterpreter *c,BobValue obj1,BobValue obj2)
+{
+    BobValue result;
+    if (BobArgCnt(c) < 3 || BobGetArg(c,3) == c->nilValue)
+        return BobCompareObjects(c,obj1,obj2);
+    result = CallElementFunction(c,2,obj1,obj2);
+    if (BobIntegerP(result))
+        return BobIntegerValue(result) < 0 ? -1 : BobIntegerValue(result) == 0 ? 0 : 1;
+#ifdef BOB_INCLUDE_FLOAT_SUPPORT
+    else if (BobFloatP(result))
+        return BobFloatValue(result) < 0 ? -1 : BobFloatValue(result) == 0 ? 0 : 1;
+#endif
+    BobTypeError(c,result);
+    return 0; /* never reached */
+}
+
+/* BIF_Map - built-in method 'Map' */
+static BobValue BIF_Map(BobInterpreter *c)
+{
+    BobIntegerType size,i;
+    BobValue obj,fun,val;
+    BobParseArguments(c,"V=*V",&obj,&BobVectorDispatch,&fun);
+    size = BobVectorSize(obj);
+    BobCPush(c,BobMakeVector(c,size));
+    for (i = 0; i < size && i < BobVectorSize(BobGetArg(c,1)); ++i) {
+        val = CallElementFunction(c,1,BobVectorElement(BobGetArg(c,1),i),c->nilValue);
+        BobWriteBarrier(c,BobTop(c),val);
+        BobSetVectorElement(BobTop(c),i,val);
+    }
+    BobSetVectorSize(BobTop(c),i);
+    return BobPop(c);
+}
+
+/* BIF_Filter - built-in method 'Filter' */
+static BobValue BIF_Filter(BobInterpreter *c)
+{
+    BobIntegerType size,count = 0,i;
+    BobValue obj,fun,val;
+    BobParseArguments(c,"V=*V",&obj,&BobVectorDispatch,&fun);
+    size = BobVectorSize(obj);
+    BobCheck(c,2);
+    BobPush(c,BobMakeVector(c,size));
+    for (i = 0; i < size && i < BobVectorSize(BobGetArg(c,1)); ++i) {
+        BobPush(c,BobVectorElement(BobGetArg(c,1),i));
+        val = CallElementFunction(c,1,BobTop(c),c->nilValue);
+        if (BobTrueP(c,val)) {
+            BobWriteBarrier(c,c->sp[1],BobTop(c));
+            BobSetVectorElement(c->sp[1],count++,BobTop(c));
+        }
+        BobDrop(c,1);
+    }
+    BobSetVectorSize(BobTop(c),count);
+    return BobPop(c);
+}
+
+/* BIF_Reduce - built-in method 'Reduce' */
+static BobValue BIF_Reduce(BobInterpreter *c)
+{
+    BobValue obj,fun,acc;
+    BobIntegerType i = 0;
+    BobParseArguments(c,"V=*V|V",&obj,&BobVectorDispatch,&fun,&acc);
+
+    /* start with the first element if there is no initial value */
+    if (BobArgCnt(c) < 4) {
+        if (BobVectorSize(obj) == 0)
+            return c->nilValue;
+        acc = BobVectorElement(obj,i++);
+    }
+
+    /* combine the elements */
+    for (; i < BobVectorSize(BobGetArg(c,1)); ++i)
+        acc = CallElementFunction(c,2,acc,BobVectorElement(BobGetArg(c,1),i));
+    return acc;
+}
+
+/* BIF_IndexOf - built-in method 'IndexOf' */
+static BobValue BIF_IndexOf(BobInterpreter *c)
+{
+    BobIntegerType size,i = 0;
+    BobValue obj,val,*p;
+    BobParseArguments(c,"V=*V|l",&obj,&BobVectorDispatch,&val,&i);
+    size = BobVectorSize(obj);
+    p = BobVectorAddress(obj);
+    for (i = i < 0 ? 0 : i; i < size; ++i)
+        if (BobEql(p[i],val))
+            return BobMakeInteger(c,i);
+    return c->nilValue;
+}
+
+/* BIF_Reverse - built-in method 'Reverse' */
+static BobValue BIF_Reverse(BobInterpreter *c)
+{
+    BobValue obj,*p,*q,tmp;
+    BobParseArguments(c,"V=*",&obj,&BobVectorDispatch);
+    p = BobVectorAddress(obj);
+    q = p + BobVectorSize(obj);
+    while (p < --q) {
+        tmp = *p;
+        *p++ = *q;
+        *q = tmp;
+    }
+    return obj;
+}
+
+/* CallElementFunction - call the function passed as the first argument of a vector method */
+static BobValue CallElementFunction(BobInterpreter *c,int argc,BobValue arg1,BobValue arg2)
+{
+    BobCheck(c,argc + 3);
+    BobPush(c,BobGetArg(c,3));
+    BobPush(c,c->nilValue);
+    BobPush(c,c->nilValue);
+    BobPush(c,arg1);
+    if (argc > 1)
+        BobPush(c,arg2);
+    return BobNestedCall(c,argc + 2);
+}
+
 /* BIF_size - built-in property 'size' */
 static BobValue BIF_size(BobInterpreter *c,BobValue obj)
 {
@@ -198,6 +444,7 @@ static int SetVectorProperty(BobInterpreter *c,BobValue obj,BobValue tag,BobValu
                 obj = BobVectorForwardingAddr(obj);
             value = BobPop(c);
         }
+        BobWriteBarrier(c,obj,value);
         BobSetVectorElementI(obj,i,value);
         return TRUE;
     }
@@ -230,6 +477,7 @@ static void VectorScan(BobInterpreter *c,BobValue obj)
 static int GetMovedVectorProperty(BobInterpreter *c,BobValue obj,BobValue tag,BobValue *pValue);
 static int SetMovedVectorProperty(BobInterpreter *c,BobValue obj,BobValue tag,BobValue value);
 static BobValue MovedVectorCopy(BobInterpreter *c,BobValue obj);
+static void MovedVectorScan(BobInterpreter *c,BobValue obj);
 
 /* MovedVector dispatch */
 BobDispatch BobMovedVectorDispatch = {
@@ -241,7 +489,7 @@ BobDispatch BobMovedVectorDispatch = {
     BobDefaultPrint,
     VectorSize,
     MovedVectorCopy,
-    BobDefaultScan,
+    MovedVectorScan,
     BobDefaultHash
 };
 
@@ -266,21 +514,35 @@ static int SetMovedVectorProperty(BobInterpreter *c,BobValue obj,BobValue tag,Bo
                 resizedVector = BobVectorForwardingAddr(resizedVector);
             value = BobPop(c);
         }
+        BobWriteBarrier(c,resizedVector,value);
         BobSetVectorElementI(resizedVector,i,value);
         return TRUE;
     }
     return BobSetVirtualProperty(c,obj,c->vectorObject,tag,value);
 }
 
-/* MovedVectorCopy - MovedVector scan handler */
+/* MovedVectorCopy - MovedVector copy handler */
 static BobValue MovedVectorCopy(BobInterpreter *c,BobValue obj)
 {
-    BobValue newObj = BobCopyValue(c,BobVectorForwardingAddr(obj));
+    BobValue newObj;
+
+    /* an older moved vector is kept when a region is collected */
+    if (!BobOldObjectP(c,obj))
+        return obj;
+
+    /* refer to the new vector instead */
+    newObj = BobCopyValue(c,BobVectorForwardingAddr(obj));
     BobSetDispatch(obj,&BobBrokenHeartDispatch);
     BobBrokenHeartSetForwardingAddr(obj,newObj);
     return newObj;
 }
 
+/* MovedVectorScan - MovedVector scan handler */
+static void MovedVectorScan(BobInterpreter *c,BobValue obj)
+{
+    BobSetVectorForwardingAddr(obj,BobCopyValue(c,BobVectorForwardingAddr(obj)));
+}
+
 /* BobMakeFixedVectorValue - make a new vector value */
 BobValue BobMakeFixedVectorValue(BobInterpreter *c,BobDispatch *type,int size)
 {
@@ -330,7 +592,8 @@ BobValue BobMakeVector(BobInterpreter *c,BobIntegerType size)
     BobSetDispatch(new,&BobVectorDispatch);
     BobSetVectorSize(new,size);
     BobSetVectorMaxSize(new,size);
-    p = BobVectorAddress(new);
+    BobSetVectorStart(new,0);
+    p = BobVectorAddressI(new);
     while (--size >= 0)
         *p++ = c->nilValue;
     return new;
@@ -341,10 +604,15 @@ BobValue BobCloneVector(BobInterpreter *c,BobValue obj)
 {
     BobIntegerType size = BobVectorSize(obj);
     long allocSize = sizeof(BobVector) + size * sizeof(BobValue);
-    BobValue *src,*dst,new = BobAllocate(c,allocSize);
+    BobValue *src,*dst,new;
+    BobCheck(c,1);
+    BobPush(c,obj);
+    new = BobAllocate(c,allocSize);
+    obj = BobPop(c);
     BobSetDispatch(new,&BobVectorDispatch);
     BobSetVectorSize(new,size);
     BobSetVectorMaxSize(new,size);
+    BobSetVectorStart(new,0);
     src = BobVectorAddress(obj);
     dst = BobVectorAddress(new);
     while (--size >= 0)
@@ -368,7 +636,7 @@ static BobValue ResizeVector(BobInterpreter *c,BobValue obj,BobIntegerType newSi
     if ((size = BobVectorSizeI(resizeVector)) != newSize) {
 
         /* check for extra existing space */
-        if (newSize <= BobVectorMaxSize(resizeVector)) {
+        if (newSize <= BobVectorMaxSize(resizeVector) - BobVectorStart(resizeVector)) {
 
             /* fill the extra space with nil */
             if (newSize > size) {
@@ -381,44 +649,24 @@ static BobValue ResizeVector(BobInterpreter *c,BobValue obj,BobIntegerType newSi
             BobSetVectorSize(resizeVector,newSize);
         }
 
+        /* move the elements to the front if PopFront has left enough space there */
+        else if (BobVectorStart(resizeVector) >= size / BobVectorExpandDivisor
+             &&  newSize <= BobVectorMaxSize(resizeVector)) {
+            BobValue *base = BobVectorDataAddress(resizeVector),*dst;
+            memmove(base,BobVectorAddressI(resizeVector),size * sizeof(BobValue));
+            for (dst = base + size; dst < base + newSize; )
+                *dst++ = c->nilValue;
+            BobSetVectorStart(resizeVector,0);
+            BobSetVectorSize(resizeVector,newSize);
+        }
+
         /* expand the vector */
         else {
-            BobValue newVector,*src,*dst;
-            BobIntegerType allocSize;
-
-            /* try expanding by a fraction of the current size */
-            allocSize = size / BobVectorExpandDivisor;
-
-            /* but make sure we expand by at least BobVectorExpandMinimum */
-            if (allocSize < BobVectorExpandMinimum)
-                allocSize = BobVectorExpandMinimum;
-
-            /* and at most BobVectorExpandMaximum */
-            if (allocSize > BobVectorExpandMaximum)
-                allocSize = BobVectorExpandMaximum;
-
-            /* but at least what we need */
-            if ((allocSize += size) < newSize)
+            BobIntegerType allocSize = size + ExpandAmount(size);
+            if (allocSize < newSize)
                 allocSize = newSize;
-
-            /* make a new vector */
-            BobCheck(c,2);
-            BobPush(c,obj);
-            BobPush(c,resizeVector);
-            newVector = BobMakeVector(c,allocSize);
-            BobSetVectorSize(newVector,newSize);
-            resizeVector = BobPop(c);
-            obj = BobPop(c);
-
-            /* copy the data from the old to the new vector */
-            src = BobVectorAddress(resizeVector);
-            dst = BobVectorAddress(newVector);
-            while (--size >= 0)
-                *dst++ = *src++;
-
-            /* set the forwarding address of the old vector */
-            BobSetDispatch(obj,&BobMovedVectorDispatch);
-            BobSetVectorForwardingAddr(obj,newVector);
+            obj = ReallocateVector(c,obj,allocSize,0);
+            BobSetVectorSize(BobVectorForwardingAddr(obj),newSize);
         }
     }
 
@@ -426,6 +674,42 @@ static BobValue ResizeVector(BobInterpreter *c,BobValue obj,BobIntegerType newSi
     return obj;
 }
 
+/* ReallocateVector - move the elements of a vector to a new vector */
+static BobValue ReallocateVector(BobInterpreter *c,BobValue obj,BobIntegerType maxSize,BobIntegerType start)
+{
+    BobValue resizeVector,newVector,*src,*dst;
+    BobIntegerType size;
+
+    /* make a new vector */
+    BobCheck(c,1);
+    BobPush(c,obj);
+    newVector = BobMakeVector(c,maxSize);
+    obj = BobPop(c);
+    resizeVector = BobMovedVectorP(obj) ? BobVectorForwardingAddr(obj) : obj;
+    size = BobVectorSizeI(resizeVector);
+    BobSetVectorStart(newVector,start);
+    BobSetVectorSize(newVector,size);
+
+    /* copy the data from the old to the new vector */
+    src = BobVectorAddressI(resizeVector);
+    dst = BobVectorAddressI(newVector);
+    while (--size >= 0)
+        *dst++ = *src++;
+
+    /* set the forwarding address of the old vector */
+    BobSetDispatch(obj,&BobMovedVectorDispatch);
+    BobWriteBarrier(c,obj,newVector);
+    BobSetVectorForwardingAddr(obj,newVector);
+    return obj;
+}
+
+/* ExpandAmount - compute the number of elements to add when expanding a vector */
+static BobIntegerType ExpandAmount(BobIntegerType size)
+{
+    BobIntegerType amount = size / BobVectorExpandDivisor;
+    return amount < BobVectorExpandMinimum ? BobVectorExpandMinimum : amount;
+}
+
 /* BobVectorSize - get the size of a vector */
 BobIntegerType BobVectorSize(BobValue obj)
 {
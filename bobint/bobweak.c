@@ -0,0 +1,471 @@
+/* bobweak.c - 'WeakRef' and 'WeakTable' handlers */
+/*
+        Copyright (c) 2001, by David Michael Betz
+        All rights reserved
+*/
+
+/*
+    A weak reference doesn't keep its target alive.  When the target is
+    collected the reference is cleared to nil.
+
+    A weak table is an identity hash table whose entries are ephemerons.
+    The value of an entry is kept alive only as long as its key is
+    reachable from somewhere other than the table.  When the key is
+    collected the whole entry is removed.
+
+    The collector doesn't copy the targets of weak references or the keys
+    and values of weak tables when it scans them.  Instead it links the
+    weak objects it finds into lists.  Each time the scan catches up with
+    the allocation pointer BobTraceWeakTables copies the values of the
+    entries whose keys have been copied since that can make more keys
+    reachable.  When nothing more is copied BobClearWeakObjects clears the
+    references and entries whose referents weren't copied.
+
+    Keys are hashed by address so a table is rehashed the first time it's
+    used after each collection.
+*/
+
+#include "bob.h"
+
+/* weak reference structure */
+typedef struct {
+    BobCObject hdr;
+    BobValue target;                /* the referenced object */
+    BobValue nextWeak;              /* next weak reference found by the collector */
+} WeakRef;
+
+#define WeakRefTarget(o)            (((WeakRef *)o)->target)
+#define SetWeakRefTarget(o,v)       (((WeakRef *)o)->target = (v))
+#define WeakRefNext(o)              (((WeakRef *)o)->nextWeak)
+#define SetWeakRefNext(o,v)         (((WeakRef *)o)->nextWeak = (v))
+
+/* weak table structure */
+typedef struct {
+    BobCObject hdr;
+    BobValue entries;               /* key/value pairs */
+    BobValue nextWeak;              /* next weak table found by the collector */
+    BobIntegerType count;           /* number of entries */
+    BobIntegerType rehashP;         /* keys have moved since the table was hashed */
+} WeakTable;
+
+#define WeakTableEntries(o)         (((WeakTable *)o)->entries)
+#define SetWeakTableEntries(o,v)    (((WeakTable *)o)->entries = (v))
+#define WeakTableNext(o)            (((WeakTable *)o)->nextWeak)
+#define SetWeakTableNext(o,v)       (((WeakTable *)o)->nextWeak = (v))
+#define WeakTableCount(o)           (((WeakTable *)o)->count)
+#define SetWeakTableCount(o,v)      (((WeakTable *)o)->count = (v))
+#define WeakTableRehashP(o)         (((WeakTable *)o)->rehashP)
+#define SetWeakTableRehashP(o,v)    (((WeakTable *)o)->rehashP = (v))
+#define WeakTableCapacity(o)        (BobBasicVectorSize(WeakTableEntries(o)) / 2)
+
+/* initial number of entries in a weak table (power of 2) */
+#define WeakTableInitialSize        8
+
+/* 'WeakRef' and 'WeakTable' dispatches */
+BobDispatch *BobWeakRefDispatch = NULL;
+BobDispatch *BobWeakTableDispatch = NULL;
+
+/* WeakRef methods */
+static BobValue BIF_WeakRefInitialize(BobInterpreter *c);
+static BobValue BIF_WeakRefGet(BobInterpreter *c);
+static BobValue BIF_WeakRefSet(BobInterpreter *c);
+
+static BobCMethod weakRefMethods[] = {
+BobMethodEntry( "initialize",       BIF_WeakRefInitialize   ),
+BobMethodEntry( "Get",              BIF_WeakRefGet          ),
+BobMethodEntry( "Set",              BIF_WeakRefSet          ),
+BobMethodEntry(	0,                  0                       )
+};
+
+/* WeakTable methods */
+static BobValue BIF_WeakTableInitialize(BobInterpreter *c);
+static BobValue BIF_WeakTableGet(BobInterpreter *c);
+static BobValue BIF_WeakTablePut(BobInterpreter *c);
+static BobValue BIF_WeakTableRemove(BobInterpreter *c);
+static BobValue BIF_WeakTableExists(BobInterpreter *c);
+
+static BobCMethod weakTableMethods[] = {
+BobMethodEntry( "initialize",       BIF_WeakTableInitialize ),
+BobMethodEntry( "Get",              BIF_WeakTableGet        ),
+BobMethodEntry( "Put",              BIF_WeakTablePut        ),
+BobMethodEntry( "Remove",           BIF_WeakTableRemove     ),
+BobMethodEntry( "Exists",           BIF_WeakTableExists     ),
+BobMethodEntry(	0,                  0                       )
+};
+
+/* WeakTable properties */
+static BobValue BIF_size(BobInterpreter *c,BobValue obj);
+
+static BobVPMethod weakTableProperties[] = {
+BobVPMethodEntry( "size",           BIF_size,           0                   ),
+BobVPMethodEntry( 0,                0,					0					)
+};
+
+/* prototypes */
+static BobValue WeakRefNewInstance(BobInterpreter *c,BobValue parent);
+static void WeakRefScan(BobInterpreter *c,BobValue obj);
+static BobValue WeakTableNewInstance(BobInterpreter *c,BobValue parent);
+static void WeakTableScan(BobInterpreter *c,BobValue obj);
+static void WeakEntriesScan(BobInterpreter *c,BobValue obj);
+static BobValue PrepareTable(BobInterpreter *c,BobValue table,BobValue *pKey,int growP);
+static BobValue *FindEntry(BobValue table,BobValue key,BobValue nilValue);
+static void RemoveEntry(BobValue table,BobValue *p,BobValue nilValue);
+static unsigned long KeyHash(BobValue key);
+
+/* WeakEntries dispatch */
+static BobDispatch WeakEntriesDispatch = {
+    "WeakEntries",
+    &WeakEntriesDispatch,
+    BobDefaultGetProperty,
+    BobDefaultSetProperty,
+    BobDefaultNewInstance,
+    BobDefaultPrint,
+    BobBasicVectorSizeHandler,
+    BobDefaultCopy,
+    WeakEntriesScan,
+    BobDefaultHash
+};
+
+/* BobInitWeak - initialize the 'WeakRef' and 'WeakTable' objects */
+void BobInitWeak(BobInterpreter *c)
+{
+    /* create the 'WeakRef' type */
+    if (!(BobWeakRefDispatch = BobEnterCObjectType(c,NULL,"WeakRef",weakRefMethods,NULL,
+                                                   sizeof(WeakRef) - sizeof(BobCObject))))
+        BobInsufficientMemory(c);
+    BobWeakRefDispatch->newInstance = WeakRefNewInstance;
+    BobWeakRefDispatch->scan = WeakRefScan;
+
+    /* create the 'WeakTable' type */
+    if (!(BobWeakTableDispatch = BobEnterCObjectType(c,NULL,"WeakTable",weakTableMethods,weakTableProperties,
+                                                     sizeof(WeakTable) - sizeof(BobCObject))))
+        BobInsufficientMemory(c);
+    BobWeakTableDispatch->newInstance = WeakTableNewInstance;
+    BobWeakTableDispatch->scan = WeakTableScan;
+}
+
+/* WEAK REFERENCE */
+
+/* WeakRefNewInstance - WeakRef new instance handler */
+static BobValue WeakRefNewInstance(BobInterpreter *c,BobValue parent)
+{
+    BobValue obj = BobMakeCObject(c,BobWeakRefDispatch);
+    SetWeakRefTarget(obj,c->nilValue);
+    SetWeakRefNext(obj,NULL);
+    return obj;
+}
+
+/* WeakRefScan - WeakRef scan handler */
+static void WeakRefScan(BobInterpreter *c,BobValue obj)
+{
+    BobCObjectDispatch.scan(c,obj);
+    if (c->heapVisitor)
+        SetWeakRefTarget(obj,BobCopyValue(c,WeakRefTarget(obj)));
+    else {
+        SetWeakRefNext(obj,c->weakRefs);
+        c->weakRefs = obj;
+    }
+}
+
+/* BIF_WeakRefInitialize - built-in method 'initialize' */
+static BobValue BIF_WeakRefInitialize(BobInterpreter *c)
+{
+    BobValue obj,target = c->nilValue;
+    BobParseArguments(c,"V=*|V",&obj,BobWeakRefDispatch,&target);
+    BobWriteBarrier(c,obj,target);
+    SetWeakRefTarget(obj,target);
+    return obj;
+}
+
+/* BIF_WeakRefGet - built-in method 'Get' */
+static BobValue BIF_WeakRefGet(BobInterpreter *c)
+{
+    BobValue obj;
+    BobParseArguments(c,"V=*",&obj,BobWeakRefDispatch);
+    return WeakRefTarget(obj);
+}
+
+/* BIF_WeakRefSet - built-in method 'Set' */
+static BobValue BIF_WeakRefSet(BobInterpreter *c)
+{
+    BobValue obj,target;
+    BobParseArguments(c,"V=*V",&obj,BobWeakRefDispatch,&target);
+    BobWriteBarrier(c,obj,target);
+    SetWeakRefTarget(obj,target);
+    return target;
+}
+
+/* WEAK TABLE */
+
+/* WeakTableNewInstance - WeakTable new instance handler */
+static BobValue WeakTableNewInstance(BobInterpreter *c,BobValue parent)
+{
+    BobValue obj = BobMakeCObject(c,BobWeakTableDispatch);
+    SetWeakTableEntries(obj,c->nilValue);
+    SetWeakTableNext(obj,NULL);
+    SetWeakTableCount(obj,0);
+    SetWeakTableRehashP(obj,FALSE);
+    return obj;
+}
+
+/* WeakTableScan - WeakTable scan handler */
+static void WeakTableScan(BobInterpreter *c,BobValue obj)
+{
+    BobValue entries;
+    BobIntegerType i;
+
+    /* copy the object and the entry vector */
+    BobCObjectDispatch.scan(c,obj);
+    SetWeakTableEntries(obj,BobCopyValue(c,WeakTableEntries(obj)));
+    if (c->heapVisitor)
+        return;
+
+    /* add the table to the list for BobTraceWeakTables */
+    SetWeakTableNext(obj,c->weakTables);
+    c->weakTables = obj;
+
+    /* keys that don't move (integers and frozen objects) are strong */
+    entries = WeakTableEntries(obj);
+    if (entries != c->nilValue) {
+        BobValue *p = BobBasicVectorAddress(entries);
+        for (i = BobBasicVectorSize(entries); (i -= 2) >= 0; p += 2)
+            if (!BobOldObjectP(c,p[0]))
+                p[1] = BobCopyValue(c,p[1]);
+    }
+}
+
+/* WeakEntriesScan - WeakEntries scan handler */
+static void WeakEntriesScan(BobInterpreter *c,BobValue obj)
+{
+    /* the entries are only handled by the weak table when collecting */
+    if (c->heapVisitor)
+        BobBasicVectorScanHandler(c,obj);
+}
+
+/* BobTraceWeakTables - copy the values of weak table entries with reachable keys */
+void BobTraceWeakTables(BobInterpreter *c)
+{
+    BobValue table,entries,key;
+    BobIntegerType i;
+    for (table = c->weakTables; table != NULL; table = WeakTableNext(table)) {
+        entries = WeakTableEntries(table);
+        if (entries != c->nilValue) {
+            BobValue *p = BobBasicVectorAddress(entries);
+            for (i = BobBasicVectorSize(entries); (i -= 2) >= 0; p += 2) {
+                key = p[0];
+                if (BobOldObjectP(c,key) && BobBrokenHeartP(key)) {
+                    p[0] = BobBrokenHeartForwardingAddr(key);
+                    p[1] = BobCopyValue(c,p[1]);
+                }
+            }
+        }
+    }
+}
+
+/* BobClearWeakObjects - clear weak references to objects that weren't copied */
+void BobClearWeakObjects(BobInterpreter *c)
+{
+    BobValue obj,next,target,entries;
+    BobIntegerType i;
+
+    /* clear the weak references */
+    for (obj = c->weakRefs; obj != NULL; obj = next) {
+        next = WeakRefNext(obj);
+        target = WeakRefTarget(obj);
+        if (BobOldObjectP(c,target))
+            SetWeakRefTarget(obj,BobBrokenHeartP(target) ? BobBrokenHeartForwardingAddr(target) : c->nilValue);
+        SetWeakRefNext(obj,NULL);
+    }
+    c->weakRefs = NULL;
+
+    /* remove the entries with unreachable keys from the weak tables */
+    for (obj = c->weakTables; obj != NULL; obj = next) {
+        next = WeakTableNext(obj);
+        entries = WeakTableEntries(obj);
+        if (entries != c->nilValue) {
+            BobValue *p = BobBasicVectorAddress(entries);
+            for (i = BobBasicVectorSize(entries); (i -= 2) >= 0; p += 2) {
+                if (BobOldObjectP(c,p[0])) {
+                    p[0] = c->nilValue;
+                    p[1] = c->nilValue;
+                    SetWeakTableCount(obj,WeakTableCount(obj) - 1);
+                }
+            }
+            SetWeakTableRehashP(obj,TRUE);
+        }
+        SetWeakTableNext(obj,NULL);
+    }
+    c->weakTables = NULL;
+}
+
+/* BIF_WeakTableInitialize - built-in method 'initialize' */
+static BobValue BIF_WeakTableInitialize(BobInterpreter *c)
+{
+    BobIntegerType capacity = WeakTableInitialSize;
+    BobValue obj,entries;
+    long size = 0;
+    BobParseArguments(c,"V=*|l",&obj,BobWeakTableDispatch,&size);
+    while (capacity < size * 2)
+        capacity *= 2;
+    BobCPush(c,obj);
+    entries = BobMakeBasicVector(c,&WeakEntriesDispatch,capacity * 2);
+    obj = BobPop(c);
+    BobWriteBarrier(c,obj,entries);
+    SetWeakTableEntries(obj,entries);
+    SetWeakTableCount(obj,0);
+    return obj;
+}
+
+/* BIF_WeakTableGet - built-in method 'Get' */
+static BobValue BIF_WeakTableGet(BobInterpreter *c)
+{
+    BobValue table,key,*p;
+    BobParseArguments(c,"V=*V",&table,BobWeakTableDispatch,&key);
+    table = PrepareTable(c,table,&key,FALSE);
+    if (WeakTableEntries(table) == c->nilValue || key == c->nilValue)
+        return c->nilValue;
+    p = FindEntry(table,key,c->nilValue);
+    return p[1];
+}
+
+/* BIF_WeakTablePut - built-in method 'Put' */
+static BobValue BIF_WeakTablePut(BobInterpreter *c)
+{
+    BobValue table,key,value,*p;
+    BobParseArguments(c,"V=*VV",&table,BobWeakTableDispatch,&key,&value);
+    if (key == c->nilValue)
+        BobTypeError(c,key);
+    BobCPush(c,value);
+    table = PrepareTable(c,table,&key,TRUE);
+    value = BobPop(c);
+    p = FindEntry(table,key,c->nilValue);
+    BobWriteBarrier(c,WeakTableEntries(table),key);
+    BobWriteBarrier(c,WeakTableEntries(table),value);
+    if (p[0] == c->nilValue) {
+        p[0] = key;
+        SetWeakTableCount(table,WeakTableCount(table) + 1);
+    }
+    p[1] = value;
+    return value;
+}
+
+/* BIF_WeakTableRemove - built-in method 'Remove' */
+static BobValue BIF_WeakTableRemove(BobInterpreter *c)
+{
+    BobValue table,key,*p;
+    BobParseArguments(c,"V=*V",&table,BobWeakTableDispatch,&key);
+    table = PrepareTable(c,table,&key,FALSE);
+    if (WeakTableEntries(table) == c->nilValue || key == c->nilValue)
+        return c->falseValue;
+    p = FindEntry(table,key,c->nilValue);
+    if (p[0] == c->nilValue)
+        return c->falseValue;
+    RemoveEntry(table,p,c->nilValue);
+    return c->trueValue;
+}
+
+/* BIF_WeakTableExists - built-in method 'Exists' */
+static BobValue BIF_WeakTableExists(BobInterpreter *c)
+{
+    BobValue table,key;
+    BobParseArguments(c,"V=*V",&table,BobWeakTableDispatch,&key);
+    table = PrepareTable(c,table,&key,FALSE);
+    if (WeakTableEntries(table) == c->nilValue || key == c->nilValue)
+        return c->falseValue;
+    return BobToBoolean(c,FindEntry(table,key,c->nilValue)[0] != c->nilValue);
+}
+
+/* BIF_size - built-in property 'size' */
+static BobValue BIF_size(BobInterpreter *c,BobValue obj)
+{
+    return BobMakeInteger(c,WeakTableCount(obj));
+}
+
+/* PrepareTable - rehash or grow a table before it is used */
+static BobValue PrepareTable(BobInterpreter *c,BobValue table,BobValue *pKey,int growP)
+{
+    BobValue entries = WeakTableEntries(table),newEntries,*p;
+    BobIntegerType capacity,i;
+
+    /* find the new capacity */
+    if (entries == c->nilValue) {
+        if (!growP)
+            return table;
+        capacity = WeakTableInitialSize;
+    }
+    else {
+        capacity = WeakTableCapacity(table);
+        if (growP && (WeakTableCount(table) + 1) * 2 > capacity)
+            capacity *= 2;
+        else if (!WeakTableRehashP(table))
+            return table;
+    }
+
+    /* make the new entry vector */
+    BobCheck(c,2);
+    BobPush(c,table);
+    BobPush(c,*pKey);
+    newEntries = BobMakeBasicVector(c,&WeakEntriesDispatch,capacity * 2);
+    *pKey = BobPop(c);
+    table = BobPop(c);
+
+    /* move the entries to the new vector */
+    entries = WeakTableEntries(table);
+    BobWriteBarrier(c,table,newEntries);
+    SetWeakTableEntries(table,newEntries);
+    SetWeakTableRehashP(table,FALSE);
+    if (entries != c->nilValue) {
+        BobValue *q = BobBasicVectorAddress(entries);
+        for (i = BobBasicVectorSize(entries); (i -= 2) >= 0; q += 2) {
+            if (q[0] != c->nilValue) {
+                p = FindEntry(table,q[0],c->nilValue);
+                p[0] = q[0];
+                p[1] = q[1];
+            }
+        }
+    }
+    return table;
+}
+
+/* FindEntry - find the entry for a key or the empty entry where it belongs */
+static BobValue *FindEntry(BobValue table,BobValue key,BobValue nilValue)
+{
+    BobValue *entries = BobBasicVectorAddress(WeakTableEntries(table));
+    unsigned long mask = (unsigned long)WeakTableCapacity(table) - 1;
+    unsigned long i = KeyHash(key) & mask;
+    while (entries[i * 2] != key && entries[i * 2] != nilValue)
+        i = (i + 1) & mask;
+    return &entries[i * 2];
+}
+
+/* RemoveEntry - remove an entry shifting back the entries that follow it */
+static void RemoveEntry(BobValue table,BobValue *p,BobValue nilValue)
+{
+    BobValue *entries = BobBasicVectorAddress(WeakTableEntries(table));
+    unsigned long mask = (unsigned long)WeakTableCapacity(table) - 1;
+    unsigned long i = (p - entries) / 2,j = i,home;
+    for (;;) {
+        j = (j + 1) & mask;
+        if (entries[j * 2] == nilValue)
+            break;
+        home = KeyHash(entries[j * 2]) & mask;
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            entries[i * 2] = entries[j * 2];
+            entries[i * 2 + 1] = entries[j * 2 + 1];
+            i = j;
+        }
+    }
+    entries[i * 2] = nilValue;
+    entries[i * 2 + 1] = nilValue;
+    SetWeakTableCount(table,WeakTableCount(table) - 1);
+}
+
+/* KeyHash - compute the identity hash of a key */
+static unsigned long KeyHash(BobValue key)
+{
+    unsigned long h = (unsigned long)(BobPointerType)key;
+    h ^= h >> 16;
+    h *= 0x45d9f3bUL;
+    h ^= h >> 16;
+    return h;
+}
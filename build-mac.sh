@@ -1,2 +1,2 @@
 make clean
-make XCFLAGS=-m32
+make
@@ -10,6 +10,7 @@
 #include <stdio.h>
 #include <stdarg.h>
 #include <setjmp.h>
+#include <limits.h>
 
 /* boolean values */
 #ifndef TRUE
@@ -28,6 +29,7 @@
 
 /* symbol hash table size */
 #define BobSymbolHashTableSize      256         /* power of 2 */
+#define BobSymbolTableExpandThreshold 1         /* symbols per bucket */
 
 /* hash table thresholds */
 #define BobHashTableCreateThreshold 4           /* power of 2 */
@@ -36,15 +38,32 @@
 
 /* vector expansion thresholds */
 /* amount to expand is:
-    min(neededSize,
-        min(BobVectorExpandMaximum,
-            max(BobVectorExpandMinimum,
-                currentSize / BobVectorExpandDivisor)))
+    max(neededSize - currentSize,
+        max(BobVectorExpandMinimum,
+            currentSize / BobVectorExpandDivisor))
+   the same amount of space is left at the front of a vector when
+   PushFront expands it
 */
 #define BobVectorExpandMinimum      8
-#define BobVectorExpandMaximum      128
 #define BobVectorExpandDivisor      2
 
+/* default hard limit on the size of the stack (in values) */
+#define BobDefaultStackLimit        (1024 * 1024)
+
+/* heap snapshot version number and record tags */
+#define BobSnapshotVersion  1
+#define BobSnapTagEnd       0
+#define BobSnapTagType      1
+#define BobSnapTagRoot      2
+#define BobSnapTagObject    3
+
+/* heap image version */
+#define BobImageVersion     5
+
+/* allocation profiler defaults */
+#define BobProfileInterval          4096        /* bytes between samples */
+#define BobProfileDepth             8           /* stack frames recorded per sample */
+
 /* object file tags */
 #define BobFaslTagNil       0
 #define BobFaslTagCode      1
@@ -58,6 +77,7 @@
 /* basic types */
 typedef struct BobHeader *BobValue;
 typedef long BobIntegerType;
+#define BobIntegerMax   LONG_MAX    /* largest BobIntegerType value */
 typedef double BobFloatType;
 
 /* pointer sized integer */
@@ -84,6 +104,7 @@ typedef struct BobStreamDispatch BobStreamDispatch;
 typedef struct BobFrame BobFrame;
 typedef struct BobCMethod BobCMethod;
 typedef struct BobVPMethod BobVPMethod;
+typedef struct BobAllocProfile BobAllocProfile;
 
 /*  boolean macros */
 #define BobToBoolean(c,v) ((v) ? (c)->trueValue : (c)->falseValue)
@@ -96,15 +117,34 @@ typedef struct BobVPMethod BobVPMethod;
 /* round a size up to a multiple of the size of a long */
 #define BobRoundSize(x)   (((x) + BobValueMask) & ~BobValueMask)
 
+/* number of handles in a handle block */
+#define BobHandleBlockSize  256
+
+/* handle block structure */
+typedef struct BobHandleBlock BobHandleBlock;
+struct BobHandleBlock {
+    BobHandleBlock *next;
+    BobValue handles[BobHandleBlockSize];
+};
+
+/* handle scope structure */
+typedef struct {
+    BobHandleBlock *block;          /* current block when the scope was opened */
+    BobValue *next;                 /* next free handle when the scope was opened */
+} BobHandleScope;
+
 /* unwind target structure */
 typedef struct BobUnwindTarget BobUnwindTarget;
 struct BobUnwindTarget {
     BobUnwindTarget *next;
+    BobHandleScope handles;         /* handles made before the target was pushed */
     jmp_buf target;
 };
 
+/* unwinding releases the handles made after the target was pushed */
 #define BobUnwindCatch(c)       setjmp((c)->unwindTarget->target)
-#define BobUnwind(c,v)          longjmp((c)->unwindTarget->target,(v))
+#define BobUnwind(c,v)          (BobCloseHandleScope((c),&(c)->unwindTarget->handles), \
+                                 longjmp((c)->unwindTarget->target,(v)))
 #define BobPopUnwindTarget(c)   ((c)->unwindTarget = (c)->unwindTarget->next)
 
 /* memory space structure */
@@ -113,7 +153,54 @@ struct BobMemorySpace {
     unsigned char *base;
     unsigned char *free;
     unsigned char *top;
-    BobValue cObjects;
+    BobValue cObjects;              /* cobjects with destroy handlers */
+};
+
+/* garbage collector statistics structure (times are in microseconds) */
+typedef struct BobGCStats BobGCStats;
+struct BobGCStats {
+    unsigned long heapSize;         /* size of a semi-space */
+    unsigned long usedBefore;       /* bytes in use before the last collection */
+    unsigned long usedAfter;        /* bytes in use after the last collection */
+    unsigned long allocated;        /* bytes allocated between the last two collections */
+    unsigned long mutatorTime;      /* time between the last two collections */
+    unsigned long pauseTime;        /* duration of the last collection */
+    unsigned long totalPauseTime;   /* total time spent collecting */
+    unsigned long totalCopied;      /* total bytes copied by all collections */
+    unsigned long endTime;          /* time the last collection finished */
+};
+
+/* garbage collector events */
+#define BobGCEventStart     1       /* a collection is about to start */
+#define BobGCEventEnd       2       /* a collection has finished */
+
+/* garbage collector event handler */
+typedef void BobGCHandler(BobInterpreter *c,int event,BobGCStats *stats,void *data);
+
+/* heap visitor structure */
+typedef struct BobHeapVisitor BobHeapVisitor;
+struct BobHeapVisitor {
+    BobValue (*visit)(BobInterpreter *c,BobHeapVisitor *v,BobValue obj);
+    int rootKind;                   /* root set being visited */
+};
+
+/* root sets */
+#define BobRootInterpreter  1       /* registers and built-in objects */
+#define BobRootTypes        2       /* type list */
+#define BobRootProtected    3       /* protected pointers */
+#define BobRootStack        4       /* stack */
+#define BobRootUser         5       /* values copied by the protect handler */
+#define BobRootProfile      6       /* allocation profile */
+#define BobRootFrozen       7       /* frozen compiled code */
+#define BobRootHandles      8       /* handles */
+
+/* frozen code segment structure */
+typedef struct BobCodeSegment BobCodeSegment;
+struct BobCodeSegment {
+    BobCodeSegment *next;           /* next segment */
+    unsigned char *base;            /* start of the pointer-free objects */
+    unsigned char *code;            /* start of the compiled code objects */
+    unsigned char *free;            /* end of the objects */
 };
 
 /* number of pointers in a protected pointer block */
@@ -127,6 +214,19 @@ struct BobProtectedPtrs {
     int count;
 };
 
+/* allocation region structure */
+typedef struct BobRegion BobRegion;
+struct BobRegion {
+    BobRegion *prev;                /* enclosing region */
+    unsigned char *mark;            /* end of the heap when the region was opened */
+};
+
+/* every store of a value into a heap object that may be older than the
+   innermost open region goes through the write barrier (see bobregion.c),
+   and BobWriteBarrierAll covers moving values from one object to another */
+#define BobWriteBarrier(c,o,v)          ((c)->regions ? BobRememberStore(c,o,v) : (void)0)
+#define BobWriteBarrierAll(c,o)         ((c)->regions ? BobRememberObject(c,o) : (void)0)
+
 /* cmethod handler */
 typedef BobValue BobCMethodHandler(BobInterpreter *c);
 
@@ -147,6 +247,8 @@ struct BobInterpreter {
     int argc;                       /* argument count for current function */
     BobValue *stack;                /* stack base */
     BobValue *stackTop;             /* stack top */
+    BobValue *stackMemory;          /* stack allocated by BobExpandStack */
+    size_t stackLimit;              /* maximum stack size (in values) */
     BobValue *sp;                   /* stack pointer */
     BobFrame *fp;                   /* frame pointer */
     BobValue code;                  /* code object */
@@ -164,12 +266,36 @@ struct BobInterpreter {
     BobValue stringObject;          /* object for the String type */
     BobValue integerObject;         /* object for the Integer type */
     BobValue floatObject;           /* object for the Float type */
+    BobValue regexCache;            /* recently compiled regular expressions */
     BobValue symbols;               /* symbol table */
+    long symbolCount;               /* number of symbols in the symbol table */
     void (*errorHandler)(BobInterpreter *c,int code,va_list ap);
     BobProtectedPtrs *protectedPtrs;/* protected pointers */
+    BobHandleBlock *handleBlocks;   /* handle blocks */
+    BobHandleBlock *handleBlock;    /* current handle block */
+    BobValue *handleNext;           /* next free handle */
+    BobValue *handleLimit;          /* end of the current handle block */
     BobMemorySpace *oldSpace;       /* old memory space */
     BobMemorySpace *newSpace;       /* new memory space */
+    BobCodeSegment *codeSegments;   /* frozen code segments */
+    BobRegion *regions;             /* open allocation regions */
+    BobValue *remembered;           /* older objects given references to region objects */
+    long rememberedSize;            /* size of the remembered set */
+    long rememberedCount;           /* number of remembered objects */
+    int rememberedOverflowP;        /* the remembered set couldn't be expanded */
+    long sliceBudget;               /* bytes the collector may add by copying string slices */
     unsigned long gcCount;          /* number of garbage collections */
+    BobGCStats gcStats;             /* garbage collector statistics */
+    BobGCHandler *gcHandler;        /* garbage collector event handler */
+    void *gcData;                   /* data for the event handler */
+    int gcMessages;                 /* display garbage collection messages */
+    BobAllocProfile *allocProfile;  /* allocation profile (when profiling) */
+    BobHeapVisitor *heapVisitor;    /* heap visitor (when visiting) */
+    BobValue weakRefs;              /* weak references found while collecting */
+    BobValue weakTables;            /* weak tables found while collecting */
+    unsigned char *finalizeQueue;   /* copies of unreachable cobjects to destroy */
+    long finalizeQueueSize;         /* size of the finalize queue */
+    long finalizeQueueUsed;         /* bytes in use in the finalize queue */
     unsigned long totalMemory;      /* total memory allocated */
     unsigned long allocCount;       /* number of calls to BobAlloc */
     BobStream *standardInput;       /* standard input stream */
@@ -207,14 +333,19 @@ struct BobInterpreter {
 #define BobGetArg(c,n)              ((c)->argv[-(n)])
 
 /* stack manipulation macros */
-#define BobCheck(c,n)   do { if ((c)->sp - (n) < &(c)->stack[0]) BobStackOverflow(c); } while (0)
-#define BobCPush(c,v)   do { if ((c)->sp > &(c)->stack[0]) BobPush(c,v); else BobStackOverflow(c); } while (0)
+#define BobCheck(c,n)   do { if ((c)->sp - (n) < &(c)->stack[0]) BobExpandStack(c,n); } while (0)
+#define BobCPush(c,v)   do { if ((c)->sp <= &(c)->stack[0]) BobExpandStack(c,1); BobPush(c,v); } while (0)
 #define BobPush(c,v)    (*--(c)->sp = (v))
 #define BobTop(c)       (*(c)->sp)
 #define BobSetTop(c,v)  (*(c)->sp = (v))
 #define BobPop(c)       (*(c)->sp++)
 #define BobDrop(c,n)    ((c)->sp += (n))
 
+/* handle macros */
+#define BobMakeHandle(c,v)  ((c)->handleNext < (c)->handleLimit ? \
+                                (*(c)->handleNext = (v), (c)->handleNext++) : \
+                                BobExpandHandles(c,v))
+
 /* destructor type */
 typedef void (BobDestructor)(BobInterpreter *c,void *data,void *ptr);
 
@@ -232,6 +363,9 @@ struct BobDispatch {
     BobIntegerType (*hash)(BobValue obj);
     BobValue object;
     long dataSize;
+    /* an unreachable cobject is passed to its destroy handler as a malloc'd
+       copy, not a heap object, so the handler may only read its value and
+       must not keep the pointer or store it into the heap */
 	void (*destroy)(BobInterpreter *c,BobValue obj);
     BobDispatch *parent;
     BobDispatch *next;
@@ -258,7 +392,7 @@ struct BobHeader {
 #define BobSetProperty(c,o,t,v)         (BobGetDispatch(o)->setProperty(c,o,t,v))
 #define BobNewInstance(c,o)             (BobGetDispatch(o)->newInstance(c,o))
 #define BobPrintValue(c,o,s)            (BobGetDispatch(o)->print(c,o,s))
-#define BobCopyValue(c,o)               (BobGetDispatch(o)->copy(c,o))
+#define BobVisitValue(c,o)              ((*(c)->heapVisitor->visit)(c,(c)->heapVisitor,o))
 #define BobHashValue(o)                 (BobGetDispatch(o)->hash(o))
 
 int BobGetProperty(BobInterpreter *c,BobValue obj,BobValue tag,BobValue *pValue);
@@ -273,6 +407,9 @@ typedef struct {
 #define BobBrokenHeartP(o)                      BobIsType(o,&BobBrokenHeartDispatch)
 #define BobBrokenHeartForwardingAddr(o)         (((BobBrokenHeart *)o)->forwardingAddr)  
 #define BobBrokenHeartSetForwardingAddr(o,v)    (((BobBrokenHeart *)o)->forwardingAddr = (v))  
+#define BobOldObjectP(c,o)                      (BobPointerP(o) && \
+                                                 (unsigned char *)(o) >= (c)->oldSpace->base && \
+                                                 (unsigned char *)(o) < (c)->oldSpace->free)
 extern BobDispatch BobBrokenHeartDispatch;
 
 /* SMALL INTEGER */
@@ -320,18 +457,42 @@ extern BobDispatch BobFloatDispatch;
 typedef struct {
     BobDispatch *dispatch;
     BobIntegerType size;
+    BobIntegerType hash;            /* cached hash value or zero if not computed */
 /*  unsigned char data[0]; */
 } BobString;
 
-#define BobStringP(o)                   BobIsType(o,&BobStringDispatch)
+/* a slice shares the characters of another string */
+typedef struct {
+    BobDispatch *dispatch;
+    BobIntegerType size;
+    BobIntegerType hash;            /* always zero, the characters can change */
+    BobValue string;                /* string holding the characters */
+    BobIntegerType offset;          /* offset of the first character */
+} BobStringSlice;
+
+#define BobStringP(o)                   BobIsBaseType(o,&BobStringDispatch)
+#define BobStringSliceP(o)              BobIsType(o,&BobStringSliceDispatch)
 #define BobStringSize(o)                (((BobString *)o)->size)  
 #define BobSetStringSize(o,v)           (((BobString *)o)->size = (v))
-#define BobStringAddress(o)             ((unsigned char *)o + sizeof(BobString))
+#define BobStringHash(o)                (((BobString *)o)->hash)
+#define BobSetStringHash(o,v)           (((BobString *)o)->hash = (v))
+#define BobStringSliceString(o)         (((BobStringSlice *)o)->string)
+#define BobSetStringSliceString(o,v)    (((BobStringSlice *)o)->string = (v))
+#define BobStringSliceOffset(o)         (((BobStringSlice *)o)->offset)
+#define BobSetStringSliceOffset(o,v)    (((BobStringSlice *)o)->offset = (v))
+#define BobStringInlineAddress(o)       ((unsigned char *)o + sizeof(BobString))
+/* StringSlice is the only type with String as its base type that doesn't hold its characters */
+#define BobStringAddress(o)             (BobQuickIsType(o,&BobStringSliceDispatch) ? \
+                                         BobStringInlineAddress(BobStringSliceString(o)) + BobStringSliceOffset(o) : \
+                                         BobStringInlineAddress(o))
 #define BobStringElement(o,i)           (BobStringAddress(o)[i])  
-#define BobSetStringElement(o,i,v)      (BobStringAddress(o)[i] = (v))  
+#define BobSetStringElement(o,i,v)      (BobSetStringHash(o,0), BobStringAddress(o)[i] = (v))  
 BobValue BobMakeString(BobInterpreter *c,unsigned char *data,BobIntegerType size);
 BobValue BobMakeCString(BobInterpreter *c,char *str);
+BobValue BobMakeStringSlice(BobInterpreter *c,BobValue str,BobIntegerType offset,BobIntegerType size);
+BobValue BobFlattenString(BobInterpreter *c,BobValue str);
 extern BobDispatch BobStringDispatch;
+extern BobDispatch BobStringSliceDispatch;
 
 /* SYMBOL */
 
@@ -353,6 +514,7 @@ typedef struct {
 #define BobSymbolNext(o)                (((BobSymbol *)o)->next)
 #define BobSetSymbolNext(o,v)           (((BobSymbol *)o)->next = (v))
 BobValue BobMakeSymbol(BobInterpreter *c,unsigned char *printName,int length);
+long BobCountSymbols(BobInterpreter *c);
 BobValue BobIntern(BobInterpreter *c,BobValue printName);
 BobValue BobInternCString(BobInterpreter *c,char *printName);
 BobValue BobInternString(BobInterpreter *c,unsigned char *printName,int length);
@@ -416,6 +578,7 @@ extern BobDispatch BobCObjectDispatch;
 typedef struct {
     BobDispatch *dispatch;
     BobIntegerType maxSize;
+    BobIntegerType start;           /* index of the first element */
     union {
         BobIntegerType size;
         BobValue forwardingAddr;
@@ -431,7 +594,10 @@ typedef struct {
 #define BobSetVectorForwardingAddr(o,a) (((BobVector *)o)->d.forwardingAddr = (a))
 #define BobVectorMaxSize(o)             (((BobVector *)o)->maxSize)
 #define BobSetVectorMaxSize(o,s)        (((BobVector *)o)->maxSize = (s))
-#define BobVectorAddressI(o)            ((BobValue *)((char *)o + sizeof(BobVector))) 
+#define BobVectorStart(o)               (((BobVector *)o)->start)
+#define BobSetVectorStart(o,s)          (((BobVector *)o)->start = (s))
+#define BobVectorDataAddress(o)         ((BobValue *)((char *)o + sizeof(BobVector))) 
+#define BobVectorAddressI(o)            (BobVectorDataAddress(o) + BobVectorStart(o))
 #define BobVectorElementI(o,i)          (BobVectorAddress(o)[i])
 #define BobSetVectorElementI(o,i,v)     (BobVectorAddress(o)[i] = (v))
 BobValue BobMakeVector(BobInterpreter *c,BobIntegerType size);
@@ -584,6 +750,49 @@ extern BobDispatch BobMovedEnvironmentDispatch;
 
 extern BobDispatch *BobFileDispatch;
 
+/* WEAK */
+
+#define BobWeakRefP(o)                  BobIsType(o,BobWeakRefDispatch)
+#define BobWeakTableP(o)                BobIsType(o,BobWeakTableDispatch)
+
+extern BobDispatch *BobWeakRefDispatch;
+extern BobDispatch *BobWeakTableDispatch;
+
+/* STRING BUILDER */
+
+#define BobStringBuilderP(o)            BobIsType(o,BobStringBuilderDispatch)
+
+extern BobDispatch *BobStringBuilderDispatch;
+
+/* DICTIONARY */
+
+#define BobDictionaryP(o)               BobIsType(o,BobDictionaryDispatch)
+
+extern BobDispatch *BobDictionaryDispatch;
+
+/* SORTED MAP */
+
+#define BobSortedMapP(o)                BobIsType(o,BobSortedMapDispatch)
+
+extern BobDispatch *BobSortedMapDispatch;
+
+/* REGEX */
+
+#define BobRegexP(o)                    BobIsType(o,BobRegexDispatch)
+
+extern BobDispatch *BobRegexDispatch;
+
+/* NUMERIC ARRAY */
+
+#define BobInt64ArrayP(o)               BobIsType(o,BobInt64ArrayDispatch)
+#define BobFloat64ArrayP(o)             BobIsType(o,BobFloat64ArrayDispatch)
+#define BobByteArrayP(o)                BobIsType(o,BobByteArrayDispatch)
+#define BobNumericArrayP(o)             (BobInt64ArrayP(o) || BobFloat64ArrayP(o) || BobByteArrayP(o))
+
+extern BobDispatch *BobInt64ArrayDispatch;
+extern BobDispatch *BobFloat64ArrayDispatch;
+extern BobDispatch *BobByteArrayDispatch;
+
 /* TYPE */
 
 #define BobTypeDispatch(o)              ((BobDispatch *)BobCObjectValue(o))
@@ -670,6 +879,8 @@ extern BobStream BobNullStream;
 #define BobErrNotAnObjectFile       21
 #define BobErrWrongObjectVersion    22
 #define BobErrValueError            23
+#define BobErrFrozenObject          24
+#define BobErrBadRegex              25
 
 /* compiler error codes */
 #define BobErrSyntaxError       0x1000
@@ -690,6 +901,7 @@ BobValue BobSendMessage(BobInterpreter *c,BobValue obj,BobValue selector,int arg
 BobValue BobSendMessageByName(BobInterpreter *c,BobValue obj,char *sname,int argc,...);
 BobValue BobInternalCall(BobInterpreter *c,int argc);
 BobValue BobInternalSend(BobInterpreter *c,int argc);
+BobValue BobNestedCall(BobInterpreter *c,int argc);
 void BobPushUnwindTarget(BobInterpreter *c,BobUnwindTarget *target);
 void BobPopAndUnwind(BobInterpreter *c,int value);
 void BobTooManyArguments(BobInterpreter *c);
@@ -698,8 +910,11 @@ void BobTypeError(BobInterpreter *c,BobValue v);
 void BobStackOverflow(BobInterpreter *c);
 void BobAbort(BobInterpreter *c);
 int BobEql(BobValue obj1,BobValue obj2);
+int BobCompareObjects(BobInterpreter *c,BobValue obj1,BobValue obj2);
 void BobCopyStack(BobInterpreter *c);
+void BobRelocateStack(BobInterpreter *c,BobValue *oldStack,BobValue *oldTop,BobValue *newTop);
 void BobStackTrace(BobInterpreter *c);
+int BobGetCallStack(BobInterpreter *c,BobValue *codes,int max);
 
 /* bobenter.c prototypes */
 void BobEnterVariable(BobInterpreter *c,char *name,BobValue value);
@@ -721,12 +936,22 @@ void BobParseArguments(BobInterpreter *c,char *fmt,...);
 BobInterpreter *BobMakeInterpreter(void *buf,size_t size,size_t stackSize);
 BobInterpreter *BobInitInterpreter(BobInterpreter *c);
 void BobFreeInterpreter(BobInterpreter *c);
+void BobSetStackLimit(BobInterpreter *c,size_t size);
+void BobExpandStack(BobInterpreter *c,int n);
 void BobCollectGarbage(BobInterpreter *c);
+int BobCollectRegion(BobInterpreter *c,unsigned char *mark);
+BobValue BobCopyValue(BobInterpreter *c,BobValue obj);
+void BobSetGCHandler(BobInterpreter *c,BobGCHandler *handler,void *data);
+void BobVisitRoots(BobInterpreter *c,BobHeapVisitor *v);
+void BobVisitObject(BobInterpreter *c,BobHeapVisitor *v,BobValue obj);
 void BobDumpHeap(BobInterpreter *c);
 BobDispatch *BobMakeDispatch(BobInterpreter *c,char *typeName,BobDispatch *prototype);
 void BobFreeDispatch(BobInterpreter *c,BobDispatch *d);
 int BobProtectPointer(BobInterpreter *c,BobValue *pp);
 int BobUnprotectPointer(BobInterpreter *c,BobValue *pp);
+void BobOpenHandleScope(BobInterpreter *c,BobHandleScope *scope);
+void BobCloseHandleScope(BobInterpreter *c,BobHandleScope *scope);
+BobValue *BobExpandHandles(BobInterpreter *c,BobValue value);
 BobValue BobAllocate(BobInterpreter *c,long size);
 void *BobAlloc(BobInterpreter *c,unsigned long size);
 void BobFree(BobInterpreter *c,void *ptr);
@@ -740,6 +965,32 @@ BobValue BobDefaultCopy(BobInterpreter *c,BobValue obj);
 void BobDefaultScan(BobInterpreter *c,BobValue obj);
 BobIntegerType BobDefaultHash(BobValue obj);
 
+/* bobsnap.c prototypes */
+int BobWriteHeapSnapshot(BobInterpreter *c,BobStream *s);
+
+/* bobregion.c prototypes */
+void BobOpenRegion(BobInterpreter *c,BobRegion *region);
+int BobCloseRegion(BobInterpreter *c,BobRegion *region);
+void BobRememberStore(BobInterpreter *c,BobValue obj,BobValue value);
+void BobRememberObject(BobInterpreter *c,BobValue obj);
+
+/* bobfreeze.c prototypes */
+long BobFreezeCode(BobInterpreter *c);
+int BobFrozenP(BobInterpreter *c,BobValue obj);
+BobCodeSegment *BobMakeCodeSegment(BobInterpreter *c,long size);
+void BobFreeCodeSegments(BobInterpreter *c);
+
+/* bobimage.c prototypes */
+int BobSaveImage(BobInterpreter *c,char *name);
+BobInterpreter *BobLoadImage(BobInterpreter *c,char *name);
+
+/* bobprof.c prototypes */
+int BobStartAllocProfile(BobInterpreter *c,unsigned long interval);
+void BobStopAllocProfile(BobInterpreter *c);
+void BobProfileAllocation(BobInterpreter *c,BobValue obj,long size);
+void BobCopyAllocProfile(BobInterpreter *c);
+void BobDumpAllocProfile(BobInterpreter *c,BobStream *s,int foldedP);
+
 /* bobhash.c prototypes */
 BobIntegerType BobHashString(unsigned char *str,int length);
 
@@ -758,6 +1009,7 @@ BobStream *BobInitStringStream(BobInterpreter *c,BobStringStream *s,unsigned cha
 BobStream *BobMakeStringStream(BobInterpreter *c,unsigned char *buf,long len);
 BobStream *BobInitStringOutputStream(BobInterpreter *c,BobStringOutputStream *s,unsigned char *buf,long len);
 BobStream *BobMakeIndirectStream(BobInterpreter *c,BobStream **pStream);
+BobStream **BobIndirectStreamTarget(BobStream *s);
 BobStream *BobInitFileStream(BobInterpreter *c,BobFileStream *s,FILE *fp);
 BobStream *BobMakeFileStream(BobInterpreter *c,FILE *fp);
 BobStream *BobOpenFileStream(BobInterpreter *c,char *fname,char *mode);
@@ -785,10 +1037,14 @@ void BobBasicVectorScanHandler(BobInterpreter *c,BobValue obj);
 
 /* bobstring.c prototypes */
 void BobInitString(BobInterpreter *c);
+long BobFindBytes(unsigned char *str,long len,unsigned char *pat,long patLen);
+long BobFindLastBytes(unsigned char *str,long len,unsigned char *pat,long patLen);
 
 /* bobcobject.c prototypes */
 void BobDestroyUnreachableCObjects(BobInterpreter *c);
 void BobDestroyAllCObjects(BobInterpreter *c);
+void BobRunFinalizers(BobInterpreter *c);
+BobValue BobTakeRegionCObjects(BobInterpreter *c,unsigned char *mark);
 
 /* bobinteger.c prototypes */
 void BobInitInteger(BobInterpreter *c);
@@ -800,6 +1056,26 @@ void BobInitFloat(BobInterpreter *c);
 void BobInitFile(BobInterpreter *c);
 BobValue BobMakeFile(BobInterpreter *c,BobStream *s);
 
+/* bobweak.c prototypes */
+void BobInitWeak(BobInterpreter *c);
+void BobTraceWeakTables(BobInterpreter *c);
+void BobClearWeakObjects(BobInterpreter *c);
+
+/* bobbuilder.c prototypes */
+void BobInitStringBuilder(BobInterpreter *c);
+
+/* bobdict.c prototypes */
+void BobInitDictionary(BobInterpreter *c);
+
+/* bobarray.c prototypes */
+void BobInitArrays(BobInterpreter *c);
+
+/* bobmap.c prototypes */
+void BobInitSortedMap(BobInterpreter *c);
+
+/* bobregex.c prototypes */
+void BobInitRegex(BobInterpreter *c);
+
 /* bobfcn.c prototypes */
 void BobEnterLibrarySymbols(BobInterpreter *c);
 
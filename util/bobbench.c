@@ -0,0 +1,164 @@
+/* bobbench.c - time parts of the interpreter from a host program */
+/*
+	usage: bobbench symbols | hash
+
+	symbols		time interning names that are already symbols as the
+				symbol table grows from 1000 to 256000 symbols
+	hash		time hashing strings of several lengths and count the
+				keys that share a bucket in tables of several sizes
+
+	Prints one line per measurement.  The times depend on the machine,
+	so 'make test' doesn't run this program.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "bob.h"
+
+#define STACK_SIZE			(16 * 1024)
+#define INTERPRETER_SIZE	(128 * 1024 * 1024)
+
+/* symbol benchmark parameters */
+#define MAX_SYMBOLS			256000
+#define LOOKUP_COUNT		20000
+#define LOOKUP_PASSES		50
+
+/* hash benchmark parameters */
+#define MAX_HASH_LENGTH		4096
+#define HASH_BYTES			(256 * 1024 * 1024)
+#define HASH_KEYS			65536
+
+/* prototypes */
+static void ErrorHandler(BobInterpreter *c,int code,va_list ap);
+static void BenchSymbols(BobInterpreter *c);
+static void BenchHash(void);
+static double ElapsedNanoseconds(clock_t start);
+static void Usage(void);
+
+/* main - the main routine */
+int main(int argc,char **argv)
+{
+	BobInterpreter *c;
+	char *space;
+
+	/* check the arguments */
+	if (argc != 2)
+		Usage();
+
+	/* make the workspace */
+	if ((space = (char *)malloc(INTERPRETER_SIZE)) == NULL
+	||  (c = BobMakeInterpreter(space,INTERPRETER_SIZE,STACK_SIZE)) == NULL) {
+		fprintf(stderr,"insufficient memory\n");
+		exit(1);
+	}
+	c->errorHandler = ErrorHandler;
+	if (!BobInitInterpreter(c))
+		exit(1);
+
+	/* run the benchmark */
+	if (strcmp(argv[1],"symbols") == 0)
+		BenchSymbols(c);
+	else if (strcmp(argv[1],"hash") == 0)
+		BenchHash();
+	else
+		Usage();
+
+	/* free the workspace */
+	BobFreeInterpreter(c);
+	free(space);
+	return 0;
+}
+
+/* ErrorHandler - error handler callback */
+static void ErrorHandler(BobInterpreter *c,int code,va_list ap)
+{
+	fprintf(stderr,"error %d\n",code);
+	exit(1);
+}
+
+/* BenchSymbols - time symbol lookups at several symbol table sizes */
+static void BenchSymbols(BobInterpreter *c)
+{
+	static char names[MAX_SYMBOLS][16];
+	long count,total,i;
+	int pass;
+	clock_t start;
+	double ns;
+
+	/* make the names */
+	for (i = 0; i < MAX_SYMBOLS; ++i)
+		sprintf(names[i],"bench%ld",i);
+
+	/* grow the table and look up names spread across it */
+	printf("symbols    ns/lookup  buckets\n");
+	for (count = 1000, total = 0; count <= MAX_SYMBOLS; count *= 4) {
+		for (; total < count; ++total)
+			BobInternCString(c,names[total]);
+		start = clock();
+		for (pass = 0; pass < LOOKUP_PASSES; ++pass)
+			for (i = 0; i < LOOKUP_COUNT; ++i)
+				BobInternCString(c,names[(i * 7919) % count]);
+		ns = ElapsedNanoseconds(start) / ((double)LOOKUP_PASSES * LOOKUP_COUNT);
+		printf("%7ld %12.1f %8ld\n",count,ns,(long)BobHashTableSize(c->symbols));
+	}
+}
+
+/* BenchHash - time the string hash and count bucket collisions */
+static void BenchHash(void)
+{
+	static unsigned char text[MAX_HASH_LENGTH];
+	static unsigned char used[HASH_KEYS];
+	BobIntegerType sum = 0;
+	long length,count,i,size,collisions;
+	char key[16];
+	clock_t start;
+	double ns;
+
+	/* make the text */
+	for (i = 0; i < MAX_HASH_LENGTH; ++i)
+		text[i] = (unsigned char)('a' + i % 26);
+
+	/* hash the same number of bytes at each length */
+	printf("length      GB/s\n");
+	for (length = 8; length <= MAX_HASH_LENGTH; length *= 8) {
+		count = HASH_BYTES / length;
+		start = clock();
+		for (i = 0; i < count; ++i) {
+			text[0] = (unsigned char)i;
+			sum += BobHashString(text,(int)length);
+		}
+		ns = ElapsedNanoseconds(start);
+		printf("%6ld %9.2f\n",length,(double)HASH_BYTES / ns);
+	}
+
+	/* count the keys that land in a bucket that is already used */
+	printf("\n   keys  buckets  collisions\n");
+	for (size = 1024; size <= HASH_KEYS; size *= 8) {
+		memset(used,0,sizeof(used));
+		for (i = 0, collisions = 0; i < size; ++i) {
+			sprintf(key,"key%ld",i);
+			if (used[BobHashString((unsigned char *)key,(int)strlen(key)) & (size - 1)]++)
+				++collisions;
+		}
+		printf("%7ld %8ld %11ld\n",size,size,collisions);
+	}
+
+	/* keep the hashing loop from being optimized away */
+	if (sum == 1)
+		printf("\n");
+}
+
+/* ElapsedNanoseconds - return the processor time used since start */
+static double ElapsedNanoseconds(clock_t start)
+{
+	return (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC;
+}
+
+/* Usage - display a usage message and exit */
+static void Usage(void)
+{
+	fprintf(stderr,"usage: bobbench symbols | hash\n");
+	exit(1);
+}
@@ -0,0 +1,506 @@
+/* bobheapinfo.c - analyze a bob heap snapshot */
+/*
+	usage: bobheapinfo [-n count] <snapshot-file>
+
+	Reads a snapshot written by HeapSnapshot() and reports the objects
+	by type, then the objects with the largest retained sizes along with
+	the chain of objects that dominate them.  Dominators are computed
+	with the iterative algorithm of Cooper, Harvey and Kennedy.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include "bob.h"
+
+/* object information */
+typedef struct {
+	unsigned long offset;		/* offset of the object in the heap */
+	long type;					/* type id */
+	unsigned long size;			/* shallow size */
+	unsigned long retained;		/* retained size */
+	char *label;				/* label or NULL */
+	long firstRef;				/* index of the first reference */
+	long refCount;				/* number of references */
+	int rootKind;				/* first root set referring to the object */
+} Object;
+
+/* type information */
+typedef struct {
+	char *name;					/* type name */
+	unsigned long count;		/* number of objects */
+	unsigned long size;			/* total shallow size */
+} Type;
+
+/* snapshot contents (node 0 is a virtual root that refers to each root) */
+static unsigned char *data,*dataPtr,*dataEnd;
+static Object *objects;
+static long objectCount,objectSize;
+static Type *types;
+static long typeCount,typeSize;
+static long *refs;
+static long refCount,refSize;
+static long *roots;
+static long rootCount,rootSize;
+
+/* dominator computation */
+static long *order;				/* nodes in reverse postorder */
+static long *postNumber;		/* postorder number of each node */
+static long *idom;				/* immediate dominator of each node */
+static long *predStart,*preds;	/* predecessors of each node */
+
+/* root set names */
+static char *rootNames[] = {
+	"unknown",
+	"interpreter",
+	"types",
+	"protected",
+	"stack",
+	"user",
+	"profile",
+	"frozen",
+	"handles"
+};
+
+/* prototypes */
+static void ReadSnapshot(char *name);
+static void ResolveReferences(void);
+static long FindObject(unsigned long offset);
+static long Successors(long node,long **pSuccessors);
+static void ComputeOrder(void);
+static void ComputePredecessors(void);
+static void ComputeDominators(void);
+static long Intersect(long n1,long n2);
+static void ComputeRetainedSizes(void);
+static void ReportTypes(void);
+static void ReportRetainers(long count);
+static void PrintObject(long node);
+static int CompareTypes(const void *p1,const void *p2);
+static int CompareRetained(const void *p1,const void *p2);
+static unsigned long ReadNumber(void);
+static int ReadByte(void);
+static void *Allocate(void *ptr,long count,long size);
+static void Fatal(char *fmt,...);
+
+/* main - the main routine */
+int main(int argc,char *argv[])
+{
+	long count = 20;
+	char *name = NULL;
+	int i;
+
+	/* parse the arguments */
+	for (i = 1; i < argc; ++i) {
+		if (strcmp(argv[i],"-n") == 0 && i + 1 < argc)
+			count = atol(argv[++i]);
+		else if (argv[i][0] != '-' && !name)
+			name = argv[i];
+		else
+			name = NULL, i = argc;
+	}
+	if (!name) {
+		fprintf(stderr,"usage: bobheapinfo [-n count] <snapshot-file>\n");
+		exit(1);
+	}
+
+	/* read the snapshot and build the object graph */
+	ReadSnapshot(name);
+	ResolveReferences();
+
+	/* compute the dominator tree and the retained sizes */
+	ComputeOrder();
+	ComputePredecessors();
+	ComputeDominators();
+	ComputeRetainedSizes();
+
+	/* display the reports */
+	ReportTypes();
+	ReportRetainers(count);
+	return 0;
+}
+
+/* ReadSnapshot - read a snapshot file */
+static void ReadSnapshot(char *name)
+{
+	long length,i;
+	FILE *fp;
+	int tag;
+
+	/* read the entire file */
+	if ((fp = fopen(name,"rb")) == NULL)
+		Fatal("can't open '%s'",name);
+	fseek(fp,0,SEEK_END);
+	length = ftell(fp);
+	fseek(fp,0,SEEK_SET);
+	data = Allocate(NULL,length + 1,1);
+	if (fread(data,1,length,fp) != (size_t)length)
+		Fatal("error reading '%s'",name);
+	fclose(fp);
+	dataPtr = data;
+	dataEnd = data + length;
+
+	/* check the header */
+	if (length < 4 || memcmp(data,"BOBH",4) != 0)
+		Fatal("'%s' is not a heap snapshot",name);
+	dataPtr += 4;
+	if (ReadNumber() != BobSnapshotVersion)
+		Fatal("'%s' has the wrong snapshot version",name);
+
+	/* the virtual root is object zero */
+	objects = Allocate(NULL,objectSize = 1024,sizeof(Object));
+	memset(&objects[0],0,sizeof(Object));
+	objectCount = 1;
+
+	/* read the records */
+	while ((tag = ReadByte()) != BobSnapTagEnd) {
+		switch (tag) {
+		case BobSnapTagType:
+			{	long id = (long)ReadNumber();
+				long len = (long)ReadNumber();
+				if (id != typeCount)
+					Fatal("bad type record");
+				if (typeCount >= typeSize)
+					types = Allocate(types,typeSize = typeSize ? typeSize * 2 : 64,sizeof(Type));
+				types[typeCount].name = Allocate(NULL,len + 1,1);
+				for (i = 0; i < len; ++i)
+					types[typeCount].name[i] = ReadByte();
+				types[typeCount].name[len] = '\0';
+				types[typeCount].count = 0;
+				types[typeCount].size = 0;
+				++typeCount;
+			}
+			break;
+		case BobSnapTagRoot:
+			if (rootCount + 2 > rootSize)
+				roots = Allocate(roots,rootSize = rootSize ? rootSize * 2 : 256,sizeof(long));
+			roots[rootCount++] = (long)ReadNumber();
+			roots[rootCount++] = (long)ReadNumber();
+			break;
+		case BobSnapTagObject:
+			{	Object *obj;
+				long len;
+				if (objectCount >= objectSize)
+					objects = Allocate(objects,objectSize *= 2,sizeof(Object));
+				obj = &objects[objectCount++];
+				obj->offset = ReadNumber();
+				obj->type = (long)ReadNumber();
+				obj->size = ReadNumber();
+				obj->retained = 0;
+				obj->rootKind = 0;
+				if (obj->type >= typeCount)
+					Fatal("bad type id");
+				if ((len = (long)ReadNumber()) == 0)
+					obj->label = NULL;
+				else {
+					obj->label = Allocate(NULL,len + 1,1);
+					for (i = 0; i < len; ++i) {
+						int ch = ReadByte();
+						obj->label[i] = ch < ' ' || ch > '~' ? '.' : ch;
+					}
+					obj->label[len] = '\0';
+				}
+				obj->firstRef = refCount;
+				obj->refCount = (long)ReadNumber();
+				if (refCount + obj->refCount > refSize) {
+					while (refCount + obj->refCount > refSize)
+						refSize = refSize ? refSize * 2 : 4096;
+					refs = Allocate(refs,refSize,sizeof(long));
+				}
+				for (i = 0; i < obj->refCount; ++i)
+					refs[refCount++] = (long)ReadNumber();
+				types[obj->type].count++;
+				types[obj->type].size += obj->size;
+			}
+			break;
+		default:
+			Fatal("bad record tag %d",tag);
+			break;
+		}
+	}
+}
+
+/* ResolveReferences - convert heap offsets to object indices */
+static void ResolveReferences(void)
+{
+	long i;
+
+	/* resolve the object references */
+	for (i = 0; i < refCount; ++i)
+		refs[i] = FindObject((unsigned long)refs[i]);
+
+	/* make the roots successors of the virtual root */
+	objects[0].firstRef = refCount;
+	objects[0].refCount = 0;
+	for (i = 0; i < rootCount; i += 2) {
+		long node = FindObject((unsigned long)roots[i + 1]);
+		if (objects[node].rootKind == 0)
+			objects[node].rootKind = (int)roots[i];
+		if (refCount >= refSize)
+			refs = Allocate(refs,refSize = refSize ? refSize * 2 : 4096,sizeof(long));
+		refs[refCount++] = node;
+		objects[0].refCount++;
+	}
+}
+
+/* FindObject - find an object by its heap offset */
+static long FindObject(unsigned long offset)
+{
+	long lo = 1,hi = objectCount - 1;
+	while (lo <= hi) {
+		long mid = (lo + hi) / 2;
+		if (objects[mid].offset == offset)
+			return mid;
+		else if (objects[mid].offset < offset)
+			lo = mid + 1;
+		else
+			hi = mid - 1;
+	}
+	Fatal("reference to unknown object at offset %lu",offset);
+	return 0; /* never reached */
+}
+
+/* Successors - get the successors of a node */
+static long Successors(long node,long **pSuccessors)
+{
+	*pSuccessors = &refs[objects[node].firstRef];
+	return objects[node].refCount;
+}
+
+/* ComputeOrder - number the nodes in postorder with a depth first search */
+static void ComputeOrder(void)
+{
+	long *stack,*next,sp = 0,count = 0,i;
+
+	/* allocate the work arrays */
+	order = Allocate(NULL,objectCount,sizeof(long));
+	postNumber = Allocate(NULL,objectCount,sizeof(long));
+	stack = Allocate(NULL,objectCount,sizeof(long));
+	next = Allocate(NULL,objectCount,sizeof(long));
+	for (i = 0; i < objectCount; ++i) {
+		postNumber[i] = -1;
+		next[i] = -1;
+	}
+
+	/* depth first search from the virtual root */
+	stack[sp++] = 0;
+	next[0] = 0;
+	while (sp > 0) {
+		long node = stack[sp - 1],*succ,n;
+		n = Successors(node,&succ);
+		if (next[node] < n) {
+			long s = succ[next[node]++];
+			if (next[s] < 0) {
+				next[s] = 0;
+				stack[sp++] = s;
+			}
+		}
+		else {
+			postNumber[node] = count++;
+			--sp;
+		}
+	}
+
+	/* build the reverse postorder */
+	for (i = 0; i < objectCount; ++i)
+		if (postNumber[i] >= 0)
+			order[count - 1 - postNumber[i]] = i;
+	objects[0].retained = (unsigned long)count;	/* number of reachable nodes */
+	free(stack);
+	free(next);
+}
+
+/* ComputePredecessors - build the predecessor lists */
+static void ComputePredecessors(void)
+{
+	long *fill,i,j;
+
+	/* count the predecessors of each node */
+	predStart = Allocate(NULL,objectCount + 1,sizeof(long));
+	memset(predStart,0,(objectCount + 1) * sizeof(long));
+	for (i = 0; i < objectCount; ++i) {
+		long *succ,n = Successors(i,&succ);
+		if (postNumber[i] >= 0)
+			for (j = 0; j < n; ++j)
+				predStart[succ[j] + 1]++;
+	}
+	for (i = 0; i < objectCount; ++i)
+		predStart[i + 1] += predStart[i];
+
+	/* fill in the predecessors */
+	preds = Allocate(NULL,predStart[objectCount] + 1,sizeof(long));
+	fill = Allocate(NULL,objectCount,sizeof(long));
+	memcpy(fill,predStart,objectCount * sizeof(long));
+	for (i = 0; i < objectCount; ++i) {
+		long *succ,n = Successors(i,&succ);
+		if (postNumber[i] >= 0)
+			for (j = 0; j < n; ++j)
+				preds[fill[succ[j]]++] = i;
+	}
+	free(fill);
+}
+
+/* ComputeDominators - compute the immediate dominator of each node */
+static void ComputeDominators(void)
+{
+	long reachable = (long)objects[0].retained;
+	int changedP = 1;
+	long i,j;
+
+	/* initialize */
+	idom = Allocate(NULL,objectCount,sizeof(long));
+	for (i = 0; i < objectCount; ++i)
+		idom[i] = -1;
+	idom[0] = 0;
+
+	/* iterate until the dominators don't change */
+	while (changedP) {
+		changedP = 0;
+		for (i = 1; i < reachable; ++i) {
+			long node = order[i],newIdom = -1;
+			for (j = predStart[node]; j < predStart[node + 1]; ++j) {
+				long pred = preds[j];
+				if (idom[pred] >= 0)
+					newIdom = newIdom < 0 ? pred : Intersect(pred,newIdom);
+			}
+			if (newIdom != idom[node]) {
+				idom[node] = newIdom;
+				changedP = 1;
+			}
+		}
+	}
+}
+
+/* Intersect - find the nearest common dominator of two nodes */
+static long Intersect(long n1,long n2)
+{
+	while (n1 != n2) {
+		while (postNumber[n1] < postNumber[n2])
+			n1 = idom[n1];
+		while (postNumber[n2] < postNumber[n1])
+			n2 = idom[n2];
+	}
+	return n1;
+}
+
+/* ComputeRetainedSizes - add the size of each node to its dominators */
+static void ComputeRetainedSizes(void)
+{
+	long reachable = (long)objects[0].retained;
+	long i;
+	for (i = 0; i < objectCount; ++i)
+		objects[i].retained = objects[i].size;
+	for (i = reachable; --i > 0; ) {
+		long node = order[i];
+		objects[idom[node]].retained += objects[node].retained;
+	}
+}
+
+/* ReportTypes - report the number and size of the objects of each type */
+static void ReportTypes(void)
+{
+	Type **sorted = Allocate(NULL,typeCount + 1,sizeof(Type *));
+	long i;
+	for (i = 0; i < typeCount; ++i)
+		sorted[i] = &types[i];
+	qsort(sorted,typeCount,sizeof(Type *),CompareTypes);
+	printf("%ld objects, %lu bytes, %ld roots\n\n",
+		   objectCount - 1,objects[0].retained,rootCount / 2);
+	printf("%10s %10s  %s\n","count","bytes","type");
+	for (i = 0; i < typeCount; ++i)
+		printf("%10lu %10lu  %s\n",sorted[i]->count,sorted[i]->size,sorted[i]->name);
+	free(sorted);
+}
+
+/* ReportRetainers - report the objects with the largest retained sizes */
+static void ReportRetainers(long count)
+{
+	long *sorted = Allocate(NULL,objectCount,sizeof(long));
+	long i,n = 0;
+	for (i = 1; i < objectCount; ++i)
+		if (idom[i] >= 0)
+			sorted[n++] = i;
+	qsort(sorted,n,sizeof(long),CompareRetained);
+	printf("\n%10s %10s  %s\n","retained","shallow","object (dominators)");
+	for (i = 0; i < n && i < count; ++i) {
+		long node = sorted[i],dom;
+		printf("%10lu %10lu  ",objects[node].retained,objects[node].size);
+		PrintObject(node);
+		for (dom = idom[node]; dom != 0; dom = idom[dom]) {
+			printf(" < ");
+			PrintObject(dom);
+		}
+		for (dom = node; idom[dom] != 0; dom = idom[dom])
+			;
+		printf(" < [%s]\n",rootNames[objects[dom].rootKind < (int)(sizeof(rootNames) / sizeof(char *)) ? objects[dom].rootKind : 0]);
+	}
+	free(sorted);
+}
+
+/* PrintObject - print a description of an object */
+static void PrintObject(long node)
+{
+	Object *obj = &objects[node];
+	if (obj->label)
+		printf("%s '%s'",types[obj->type].name,obj->label);
+	else
+		printf("%s@%lx",types[obj->type].name,obj->offset);
+}
+
+/* CompareTypes - compare types for sorting by decreasing size */
+static int CompareTypes(const void *p1,const void *p2)
+{
+	unsigned long s1 = (*(Type **)p1)->size;
+	unsigned long s2 = (*(Type **)p2)->size;
+	return s1 < s2 ? 1 : s1 > s2 ? -1 : 0;
+}
+
+/* CompareRetained - compare objects for sorting by decreasing retained size */
+static int CompareRetained(const void *p1,const void *p2)
+{
+	unsigned long r1 = objects[*(long *)p1].retained;
+	unsigned long r2 = objects[*(long *)p2].retained;
+	return r1 < r2 ? 1 : r1 > r2 ? -1 : 0;
+}
+
+/* ReadNumber - read an unsigned LEB128 number */
+static unsigned long ReadNumber(void)
+{
+	unsigned long n = 0;
+	int shift = 0,byte;
+	do {
+		byte = ReadByte();
+		n |= (unsigned long)(byte & 0x7f) << shift;
+		shift += 7;
+	} while (byte & 0x80);
+	return n;
+}
+
+/* ReadByte - read a byte from the snapshot */
+static int ReadByte(void)
+{
+	if (dataPtr >= dataEnd)
+		Fatal("unexpected end of snapshot");
+	return *dataPtr++;
+}
+
+/* Allocate - allocate or resize an array */
+static void *Allocate(void *ptr,long count,long size)
+{
+	void *p = realloc(ptr,(size_t)(count * size));
+	if (!p)
+		Fatal("insufficient memory");
+	return p;
+}
+
+/* Fatal - report a fatal error and exit */
+static void Fatal(char *fmt,...)
+{
+	va_list ap;
+	va_start(ap,fmt);
+	printf("error: ");
+	vprintf(fmt,ap);
+	putchar('\n');
+	va_end(ap);
+	exit(1);
+}
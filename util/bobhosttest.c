@@ -0,0 +1,544 @@
+/* bobhosttest.c - exercise the interpreter from a host program */
+/*
+	usage: bobhosttest
+
+	Runs the checks that need a host program because Bob code can't
+	catch an error.  Prints one line per check and exits with a nonzero
+	status if any check fails.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bob.h"
+
+#define STACK_SIZE			(16 * 1024)
+#define INTERPRETER_SIZE	(1024 * 1024)
+#define COMPILER_SIZE		(64 * 1024)
+
+/* image files and the offsets of header fields (see bobimage.c) */
+#define IMAGE_NAME			"bobhosttest.bim"
+#define CHANGED_IMAGE_NAME	"bobhosttest-changed.bim"
+#define VERSION_OFFSET		sizeof(long)
+#define FINGERPRINT_OFFSET	(4 * sizeof(long))
+
+/* space for the interpreter and the compiler */
+static char interpreterSpace[INTERPRETER_SIZE];
+static char compilerSpace[COMPILER_SIZE];
+
+/* console stream structure */
+typedef struct {
+	BobStreamDispatch *d;
+} ConsoleStream;
+
+/* CloseConsoleStream - console stream close handler */
+static int CloseConsoleStream(BobStream *s)
+{
+	return 0;
+}
+
+/* ConsoleStreamGetC - console stream getc handler */
+static int ConsoleStreamGetC(BobStream *s)
+{
+	return getchar();
+}
+
+/* ConsoleStreamPutC - console stream putc handler */
+static int ConsoleStreamPutC(int ch,BobStream *s)
+{
+	return putchar(ch);
+}
+
+/* dispatch structure for console streams */
+static BobStreamDispatch consoleDispatch = {
+	CloseConsoleStream,
+	ConsoleStreamGetC,
+	ConsoleStreamPutC
+};
+
+/* console stream */
+static ConsoleStream consoleStream = { &consoleDispatch };
+
+/* error code passed to the last call of the error handler */
+static int lastError;
+
+/* number of failed checks */
+static int failures;
+
+/* 'Resource' type with a destroy handler */
+static BobDispatch *resourceDispatch;
+static long resourcesMade,resourcesDestroyed;
+
+/* prototypes */
+static void ErrorHandler(BobInterpreter *c,int code,va_list ap);
+static void Check(char *name,int okP);
+static void TestHandleScopes(BobInterpreter *c);
+static void TestFinalizers(BobInterpreter *c);
+static void TestRegions(BobInterpreter *c);
+static int RunRequests(BobInterpreter *c,char *name,int count);
+static void TestNativeCompare(BobInterpreter *c);
+static void TestRegexErrors(BobInterpreter *c);
+static void TestHash(BobInterpreter *c);
+static void TestHashCache(BobInterpreter *c);
+static void TestSymbols(BobInterpreter *c);
+static void TestFreeze(BobInterpreter *c);
+static void TestImages(BobInterpreter *c);
+static int LoadChangedImage(BobInterpreter *c,unsigned char *image,long size,size_t offset);
+static int EvalError(BobInterpreter *c,char *str);
+static void DestroyResource(BobInterpreter *c,BobValue obj);
+static BobValue BIF_MakeResource(BobInterpreter *c);
+static BobValue BIF_ResourcesDestroyed(BobInterpreter *c);
+static BobValue BIF_CompareNumbers(BobInterpreter *c);
+static BobValue BIF_NestedArgCount(BobInterpreter *c);
+
+/* test functions */
+static BobCMethod functionTable[] = {
+BobMethodEntry( "MakeResource",			BIF_MakeResource		),
+BobMethodEntry( "ResourcesDestroyed",	BIF_ResourcesDestroyed	),
+BobMethodEntry( "CompareNumbers",		BIF_CompareNumbers		),
+BobMethodEntry( "NestedArgCount",		BIF_NestedArgCount		),
+BobMethodEntry( 0,						0						)
+};
+
+/* main - the main routine */
+int main(int argc,char **argv)
+{
+	BobUnwindTarget target;
+	BobInterpreter *c;
+
+	/* make the workspace */
+	if ((c = BobMakeInterpreter(interpreterSpace,sizeof(interpreterSpace),STACK_SIZE)) == NULL)
+		exit(1);
+
+	/* setup standard i/o */
+	c->standardInput = (BobStream *)&consoleStream;
+	c->standardOutput = (BobStream *)&consoleStream;
+	c->standardError = (BobStream *)&consoleStream;
+
+	/* setup the error handler */
+	c->errorHandler = ErrorHandler;
+
+	/* abort if an error isn't caught by a check */
+	BobPushUnwindTarget(c,&target);
+	if (BobUnwindCatch(c)) {
+		printf("unexpected error %d\n",lastError);
+		exit(1);
+	}
+
+	/* initialize the workspace */
+	if (!BobInitInterpreter(c))
+		exit(1);
+	BobUseStandardIO(c);
+	BobEnterLibrarySymbols(c);
+	BobUseEval(c,compilerSpace,sizeof(compilerSpace));
+
+	/* enter the test functions and types */
+	BobEnterFunctions(c,functionTable);
+	if (!(resourceDispatch = BobEnterCPtrObjectType(c,NULL,"Resource",NULL,NULL)))
+		BobInsufficientMemory(c);
+	resourceDispatch->destroy = DestroyResource;
+
+	/* run the checks */
+	TestHandleScopes(c);
+	TestFinalizers(c);
+	TestRegions(c);
+	TestNativeCompare(c);
+	TestRegexErrors(c);
+	TestHash(c);
+	TestHashCache(c);
+	TestSymbols(c);
+	TestFreeze(c);
+	TestImages(c);
+
+	/* return the status */
+	BobPopUnwindTarget(c);
+	BobFreeInterpreter(c);
+	return failures == 0 ? 0 : 1;
+}
+
+/* ErrorHandler - error handler callback */
+static void ErrorHandler(BobInterpreter *c,int code,va_list ap)
+{
+	lastError = code;
+	BobAbort(c);
+}
+
+/* Check - report the result of a check */
+static void Check(char *name,int okP)
+{
+	printf("%s: %s\n",name,okP ? "ok" : "FAILED");
+	if (!okP)
+		++failures;
+}
+
+/* TestHandleScopes - make handles under collector pressure and throw */
+static void TestHandleScopes(BobInterpreter *c)
+{
+	static BobValue *handles[1000];
+	BobUnwindTarget target;
+	BobHandleScope scope;
+	BobValue *name,*next;
+	unsigned long gcCount;
+	volatile int keptP;
+	int i;
+
+	/* make a handle that must survive the error */
+	BobOpenHandleScope(c,&scope);
+	name = BobMakeHandle(c,BobMakeCString(c,"handle"));
+	next = c->handleNext;
+	gcCount = c->gcCount;
+	keptP = TRUE;
+
+	/* fill several handle blocks, then throw */
+	lastError = 0;
+	BobPushUnwindTarget(c,&target);
+	if (BobUnwindCatch(c) == 0) {
+		BobHandleScope inner;
+		BobOpenHandleScope(c,&inner);
+		for (i = 0; i < 1000; ++i) {
+			BobValue str = BobMakeString(c,NULL,100);
+			BobSetStringElement(str,0,i & 0xff);
+			handles[i] = BobMakeHandle(c,str);
+			BobMakeString(c,NULL,1000);
+		}
+		for (i = 0; i < 1000; ++i)
+			if (BobStringElement(*handles[i],0) != (i & 0xff))
+				keptP = FALSE;
+		BobCallErrorHandler(c,BobErrIndexOutOfBounds,BobMakeSmallInteger(i));
+	}
+	BobPopUnwindTarget(c);
+
+	/* the handles made after the target was pushed are released */
+	Check("handle values survive collections",keptP && c->gcCount > gcCount);
+	Check("error unwinds past the handle scope",lastError == BobErrIndexOutOfBounds);
+	Check("unwinding releases the handles",c->handleNext == next);
+	BobCollectGarbage(c);
+	Check("outer handle survives",strcmp((char *)BobStringAddress(*name),"handle") == 0);
+	BobCloseHandleScope(c,&scope);
+}
+
+/* TestFinalizers - check that unreachable cobjects are destroyed without a function return */
+static void TestFinalizers(BobInterpreter *c)
+{
+	BobValue makeResource = BobGlobalValue(BobInternCString(c,"MakeResource"));
+	BobValue resourcesDestroyedFcn = BobGlobalValue(BobInternCString(c,"ResourcesDestroyed"));
+	BobValue gc = BobGlobalValue(BobInternCString(c,"gc"));
+	BobValue result;
+	int i;
+
+	/* calls from the host to built-in functions only */
+	resourcesMade = resourcesDestroyed = 0;
+	for (i = 0; i < 100; ++i)
+		BobCallFunction(c,makeResource,0);
+	BobCallFunction(c,resourcesDestroyedFcn,0); /* replaces the last resource in the value register */
+	BobCallFunction(c,gc,0);
+	Check("finalizers run after a host call",resourcesDestroyed == resourcesMade);
+
+	/* a loop that calls built-in functions but never returns from a function */
+	resourcesMade = resourcesDestroyed = 0;
+	result = BobEvalString(c,"function () { local i; for (i = 0; i < 100; ++i) MakeResource(); ResourcesDestroyed(); gc(); return ResourcesDestroyed(); } ();");
+	Check("finalizers run after a built-in call",BobIntegerP(result) && BobIntegerValue(result) == 100);
+}
+
+/* DestroyResource - destroy a 'Resource' object */
+static void DestroyResource(BobInterpreter *c,BobValue obj)
+{
+	++resourcesDestroyed;
+}
+
+/* BIF_MakeResource - built-in function 'MakeResource' */
+static BobValue BIF_MakeResource(BobInterpreter *c)
+{
+	BobCheckArgCnt(c,2);
+	++resourcesMade;
+	return BobMakeCPtrObject(c,resourceDispatch,(void *)resourceDispatch);
+}
+
+/* BIF_ResourcesDestroyed - built-in function 'ResourcesDestroyed' */
+static BobValue BIF_ResourcesDestroyed(BobInterpreter *c)
+{
+	BobCheckArgCnt(c,2);
+	return BobMakeInteger(c,resourcesDestroyed);
+}
+
+/* TestRegions - run requests in allocation regions */
+static void TestRegions(BobInterpreter *c)
+{
+	unsigned long gcCount;
+	BobRegion outer,region;
+	int outerFreedP,freedP;
+	long used,left;
+	BobValue kept;
+
+	/* a request that only makes garbage and one that saves its result */
+	BobEvalString(c,"define tempRequest(n) { local v = new Vector(), i; for (i = 0; i < n; ++i) v.Push(i.toString()); return v.size; }");
+	BobEvalString(c,"define keepRequest(n) { local v = new Vector(), i; for (i = 0; i < n; ++i) v.Push(i.toString()); saved = v; return v.size; }");
+	BobEvalString(c,"saved = nil;");
+
+	/* the objects of requests that make only garbage are freed without a collection */
+	BobCollectGarbage(c);
+	gcCount = c->gcCount;
+	Check("regions free unreachable requests",RunRequests(c,"tempRequest",1000) == 1000);
+	Check("freed requests don't collect",c->gcCount == gcCount);
+
+	/* the objects of a request that stores into a global are kept */
+	Check("regions keep escaping requests",RunRequests(c,"keepRequest",1000) == 0);
+	BobCollectGarbage(c);
+	kept = BobGlobalValue(BobInternCString(c,"saved"));
+	Check("kept objects survive a collection",
+		  BobVectorP(kept)
+	  &&  BobVectorSize(kept) == 20
+	  &&  strcmp((char *)BobStringAddress(BobVectorElement(kept,19)),"19") == 0);
+
+	/* only the escaping objects and the value register are kept */
+	BobEvalString(c,"define mixedRequest(n) { local i; for (i = 0; i < n; ++i) i.toString(); saved = n.toString(); return (n + 1).toString(); }");
+	BobCollectGarbage(c);
+	gcCount = c->gcCount;
+	BobOpenRegion(c,&region);
+	BobCallFunction(c,BobGlobalValue(BobInternCString(c,"mixedRequest")),1,BobMakeSmallInteger(1000));
+	used = (long)(c->newSpace->free - region.mark);
+	freedP = BobCloseRegion(c,&region);
+	left = (long)(c->newSpace->free - region.mark);
+	Check("regions keep only escaping objects",!freedP && c->gcCount == gcCount && left > 0 && left * 100 < used);
+	Check("regions keep the value register",
+		  BobStringP(c->val)
+	  &&  strcmp((char *)BobStringAddress(c->val),"1001") == 0);
+
+	/* an inner region keeps what it stores into an object of an outer region */
+	BobEvalString(c,"define outerRequest() { saved = new Vector(); }");
+	BobEvalString(c,"define innerRequest(n) { local i; for (i = 0; i < n; ++i) saved.Push(i.toString()); saved.size = 1; }");
+	BobCollectGarbage(c);
+	gcCount = c->gcCount;
+	BobOpenRegion(c,&outer);
+	BobCallFunction(c,BobGlobalValue(BobInternCString(c,"outerRequest")),0);
+	BobOpenRegion(c,&region);
+	BobCallFunction(c,BobGlobalValue(BobInternCString(c,"innerRequest")),1,BobMakeSmallInteger(1000));
+	freedP = BobCloseRegion(c,&region);
+	outerFreedP = BobCloseRegion(c,&outer);
+	kept = BobGlobalValue(BobInternCString(c,"saved"));
+	Check("nested regions keep stores into outer objects",
+		  !freedP && !outerFreedP && c->gcCount == gcCount
+	  &&  BobVectorP(kept)
+	  &&  BobVectorSize(kept) == 1
+	  &&  strcmp((char *)BobStringAddress(BobVectorElement(kept,0)),"0") == 0);
+}
+
+/* RunRequests - call a function in a region for each request and count the freed regions */
+static int RunRequests(BobInterpreter *c,char *name,int count)
+{
+	BobHandleScope scope;
+	BobValue *fcn;
+	int freed = 0;
+	BobOpenHandleScope(c,&scope);
+	fcn = BobMakeHandle(c,BobGlobalValue(BobInternCString(c,name)));
+	while (--count >= 0) {
+		BobRegion region;
+		BobOpenRegion(c,&region);
+		BobCallFunction(c,*fcn,1,BobMakeSmallInteger(20));
+		if (BobCloseRegion(c,&region))
+			++freed;
+	}
+	BobCloseHandleScope(c,&scope);
+	return freed;
+}
+
+/* TestNativeCompare - call built-in functions from built-in methods */
+static void TestNativeCompare(BobInterpreter *c)
+{
+	BobValue result;
+	result = BobEvalString(c,"function () { local v = new Vector(), i, ok = true; for (i = 0; i < 40; ++i) v.Push(i * 17 % 40); v.Sort(CompareNumbers); for (i = 0; i < 40; ++i) if (v[i] != i) ok = false; return ok; } ();");
+	Check("sort with a built-in comparison",result == c->trueValue);
+	result = BobEvalString(c,"NestedArgCount(CompareNumbers, 1, 2);");
+	Check("nested calls keep the argument count",BobIntegerP(result) && BobIntegerValue(result) == 5);
+	Check("errors pass through a built-in comparison",EvalError(c,"new Vector(2).Sort(CompareNumbers);") == BobErrTypeError);
+}
+
+/* BIF_CompareNumbers - built-in function 'CompareNumbers' */
+static BobValue BIF_CompareNumbers(BobInterpreter *c)
+{
+	BobIntegerType a,b;
+	BobParseArguments(c,"**ll",&a,&b);
+	return BobMakeInteger(c,a < b ? -1 : a == b ? 0 : 1);
+}
+
+/* BIF_NestedArgCount - built-in function 'NestedArgCount' */
+static BobValue BIF_NestedArgCount(BobInterpreter *c)
+{
+	BobCheckArgCnt(c,5);
+	BobCheck(c,5);
+	BobPush(c,BobGetArg(c,3));
+	BobPush(c,c->nilValue);
+	BobPush(c,c->nilValue);
+	BobPush(c,BobGetArg(c,4));
+	BobPush(c,BobGetArg(c,5));
+	BobNestedCall(c,4);
+	return BobMakeInteger(c,BobArgCnt(c));
+}
+
+/* TestRegexErrors - check that repeat counts past the limit are errors */
+static void TestRegexErrors(BobInterpreter *c)
+{
+	Check("regex count past the limit",EvalError(c,"new Regex(\"a{1001}\");") == BobErrBadRegex);
+	Check("regex count with many digits",EvalError(c,"new Regex(\"a{99999}\");") == BobErrBadRegex);
+	Check("regex maximum with many digits",EvalError(c,"new Regex(\"a{1,99999}\");") == BobErrBadRegex);
+}
+
+/* TestHash - check that the string hash doesn't depend on alignment */
+static void TestHash(BobInterpreter *c)
+{
+	static char text[] = "the string hash reads eight bytes at a time";
+	unsigned char buf[sizeof(text) + sizeof(long long)];
+	int length = (int)strlen(text),offset,sameP = TRUE;
+	BobIntegerType hash = BobHashString((unsigned char *)text,length);
+	for (offset = 1; offset < (int)sizeof(long long); ++offset) {
+		memcpy(buf + offset,text,length);
+		if (BobHashString(buf + offset,length) != hash)
+			sameP = FALSE;
+	}
+	Check("unaligned strings hash the same",sameP);
+	Check("string hashes aren't negative",hash >= 0 && BobHashString((unsigned char *)"\377\377\377\377\377\377\377\377",8) >= 0);
+}
+
+/* TestHashCache - check that a string caches its hash until it is changed */
+static void TestHashCache(BobInterpreter *c)
+{
+	BobValue str = BobMakeCString(c,"cached hash");
+	BobIntegerType hash = BobHashValue(str);
+	Check("strings cache their hash",BobStringHash(str) == hash && hash != 0);
+	BobSetStringElement(str,0,'C');
+	Check("storing into a string clears its hash",BobStringHash(str) == 0 && BobHashValue(str) != hash);
+}
+
+/* TestSymbols - check that the symbol table grows with the symbols */
+static void TestSymbols(BobInterpreter *c)
+{
+	BobIntegerType size = BobHashTableSize(c->symbols);
+	BobEvalString(c,"function () { local i; for (i = 0; i < 2000; ++i) (\"grow\" + i.toString()).Intern(); } ();");
+	Check("the symbol table grows",BobHashTableSize(c->symbols) > size);
+	Check("the symbol table stays sparse",c->symbolCount <= BobHashTableSize(c->symbols) * BobSymbolTableExpandThreshold);
+	Check("the symbol count is kept",c->symbolCount == BobCountSymbols(c));
+}
+
+/* TestFreeze - check that the literals of frozen code can't be modified */
+static void TestFreeze(BobInterpreter *c)
+{
+	BobValue result;
+	BobEvalString(c,"define frozenLiteral() { return \"frozen\"; }");
+	Check("freeze the code",BobFreezeCode(c) > 0);
+	Check("writing a frozen literal is an error",EvalError(c,"frozenLiteral()[0] = 70;") == BobErrFrozenObject);
+	result = BobEvalString(c,"frozenLiteral();");
+	Check("frozen literals are unchanged",
+		  BobStringP(result)
+	  &&  strcmp((char *)BobStringAddress(result),"frozen") == 0);
+	result = BobEvalString(c,"function () { local s = frozenLiteral() + \"\"; s[0] = 70; return s; } ();");
+	Check("copies of frozen literals can be modified",
+		  BobStringP(result)
+	  &&  strcmp((char *)BobStringAddress(result),"Frozen") == 0);
+}
+
+/* TestImages - save an image and load it and copies with changed headers */
+static void TestImages(BobInterpreter *c)
+{
+	static char imageSpace[INTERPRETER_SIZE];
+	unsigned char *image = NULL;
+	BobUnwindTarget target;
+	BobInterpreter *ic;
+	BobValue value;
+	long size = 0;
+	FILE *fp;
+
+	/* save an image and read it back */
+	BobEvalString(c,"imageValue = 1234;");
+	Check("save an image",BobSaveImage(c,IMAGE_NAME));
+	if ((fp = fopen(IMAGE_NAME,"rb")) != NULL) {
+		fseek(fp,0,SEEK_END);
+		size = ftell(fp);
+		fseek(fp,0,SEEK_SET);
+		if ((image = (unsigned char *)malloc(size)) != NULL && fread(image,1,size,fp) != (size_t)size)
+			size = 0;
+		fclose(fp);
+	}
+	if (!image || size == 0) {
+		Check("read the image",FALSE);
+		free(image);
+		return;
+	}
+
+	/* make an interpreter to load the images */
+	if ((ic = BobMakeInterpreter(imageSpace,sizeof(imageSpace),STACK_SIZE)) == NULL) {
+		Check("make an interpreter for the image",FALSE);
+		free(image);
+		return;
+	}
+	ic->standardInput = ic->standardOutput = ic->standardError = (BobStream *)&consoleStream;
+	ic->errorHandler = ErrorHandler;
+	BobPushUnwindTarget(ic,&target);
+	if (BobUnwindCatch(ic) == 0) {
+
+		/* images with another version or from another executable are rejected */
+		Check("reject an image with another version",!LoadChangedImage(ic,image,size,VERSION_OFFSET));
+		Check("reject an image from another executable",!LoadChangedImage(ic,image,size,FINGERPRINT_OFFSET));
+
+		/* the unchanged image loads */
+		if (BobLoadImage(ic,IMAGE_NAME)) {
+			value = BobGlobalValue(BobInternCString(ic,"imageValue"));
+			Check("load an image",BobIntegerP(value) && BobIntegerValue(value) == 1234);
+			Check("a loaded image counts its symbols",ic->symbolCount == BobCountSymbols(ic));
+		}
+		else
+			Check("load an image",FALSE);
+	}
+	else
+		Check("load an image without errors",FALSE);
+	BobPopUnwindTarget(ic);
+	BobFreeInterpreter(ic);
+
+	/* remove the image files */
+	remove(IMAGE_NAME);
+	remove(CHANGED_IMAGE_NAME);
+	free(image);
+}
+
+/* LoadChangedImage - load a copy of an image with one byte of the header changed */
+static int LoadChangedImage(BobInterpreter *c,unsigned char *image,long size,size_t offset)
+{
+	FILE *fp;
+	int sts;
+
+	/* a copy that can't be written counts as loaded so its check fails */
+	if ((fp = fopen(CHANGED_IMAGE_NAME,"wb")) == NULL)
+		return TRUE;
+	image[offset] ^= 0xff;
+	sts = fwrite(image,1,size,fp) == (size_t)size;
+	image[offset] ^= 0xff;
+	if (fclose(fp) != 0 || !sts)
+		return TRUE;
+	return BobLoadImage(c,CHANGED_IMAGE_NAME) != NULL;
+}
+
+/* EvalError - evaluate a string and return the code of the error it causes or zero */
+static int EvalError(BobInterpreter *c,char *str)
+{
+	/* the stack can move so the stack pointers are kept as offsets */
+	long spOffset = c->stackTop - c->sp;
+	long fpOffset = (BobValue *)c->fp - c->stackTop;
+	BobUnwindTarget target;
+	BobHandleScope scope;
+	BobValue *env;
+
+	/* evaluate the string */
+	BobOpenHandleScope(c,&scope);
+	env = BobMakeHandle(c,c->env);
+	lastError = 0;
+	BobPushUnwindTarget(c,&target);
+	if (BobUnwindCatch(c) == 0)
+		BobEvalString(c,str);
+	BobPopUnwindTarget(c);
+
+	/* drop the frames of an aborted call */
+	c->sp = c->stackTop - spOffset;
+	c->fp = (BobFrame *)(c->stackTop + fpOffset);
+	c->env = *env;
+	BobCloseHandleScope(c,&scope);
+	return lastError;
+}